@@ -0,0 +1,233 @@
+//
+// CCSDS Reed-Solomon profile.
+//
+// The dual basis conversion is the GF(2)-linear map of CCSDS 131.0-B Annex
+// F, built here from the rows of its matrix T. Being linear, it is also the
+// sum of its values on the low and high nibbles, which is how the SSSE3
+// converter does 16 symbols at a time with two pshufb lookups.
+//
+// @author Jarrod Bennett
+//
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RS_CCSDS_X86
+#endif
+
+#include "rs_ccsds.h"
+
+// Conventional to dual basis and back, and the identity for the
+// conventional basis, with the nibble tables of the first two. Built by
+// build_tables() when the library is loaded.
+static uint8_t toDual[256];
+static uint8_t fromDual[256];
+static uint8_t identity[256];
+static uint8_t toDualNibbles[2][16];
+static uint8_t fromDualNibbles[2][16];
+
+__attribute__((constructor))
+static void build_tables(void);
+
+static void convert(uint8_t * symbols, size_t count, const uint8_t * table);
+
+#if defined(RS_CCSDS_X86)
+static void convert_ssse3(uint8_t * symbols, size_t count,
+                          const uint8_t * table, uint8_t (* nibbles)[16]);
+#endif
+
+int rs_ccsds_init(rs_ccsds_t * ccsds, int e, int depth, int basis) {
+
+    if (ccsds == NULL || (e != 16 && e != 8) || depth < 1 ||
+        depth > RS_CCSDS_MAX_DEPTH ||
+        (basis != RS_CCSDS_CONVENTIONAL && basis != RS_CCSDS_DUAL)) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    int err = rs_codec_init_generator(&ccsds->codec, 8, 2 * e, RS_CCSDS_POLY,
+                                      RS_CCSDS_FCR, RS_CCSDS_PRIM);
+    if (err) {
+        return err;
+    }
+
+    ccsds->depth = depth;
+    ccsds->basis = basis;
+    ccsds->toCodec = basis == RS_CCSDS_DUAL ? fromDual : identity;
+    ccsds->fromCodec = basis == RS_CCSDS_DUAL ? toDual : identity;
+
+    return 0;
+}
+
+void rs_ccsds_free(rs_ccsds_t * ccsds) {
+
+    if (ccsds == NULL) {
+        return;
+    }
+    rs_codec_free(&ccsds->codec);
+}
+
+size_t rs_ccsds_block_length(const rs_ccsds_t * ccsds, int k) {
+
+    return (size_t) ccsds->depth * (size_t) (k + ccsds->codec.nparity);
+}
+
+int rs_ccsds_encode(const rs_ccsds_t * ccsds, uint8_t * block, int k) {
+
+    int np = ccsds->codec.nparity;
+    int depth = ccsds->depth;
+    if (k < 1 || k + np > ccsds->codec.nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Gather (and convert) every codeword's message, encode them as one
+    // batch and scatter (and convert) the parity
+    uint8_t msg[RS_CCSDS_MAX_DEPTH][255];
+    uint8_t parity[RS_CCSDS_MAX_DEPTH][RS_CODEC_MAX_PARITY];
+    const uint8_t * to = ccsds->toCodec;
+    const uint8_t * from = ccsds->fromCodec;
+
+    for (int s = 0; s < k; s++) {
+        const uint8_t * in = &block[s * depth];
+        for (int c = 0; c < depth; c++) {
+            msg[c][s] = to[in[c]];
+        }
+    }
+
+    int err = rs_codec_encode_batch(&ccsds->codec, msg[0], k, sizeof(msg[0]),
+                                    parity[0], sizeof(parity[0]), depth);
+    if (err) {
+        return err;
+    }
+
+    for (int j = 0; j < np; j++) {
+        uint8_t * out = &block[(k + j) * depth];
+        for (int c = 0; c < depth; c++) {
+            out[c] = from[parity[c][j]];
+        }
+    }
+
+    return 0;
+}
+
+int rs_ccsds_decode(const rs_ccsds_t * ccsds, uint8_t * block, int k,
+                    int * corrected) {
+
+    int np = ccsds->codec.nparity;
+    int depth = ccsds->depth;
+    int n = k + np;
+    if (k < 1 || n > ccsds->codec.nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    const uint8_t * to = ccsds->toCodec;
+    const uint8_t * from = ccsds->fromCodec;
+    int total = 0;
+    int failed = 0;
+
+    for (int c = 0; c < depth; c++) {
+        uint8_t codeword[255];
+        for (int s = 0; s < n; s++) {
+            codeword[s] = to[block[s * depth + c]];
+        }
+
+        int positions[RS_CODEC_MAX_PARITY];
+        int result = rs_codec_decode(&ccsds->codec, codeword, n, NULL, 0,
+                                     positions);
+        if (corrected != NULL) {
+            corrected[c] = result;
+        }
+        if (result < 0) {
+            failed = 1;
+            continue;
+        }
+
+        // Only the corrected symbols need converting back
+        for (int r = 0; r < result; r++) {
+            int s = positions[r];
+            block[s * depth + c] = from[codeword[s]];
+        }
+        total += result;
+    }
+
+    return failed ? RS_ERR_UNCORRECTABLE : total;
+}
+
+void rs_ccsds_to_dual(uint8_t * symbols, size_t count) {
+
+#if defined(RS_CCSDS_X86)
+    if (__builtin_cpu_supports("ssse3")) {
+        convert_ssse3(symbols, count, toDual, toDualNibbles);
+        return;
+    }
+#endif
+    convert(symbols, count, toDual);
+}
+
+void rs_ccsds_from_dual(uint8_t * symbols, size_t count) {
+
+#if defined(RS_CCSDS_X86)
+    if (__builtin_cpu_supports("ssse3")) {
+        convert_ssse3(symbols, count, fromDual, fromDualNibbles);
+        return;
+    }
+#endif
+    convert(symbols, count, fromDual);
+}
+
+static void build_tables(void) {
+
+    // Rows of T, the dual basis value of each conventional bit from the
+    // most significant (alpha^7) down
+    static const uint8_t rows[8] = {
+        0x8d, 0xef, 0xec, 0x86, 0xfa, 0x99, 0xaf, 0x7b
+    };
+
+    for (int x = 0; x < 256; x++) {
+        uint8_t dual = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            if (x & (1 << bit)) {
+                dual ^= rows[7 - bit];
+            }
+        }
+        toDual[x] = dual;
+        fromDual[dual] = (uint8_t) x;
+        identity[x] = (uint8_t) x;
+    }
+
+    for (int x = 0; x < 16; x++) {
+        toDualNibbles[0][x] = toDual[x];
+        toDualNibbles[1][x] = toDual[x << 4];
+        fromDualNibbles[0][x] = fromDual[x];
+        fromDualNibbles[1][x] = fromDual[x << 4];
+    }
+}
+
+static void convert(uint8_t * symbols, size_t count, const uint8_t * table) {
+
+    for (size_t i = 0; i < count; i++) {
+        symbols[i] = table[symbols[i]];
+    }
+}
+
+#if defined(RS_CCSDS_X86)
+__attribute__((target("ssse3")))
+static void convert_ssse3(uint8_t * symbols, size_t count,
+                          const uint8_t * table, uint8_t (* nibbles)[16]) {
+
+    __m128i low = _mm_loadu_si128((const __m128i *) nibbles[0]);
+    __m128i high = _mm_loadu_si128((const __m128i *) nibbles[1]);
+    __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) &symbols[i]);
+        __m128i lo = _mm_and_si128(x, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask);
+        x = _mm_xor_si128(_mm_shuffle_epi8(low, lo),
+                          _mm_shuffle_epi8(high, hi));
+        _mm_storeu_si128((__m128i *) &symbols[i], x);
+    }
+    convert(&symbols[i], count - i, table);
+}
+#endif
@@ -0,0 +1,96 @@
+//
+// CCSDS Reed-Solomon profile (CCSDS 131.0-B, TM Synchronization and Channel
+// Coding), on the GF(256) codec.
+//
+// The code is RS(255, 223) correcting E = 16 errors, or RS(255, 239)
+// correcting E = 8, over the field of x^8 + x^7 + x^2 + x + 1 with the
+// generator roots alpha^(11 * (112 + i)). Symbols are sent either in the
+// conventional representation or in the Berlekamp dual basis the standard
+// specifies; dual basis symbols are converted on the fly as the codewords
+// are gathered from and scattered to the block, so no separate pass is
+// needed.
+//
+// A codeblock interleaves I = depth codewords symbol by symbol, so byte p of
+// the block belongs to codeword p % I. The first I * k bytes are therefore
+// the data in order and the last I * 2E the parity. Virtual fill (a
+// shortened code) is a k below 255 - 2E.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_CCSDS_H
+#define RS_CCSDS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+
+#define RS_CCSDS_POLY           (0x187)
+#define RS_CCSDS_FCR            (112)
+#define RS_CCSDS_PRIM           (11)
+
+// Largest interleave depth.
+#define RS_CCSDS_MAX_DEPTH      (8)
+
+// Symbol representations.
+#define RS_CCSDS_CONVENTIONAL   (0)
+#define RS_CCSDS_DUAL           (1)     // Berlekamp dual basis
+
+typedef struct rs_ccsds {
+    rs_codec_t codec;
+    int depth;                  // interleave depth I
+    int basis;                  // RS_CCSDS_CONVENTIONAL or RS_CCSDS_DUAL
+
+    // Symbol maps between the block and the codec, identities for the
+    // conventional basis.
+    const uint8_t * toCodec;
+    const uint8_t * fromCodec;
+} rs_ccsds_t;
+
+// Initialise a CCSDS codec.
+//
+// @param   e: error correction capability, 16 or 8.
+// @param   depth: interleave depth, 1..RS_CCSDS_MAX_DEPTH.
+// @param   basis: RS_CCSDS_CONVENTIONAL or RS_CCSDS_DUAL.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_ccsds_init(rs_ccsds_t * ccsds, int e, int depth, int basis);
+
+// Release a CCSDS codec.
+void rs_ccsds_free(rs_ccsds_t * ccsds);
+
+// Length of a codeblock with k data symbols per codeword.
+size_t rs_ccsds_block_length(const rs_ccsds_t * ccsds, int k);
+
+// Encode a codeblock in place: the depth * k data symbols are read from the
+// front of the block and the parity written after them.
+//
+// @param   k: data symbols per codeword, 1..255 - 2E.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_ccsds_encode(const rs_ccsds_t * ccsds, uint8_t * block, int k);
+
+// Decode a codeblock in place. Each codeword is decoded on its own and
+// only its corrected symbols are written back.
+//
+// @param   corrected: optional, receives the symbols corrected in each of
+//                     the depth codewords, or RS_ERR_UNCORRECTABLE.
+// @return  the total number of symbols corrected, RS_ERR_UNCORRECTABLE if
+//          any codeword failed (the others are still corrected), otherwise
+//          another negative RS_ERR_ code.
+int rs_ccsds_decode(const rs_ccsds_t * ccsds, uint8_t * block, int k,
+                    int * corrected);
+
+// Convert symbols between the conventional and dual basis representations,
+// in place. Uses SSSE3 where the CPU has it.
+void rs_ccsds_to_dual(uint8_t * symbols, size_t count);
+void rs_ccsds_from_dual(uint8_t * symbols, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_CCSDS_H
@@ -0,0 +1,1754 @@
+//
+// General Reed-Solomon codec over GF(2^m).
+//
+// The decoder is a textbook errors-and-erasures decoder: syndromes are
+// computed by Horner's rule from the remainder of the received word, the
+// errata locator by Berlekamp-Massey seeded with the erasure locator, its
+// roots by a Chien search over the (possibly shortened) codeword positions
+// and the error values by Forney's algorithm.
+//
+// The GMD decoder instead solves the key equation as a two element Groebner
+// basis of its solutions, built one syndrome at a time as Berlekamp-Massey
+// is, to which erasures can be added one at a time afterwards. Erasing two
+// more symbols is then two O(nparity) basis updates rather than a new run of
+// Berlekamp-Massey.
+//
+// The encoder LFSR, which also yields the remainder for the syndromes, has
+// several kernels. The scalar kernel shifts the register a byte at a time
+// and adds a row of the generator product table. The lanes kernel does the
+// same for four codewords of a batch at once, so their table lookups
+// overlap. The SSSE3 kernel keeps the register in up to four SSE registers
+// and shifts it with palignr, adding rows of a copy of the table padded to
+// 16 bytes per register, and likewise runs batches four codewords at a
+// time, since a single register spends most of its time waiting on the
+// feedback of the previous symbol.
+//
+// Each kernel has an entry point for a single message in a table which is
+// filled in by a constructor when the library is loaded, from the CPU
+// features and RS_CODEC_KERNEL, so picking a kernel never costs more than
+// an indirect call.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RS_CODEC_X86
+#endif
+
+#include "rs_codec.h"
+#include "rs_probes.h"
+#include "rs_registry.h"
+
+// Codewords re-encoded at a time by rs_codec_check_batch().
+#define CHECK_GROUP             (16)
+
+// Coefficients of a key equation basis polynomial: np syndromes and up to
+// np erasures each raise the degree of one of the two by one.
+#define KEY_LENGTH              (2 * RS_CODEC_MAX_PARITY + 2)
+
+// Solutions (lambda, omega) of omega = s * lambda mod x^np, lambda with
+// roots at the erasures so far, as a Groebner basis of two. The leading
+// term of a solution is lambda's if deg(lambda) > deg(omega), otherwise
+// omega's; the two solutions have one of each, and the errata locator is
+// the lambda of the one led by lambda.
+typedef struct key_basis {
+    uint8_t a[2][KEY_LENGTH];   // lambda, lowest degree first
+    uint8_t b[2][KEY_LENGTH];   // omega
+    int degA[2];                // -1 for zero
+    int degB[2];
+} key_basis_t;
+
+// Statistics hooks, which compile to nothing unless RS_CODEC_STATS is set.
+#if defined(RS_CODEC_STATS)
+#define STATS_BEGIN(codec) \
+        uint64_t statsStart = (codec)->stats != NULL ? rs_stats_cycles() : 0
+#define STATS_ENCODED(codec) \
+        do { \
+            if ((codec)->stats != NULL) { \
+                __atomic_fetch_add(&(codec)->stats->encoded, 1, \
+                                   __ATOMIC_RELAXED); \
+                rs_stats_record(&(codec)->stats->encodeCycles, \
+                                rs_stats_cycles() - statsStart); \
+            } \
+        } while (0)
+#define STATS_ENCODED_BATCH(codec, count) \
+        do { \
+            if ((codec)->stats != NULL) { \
+                __atomic_fetch_add(&(codec)->stats->encoded, \
+                                   (uint64_t) (count), __ATOMIC_RELAXED); \
+                rs_stats_record(&(codec)->stats->encodeCycles, \
+                                rs_stats_cycles() - statsStart); \
+            } \
+        } while (0)
+#define STATS_DECODED(codec, result, nerasures) \
+        do { \
+            if ((codec)->stats != NULL) { \
+                rs_stats_decoded((codec)->stats, (result), (nerasures), \
+                                 rs_stats_cycles() - statsStart); \
+            } \
+        } while (0)
+#else
+// The decode counts are still evaluated, as some are only kept for them
+#define STATS_BEGIN(codec)
+#define STATS_ENCODED(codec)
+#define STATS_ENCODED_BATCH(codec, count)
+#define STATS_DECODED(codec, result, nerasures) \
+        do { \
+            (void) (result); \
+            (void) (nerasures); \
+        } while (0)
+#endif
+
+// Position of a codeword index as a power of alpha, i.e. the log of its
+// error locator X = alpha^(n - 1 - index).
+static int locator_log(int nn, int n, int index);
+
+// Advance the encoder LFSR over count message symbols with the codec's
+// kernel.
+static void lfsr_run(const rs_codec_t * codec, const uint8_t * msg,
+                     size_t count, uint8_t * parity);
+
+// Run the LFSR over count messages as rs_codec_encode_batch(), four at a
+// time if the kernel has a four message entry point.
+static void lfsr_batch(const rs_codec_t * codec, const uint8_t * msg, int k,
+                       size_t msgStride, uint8_t * parity,
+                       size_t parityStride, int count);
+
+// Run the LFSR over messages of any lengths as rs_codec_encode_list(). The
+// four message entry point runs over the symbols of the shortest of each
+// four, and each message is finished on its own.
+static void lfsr_list(const rs_codec_t * codec, const uint8_t * const * msg,
+                      const int * k, uint8_t * const * parity, int count);
+
+// The scalar kernel.
+static void lfsr_scalar(const rs_codec_t * codec, const uint8_t * msg,
+                        size_t count, uint8_t * parity);
+
+// The lanes kernel: four registers over four messages of count symbols.
+static void lfsr_lanes(const rs_codec_t * codec, const uint8_t * const * msg,
+                       size_t count, uint8_t * const * parity);
+
+#if defined(RS_CODEC_X86)
+// The SSSE3 kernel, for one message and for four.
+static void lfsr_ssse3(const rs_codec_t * codec, const uint8_t * msg,
+                       size_t count, uint8_t * parity);
+static void lfsr_ssse3_lanes(const rs_codec_t * codec,
+                             const uint8_t * const * msg, size_t count,
+                             uint8_t * const * parity);
+#endif
+
+typedef void (*lfsr_fn)(const rs_codec_t * codec, const uint8_t * msg,
+                        size_t count, uint8_t * parity);
+typedef void (*lfsr_lanes_fn)(const rs_codec_t * codec,
+                              const uint8_t * const * msg, size_t count,
+                              uint8_t * const * parity);
+
+// Single message and four message entry points of each kernel the CPU
+// supports, otherwise NULL, and the default and forced kernels, set up by
+// resolve_kernels().
+static lfsr_fn lfsrKernels[RS_KERNEL_COUNT];
+static lfsr_lanes_fn lfsrLanesKernels[RS_KERNEL_COUNT];
+static int defaultKernel = RS_KERNEL_SCALAR;
+static int forcedKernel = -1;
+
+__attribute__((constructor))
+static void resolve_kernels(void);
+
+// Evaluate the syndromes of a remainder (received parity minus re-encoded
+// parity). Returns 0 if the remainder is zero, otherwise 1.
+static int remainder_syndromes(const rs_codec_t * codec, const uint8_t * rem,
+                               uint8_t * syndromes);
+
+// Locate and evaluate the errata of an n symbol codeword from its non-zero
+// syndromes. Fills indices and values with the non-zero corrections.
+//
+// @return  the number of corrections, otherwise a negative RS_ERR_ code.
+static int solve_errata(const rs_codec_t * codec, const uint8_t * s, int n,
+                        const int * erasures, int nerasures, int * indices,
+                        uint8_t * values);
+
+// Find the roots of an errata locator of at most degree np over the
+// positions of an n symbol codeword, and the errata values there by Forney.
+// Fills indices and values with the non-zero corrections.
+//
+// @return  the number of corrections, otherwise RS_ERR_UNCORRECTABLE.
+static int locate_errata(const rs_codec_t * codec, const uint8_t * s, int n,
+                         const uint8_t * lambda, int * indices,
+                         uint8_t * values);
+
+// Check that corrections account for the syndromes exactly, i.e. that
+// applying them leaves a codeword.
+static int errata_match(const rs_codec_t * codec, const uint8_t * s, int n,
+                        const int * indices, const uint8_t * values,
+                        int count);
+
+// Start a key equation basis from the syndromes, with no erasures.
+static void key_init(const rs_codec_t * codec, const uint8_t * s,
+                     key_basis_t * basis);
+
+// Add an erasure, by its locator log, to a key equation basis.
+static void key_erase(const rs_codec_t * codec, key_basis_t * basis,
+                      int xLog);
+
+// Restrict a key equation basis to the solutions meeting one more linear
+// constraint, delta[i] being its value at solution i, where multiplying a
+// solution by (c0 + c1 x) meets it. This is Koetter's update: the solution
+// with the lesser leading term among those not meeting it is multiplied,
+// the other has it cancelled out.
+static void key_constrain(const rs_field_t * field, key_basis_t * basis,
+                          const uint8_t * delta, uint8_t c0, uint8_t c1);
+
+// Order of the leading term of solution i of a key equation basis. At
+// equal degree, omega's term (whose degree counts one more) is the lesser.
+static int key_order(const key_basis_t * basis, int i);
+
+// Degree of a polynomial of at most degree max, -1 for zero.
+static int poly_degree(const uint8_t * p, int max);
+
+// Find the byte holding symbol index of a segment list.
+static uint8_t * segment_symbol(const struct iovec * segments, int count,
+                                size_t index);
+
+// Total length of a segment list, or SIZE_MAX if a segment is invalid.
+static size_t segment_length(const struct iovec * segments, int count);
+
+// Describe a frame as the segments of its codeword, message segments
+// first. Returns the number of message segments, or a negative RS_ERR_
+// code if the frame is too short for the layout.
+static int frame_segments(const rs_codec_t * codec, uint8_t * frame, int n,
+                          struct iovec * segments);
+
+int rs_codec_init(rs_codec_t * codec, int m, int nparity) {
+
+    return rs_codec_init_generator(codec, m, nparity, 0, RS_CODEC_DEFAULT_FCR,
+                                   RS_CODEC_DEFAULT_PRIM);
+}
+
+int rs_codec_init_generator(rs_codec_t * codec, int m, int nparity, int poly,
+                            int fcr, int prim) {
+
+    if (codec == NULL || m < RS_FIELD_MIN_M || m > RS_FIELD_MAX_M) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    int nn = (1 << m) - 1;
+    if (nparity < 1 || nparity > RS_CODEC_MAX_PARITY || nparity >= nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // The root step must be a unit mod nn so that every codeword position
+    // keeps a distinct locator
+    int a = prim;
+    int b = nn;
+    while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+    }
+    if (fcr < 0 || fcr >= nn || prim < 1 || prim >= nn || a != 1) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Contexts of the same code share their tables
+    const rs_tables_t * tables;
+    int err = rs_registry_acquire(m, nparity, poly, fcr, prim, &tables);
+    if (err) {
+        return err;
+    }
+
+    codec->field = &tables->field;
+    codec->m = m;
+    codec->nn = nn;
+    codec->nparity = nparity;
+    codec->fcr = fcr;
+    codec->prim = prim;
+    codec->tables = tables;
+    codec->genProducts = tables->products;
+    memcpy(codec->genpoly, tables->genpoly, (size_t) nparity + 1);
+    codec->layout = RS_LAYOUT_SUFFIX;
+    codec->layoutHeader = 0;
+    codec->layoutLead = 0;
+    codec->puncture = 0;
+    codec->npunctured = 0;
+    codec->stats = NULL;
+    codec->kernel = RS_KERNEL_SCALAR;
+    codec->lfsr = lfsr_scalar;
+    codec->kernelTable = NULL;
+
+    err = rs_codec_set_kernel(codec, rs_codec_default_kernel());
+    if (err == RS_ERR_NO_MEMORY) {
+        rs_registry_release(tables);
+        return err;
+    }
+
+    return 0;
+}
+
+void rs_codec_free(rs_codec_t * codec) {
+
+    if (codec == NULL) {
+        return;
+    }
+    rs_registry_release(codec->tables);
+    codec->tables = NULL;
+    codec->kernelTable = NULL;
+    codec->field = NULL;
+    codec->genProducts = NULL;
+}
+
+int rs_codec_kernel_supported(const rs_codec_t * codec, int kernel) {
+
+    if (kernel < 0 || kernel >= RS_KERNEL_COUNT ||
+        lfsrKernels[kernel] == NULL) {
+        return 0;
+    }
+    // The SSSE3 register holds at most 64 symbols
+    return kernel != RS_KERNEL_SSSE3 || codec->nparity <= 64;
+}
+
+static const char * const kernelNames[RS_KERNEL_COUNT] = {
+    "scalar", "lanes", "ssse3"
+};
+
+const char * rs_codec_kernel_name(int kernel) {
+
+    if (kernel < 0 || kernel >= RS_KERNEL_COUNT) {
+        return NULL;
+    }
+    return kernelNames[kernel];
+}
+
+int rs_codec_kernel_lookup(const char * name) {
+
+    for (int kernel = 0; kernel < RS_KERNEL_COUNT; kernel++) {
+        if (strcmp(name, kernelNames[kernel]) == 0) {
+            return kernel;
+        }
+    }
+    return -1;
+}
+
+int rs_codec_default_kernel(void) {
+
+    return forcedKernel >= 0 ? forcedKernel : defaultKernel;
+}
+
+int rs_codec_kernel_forced(void) {
+
+    return forcedKernel;
+}
+
+int rs_codec_set_kernel(rs_codec_t * codec, int kernel) {
+
+    if (!rs_codec_kernel_supported(codec, kernel)) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Rows padded to whole registers, with zeros past the parity so the
+    // spare bytes of the register stay zero
+    const uint8_t * table = NULL;
+    if (kernel == RS_KERNEL_SSSE3) {
+        table = rs_registry_padded(codec->tables);
+        if (table == NULL) {
+            return RS_ERR_NO_MEMORY;
+        }
+    }
+
+    codec->kernelTable = table;
+    codec->kernel = kernel;
+    codec->lfsr = lfsrKernels[kernel];
+
+    return 0;
+}
+
+int rs_codec_set_stats(rs_codec_t * codec, rs_codec_stats_t * stats) {
+
+#if defined(RS_CODEC_STATS)
+    codec->stats = stats;
+    return 0;
+#else
+    (void) codec;
+    (void) stats;
+    return RS_ERR_INVALID_ARGS;
+#endif
+}
+
+int rs_codec_encode(const rs_codec_t * codec, const uint8_t * msg, int k,
+                    uint8_t * parity) {
+
+    int np = codec->nparity;
+    if (k < 0 || k + np > codec->nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE3(encode__entry, k, np, codec->m);
+    uint64_t probeStart = RS_PROBE_CLOCK(encode__return);
+    STATS_BEGIN(codec);
+
+    memset(parity, 0, (size_t) np);
+    lfsr_run(codec, msg, (size_t) k, parity);
+
+    STATS_ENCODED(codec);
+    RS_PROBE4(encode__return, k, np, codec->m,
+              RS_PROBE_CLOCK(encode__return) - probeStart);
+
+    return 0;
+}
+
+int rs_codec_encode_batch(const rs_codec_t * codec, const uint8_t * msg,
+                          int k, size_t msgStride, uint8_t * parity,
+                          size_t parityStride, int count) {
+
+    int np = codec->nparity;
+    if (k < 0 || k + np > codec->nn || count < 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE3(encode__entry, k, np, codec->m);
+    uint64_t probeStart = RS_PROBE_CLOCK(encode__return);
+    STATS_BEGIN(codec);
+
+    lfsr_batch(codec, msg, k, msgStride, parity, parityStride, count);
+
+    STATS_ENCODED_BATCH(codec, count);
+    RS_PROBE4(encode__return, k, np, codec->m,
+              RS_PROBE_CLOCK(encode__return) - probeStart);
+
+    return 0;
+}
+
+int rs_codec_check_batch(const rs_codec_t * codec, const uint8_t * codewords,
+                         int n, size_t stride, int count, uint8_t * dirty) {
+
+    int np = codec->nparity;
+    if (n <= np || n > codec->nn || count < 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Re-encode a group at a time and compare with the received parity
+    uint8_t rem[CHECK_GROUP][RS_CODEC_MAX_PARITY];
+    int ndirty = 0;
+    for (int first = 0; first < count; first += CHECK_GROUP) {
+        int group = count - first < CHECK_GROUP ? count - first : CHECK_GROUP;
+        const uint8_t * base = codewords + (size_t) first * stride;
+        lfsr_batch(codec, base, n - np, stride, rem[0], sizeof(rem[0]),
+                   group);
+
+        for (int c = 0; c < group; c++) {
+            const uint8_t * received = base + (size_t) c * stride + n - np;
+            uint8_t diff = 0;
+            for (int j = 0; j < np; j++) {
+                diff |= rem[c][j] ^ received[j];
+            }
+            dirty[first + c] = diff != 0;
+            ndirty += diff != 0;
+        }
+    }
+
+    return ndirty;
+}
+
+static void lfsr_batch(const rs_codec_t * codec, const uint8_t * msg, int k,
+                       size_t msgStride, uint8_t * parity,
+                       size_t parityStride, int count) {
+
+    int np = codec->nparity;
+    int c = 0;
+    lfsr_lanes_fn lanes = lfsrLanesKernels[codec->kernel];
+    if (lanes != NULL) {
+        // The register of each lane is kept apart from its output, which
+        // may overlap the next message
+        for (; c + 4 <= count; c += 4) {
+            uint8_t reg[4][RS_CODEC_MAX_PARITY] = {{0}};
+            const uint8_t * msgs[4];
+            uint8_t * regs[4];
+            for (int l = 0; l < 4; l++) {
+                msgs[l] = msg + (size_t) (c + l) * msgStride;
+                regs[l] = reg[l];
+            }
+            lanes(codec, msgs, (size_t) k, regs);
+            for (int l = 0; l < 4; l++) {
+                memcpy(parity + (size_t) (c + l) * parityStride, reg[l],
+                       (size_t) np);
+            }
+        }
+    }
+    for (; c < count; c++) {
+        uint8_t * out = parity + (size_t) c * parityStride;
+        memset(out, 0, (size_t) np);
+        lfsr_run(codec, msg + (size_t) c * msgStride, (size_t) k, out);
+    }
+}
+
+int rs_codec_encode_list(const rs_codec_t * codec, const uint8_t * const * msg,
+                         const int * k, uint8_t * const * parity, int count) {
+
+    int np = codec->nparity;
+    if (count < 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    for (int c = 0; c < count; c++) {
+        if (k[c] < 0 || k[c] + np > codec->nn) {
+            return RS_ERR_INVALID_ARGS;
+        }
+    }
+
+    RS_PROBE3(encode__entry, count > 0 ? k[0] : 0, np, codec->m);
+    uint64_t probeStart = RS_PROBE_CLOCK(encode__return);
+    STATS_BEGIN(codec);
+
+    lfsr_list(codec, msg, k, parity, count);
+
+    STATS_ENCODED_BATCH(codec, count);
+    RS_PROBE4(encode__return, count > 0 ? k[0] : 0, np, codec->m,
+              RS_PROBE_CLOCK(encode__return) - probeStart);
+
+    return 0;
+}
+
+static void lfsr_list(const rs_codec_t * codec, const uint8_t * const * msg,
+                      const int * k, uint8_t * const * parity, int count) {
+
+    int np = codec->nparity;
+    int c = 0;
+    lfsr_lanes_fn lanes = lfsrLanesKernels[codec->kernel];
+    if (lanes != NULL) {
+        for (; c + 4 <= count; c += 4) {
+            uint8_t reg[4][RS_CODEC_MAX_PARITY] = {{0}};
+            uint8_t * regs[4];
+            int common = k[c];
+            for (int l = 0; l < 4; l++) {
+                regs[l] = reg[l];
+                common = k[c + l] < common ? k[c + l] : common;
+            }
+            lanes(codec, &msg[c], (size_t) common, regs);
+            for (int l = 0; l < 4; l++) {
+                lfsr_run(codec, msg[c + l] + common,
+                         (size_t) (k[c + l] - common), reg[l]);
+                memcpy(parity[c + l], reg[l], (size_t) np);
+            }
+        }
+    }
+    for (; c < count; c++) {
+        memset(parity[c], 0, (size_t) np);
+        lfsr_run(codec, msg[c], (size_t) k[c], parity[c]);
+    }
+}
+
+int rs_codec_encodev(const rs_codec_t * codec, const struct iovec * msg,
+                     int msgCount, const struct iovec * parity,
+                     int parityCount) {
+
+    int np = codec->nparity;
+    size_t k = segment_length(msg, msgCount);
+    if (k > (size_t) (codec->nn - np) ||
+        segment_length(parity, parityCount) != (size_t) np) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE3(encode__entry, (int) k, np, codec->m);
+    uint64_t probeStart = RS_PROBE_CLOCK(encode__return);
+    STATS_BEGIN(codec);
+
+    // The register carries over from one segment to the next
+    uint8_t reg[RS_CODEC_MAX_PARITY] = {0};
+    for (int i = 0; i < msgCount; i++) {
+        lfsr_run(codec, msg[i].iov_base, msg[i].iov_len, reg);
+    }
+
+    const uint8_t * from = reg;
+    for (int i = 0; i < parityCount; i++) {
+        memcpy(parity[i].iov_base, from, parity[i].iov_len);
+        from += parity[i].iov_len;
+    }
+
+    STATS_ENCODED(codec);
+    RS_PROBE4(encode__return, (int) k, np, codec->m,
+              RS_PROBE_CLOCK(encode__return) - probeStart);
+
+    return 0;
+}
+
+int rs_codec_set_layout(rs_codec_t * codec, int layout, int header,
+                        int lead) {
+
+    if (layout == RS_LAYOUT_SPLIT) {
+        if (header < 0 || header > codec->nn - codec->nparity ||
+            lead < 0 || lead > codec->nparity) {
+            return RS_ERR_INVALID_ARGS;
+        }
+    } else if (layout == RS_LAYOUT_SUFFIX || layout == RS_LAYOUT_PREFIX) {
+        header = 0;
+        lead = 0;
+    } else {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    codec->layout = layout;
+    codec->layoutHeader = header;
+    codec->layoutLead = lead;
+
+    return 0;
+}
+
+int rs_codec_encode_frame(const rs_codec_t * codec, uint8_t * frame, int n) {
+
+    struct iovec segments[4];
+    int msgCount = frame_segments(codec, frame, n, segments);
+    if (msgCount < 0) {
+        return msgCount;
+    }
+
+    return rs_codec_encodev(codec, segments, msgCount, &segments[msgCount],
+                            2);
+}
+
+int rs_codec_decode_frame(const rs_codec_t * codec, uint8_t * frame, int n,
+                          const int * erasures, int nerasures,
+                          int * positions) {
+
+    struct iovec segments[4];
+    int msgCount = frame_segments(codec, frame, n, segments);
+    if (msgCount < 0) {
+        return msgCount;
+    }
+    if (nerasures < 0 || nerasures > codec->nparity) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Map the erasures from frame to codeword indices
+    int mapped[RS_CODEC_MAX_PARITY];
+    for (int e = 0; e < nerasures; e++) {
+        if (erasures[e] < 0 || erasures[e] >= n) {
+            return RS_ERR_INVALID_ARGS;
+        }
+        const uint8_t * symbol = frame + erasures[e];
+        size_t index = 0;
+        for (int i = 0; i < msgCount + 2; i++) {
+            const uint8_t * base = segments[i].iov_base;
+            if (symbol >= base && symbol < base + segments[i].iov_len) {
+                mapped[e] = (int) (index + (size_t) (symbol - base));
+                break;
+            }
+            index += segments[i].iov_len;
+        }
+    }
+
+    int corrected = rs_codec_decodev(codec, segments, msgCount + 2, mapped,
+                                     nerasures, positions);
+
+    // And the corrected positions back again
+    for (int r = 0; positions != NULL && r < corrected; r++) {
+        size_t index = (size_t) positions[r];
+        for (int i = 0; i < msgCount + 2; i++) {
+            if (index < segments[i].iov_len) {
+                const uint8_t * base = segments[i].iov_base;
+                positions[r] = (int) (base + index - frame);
+                break;
+            }
+            index -= segments[i].iov_len;
+        }
+    }
+
+    return corrected;
+}
+
+int rs_codec_set_puncture(rs_codec_t * codec, uint64_t mask) {
+
+    int np = codec->nparity;
+    if (np < 64 && (mask >> np) != 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    int count = __builtin_popcountll(mask);
+    if (count >= np) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    codec->puncture = mask;
+    codec->npunctured = count;
+
+    return 0;
+}
+
+int rs_codec_encode_punctured(const rs_codec_t * codec, const uint8_t * msg,
+                              int k, uint8_t * parity) {
+
+    if (codec->puncture == 0) {
+        return rs_codec_encode(codec, msg, k, parity);
+    }
+
+    int np = codec->nparity;
+    if (k < 0 || k + np > codec->nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE3(encode__entry, k, np, codec->m);
+    uint64_t probeStart = RS_PROBE_CLOCK(encode__return);
+    STATS_BEGIN(codec);
+
+    uint8_t reg[RS_CODEC_MAX_PARITY] = {0};
+    lfsr_run(codec, msg, (size_t) k, reg);
+
+    int kept = 0;
+    for (int j = 0; j < np; j++) {
+        if (!((codec->puncture >> j) & 1)) {
+            parity[kept++] = reg[j];
+        }
+    }
+
+    STATS_ENCODED(codec);
+    RS_PROBE4(encode__return, k, np, codec->m,
+              RS_PROBE_CLOCK(encode__return) - probeStart);
+
+    return 0;
+}
+
+int rs_codec_decode_punctured(const rs_codec_t * codec, uint8_t * codeword,
+                              int n, const int * erasures, int nerasures,
+                              int * positions) {
+
+    int np = codec->nparity;
+    int k = n - (np - codec->npunctured);
+    if (k < 1 || k + np > codec->nn || nerasures < 0 ||
+        nerasures + codec->npunctured > np) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Where each parity symbol of the code is in the received codeword (-1
+    // if punctured), and the punctured symbols as erasures of the code
+    int slot[RS_CODEC_MAX_PARITY];
+    int erased[RS_CODEC_MAX_PARITY];
+    int nerased = 0;
+    int kept = 0;
+    for (int j = 0; j < np; j++) {
+        if ((codec->puncture >> j) & 1) {
+            slot[j] = -1;
+            erased[nerased++] = k + j;
+        } else {
+            slot[j] = k + kept++;
+        }
+    }
+    for (int e = 0; e < nerasures; e++) {
+        int index = erasures[e];
+        if (index < 0 || index >= n) {
+            return RS_ERR_INVALID_ARGS;
+        }
+        if (index >= k) {
+            int j = 0;
+            while (slot[j] != index) {
+                j++;
+            }
+            index = k + j;
+        }
+        erased[nerased++] = index;
+    }
+
+    RS_PROBE4(decode__entry, k, np, codec->m, nerased);
+    uint64_t probeStart = RS_PROBE_CLOCK(decode__return);
+    STATS_BEGIN(codec);
+
+    // Remainder of the whole code, the punctured symbols taken as zero.
+    // The codeword is clean if the received parity all matches the message
+    // re-encoded, whatever the punctured symbols would have been.
+    uint8_t rem[RS_CODEC_MAX_PARITY] = {0};
+    lfsr_run(codec, codeword, (size_t) k, rem);
+    uint8_t dirty = 0;
+    for (int j = 0; j < np; j++) {
+        if (slot[j] >= 0) {
+            rem[j] ^= codeword[slot[j]];
+            dirty |= rem[j];
+        }
+    }
+
+    uint8_t s[RS_CODEC_MAX_PARITY];
+    int corrected = dirty ? remainder_syndromes(codec, rem, s) : 0;
+
+    if (corrected > 0) {
+        int indices[RS_CODEC_MAX_PARITY];
+        uint8_t values[RS_CODEC_MAX_PARITY];
+        int found = solve_errata(codec, s, k + np, erased, nerased, indices,
+                                 values);
+
+        // Only the symbols actually received are corrected
+        corrected = found < 0 ? found : 0;
+        for (int r = 0; r < found; r++) {
+            int index = indices[r] < k ? indices[r] : slot[indices[r] - k];
+            if (index < 0) {
+                continue;
+            }
+            codeword[index] ^= values[r];
+            if (positions != NULL) {
+                positions[corrected] = index;
+            }
+            corrected++;
+            RS_PROBE3(correct, index, values[r], n);
+        }
+    }
+
+    STATS_DECODED(codec, corrected, nerased);
+    RS_PROBE5(decode__return, k, np, codec->m, corrected,
+              RS_PROBE_CLOCK(decode__return) - probeStart);
+
+    return corrected;
+}
+
+int rs_codec_syndromes(const rs_codec_t * codec, const uint8_t * codeword,
+                       int n, uint8_t * syndromes) {
+
+    int np = codec->nparity;
+
+    if (n <= np || n > codec->nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // The syndromes of a codeword equal those of its remainder modulo the
+    // generator, which is the received parity minus the parity re-encoded
+    // from the received message. This runs at encoder speed and leaves only
+    // np terms to evaluate at each root.
+    uint8_t rem[RS_CODEC_MAX_PARITY] = {0};
+    lfsr_run(codec, codeword, (size_t) (n - np), rem);
+    for (int j = 0; j < np; j++) {
+        rem[j] ^= codeword[n - np + j];
+    }
+
+    return remainder_syndromes(codec, rem, syndromes);
+}
+
+int rs_codec_decode(const rs_codec_t * codec, uint8_t * codeword, int n,
+                    const int * erasures, int nerasures, int * positions) {
+
+    if (nerasures < 0 || nerasures > codec->nparity) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE4(decode__entry, n - codec->nparity, codec->nparity, codec->m,
+              nerasures);
+    uint64_t probeStart = RS_PROBE_CLOCK(decode__return);
+    STATS_BEGIN(codec);
+
+    uint8_t s[RS_CODEC_MAX_PARITY];
+    int corrected = rs_codec_syndromes(codec, codeword, n, s);
+
+    if (corrected > 0) {
+        int indices[RS_CODEC_MAX_PARITY];
+        uint8_t values[RS_CODEC_MAX_PARITY];
+        corrected = solve_errata(codec, s, n, erasures, nerasures, indices,
+                                 values);
+
+        for (int r = 0; r < corrected; r++) {
+            codeword[indices[r]] ^= values[r];
+            if (positions != NULL) {
+                positions[r] = indices[r];
+            }
+            RS_PROBE3(correct, indices[r], values[r], n);
+        }
+    }
+
+    STATS_DECODED(codec, corrected, nerasures);
+    RS_PROBE5(decode__return, n - codec->nparity, codec->nparity, codec->m,
+              corrected, RS_PROBE_CLOCK(decode__return) - probeStart);
+
+    return corrected;
+}
+
+int rs_codec_decodev(const rs_codec_t * codec, const struct iovec * codeword,
+                     int count, const int * erasures, int nerasures,
+                     int * positions) {
+
+    int np = codec->nparity;
+    size_t n = segment_length(codeword, count);
+    if (n <= (size_t) np || n > (size_t) codec->nn ||
+        nerasures < 0 || nerasures > np) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE4(decode__entry, (int) n - np, np, codec->m, nerasures);
+    uint64_t probeStart = RS_PROBE_CLOCK(decode__return);
+    STATS_BEGIN(codec);
+
+    // Remainder: re-encode the message part across the segments, then add
+    // in the received parity wherever it lies
+    uint8_t rem[RS_CODEC_MAX_PARITY] = {0};
+    size_t k = n - (size_t) np;
+    size_t index = 0;
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t * base = codeword[i].iov_base;
+        size_t length = codeword[i].iov_len;
+        size_t inMsg = index < k ? k - index : 0;
+        if (inMsg > length) {
+            inMsg = length;
+        }
+        lfsr_run(codec, base, inMsg, rem);
+        for (size_t j = inMsg; j < length; j++) {
+            rem[index + j - k] ^= base[j];
+        }
+        index += length;
+    }
+
+    uint8_t s[RS_CODEC_MAX_PARITY];
+    int corrected = remainder_syndromes(codec, rem, s);
+
+    if (corrected > 0) {
+        int indices[RS_CODEC_MAX_PARITY];
+        uint8_t values[RS_CODEC_MAX_PARITY];
+        corrected = solve_errata(codec, s, (int) n, erasures, nerasures,
+                                 indices, values);
+
+        for (int r = 0; r < corrected; r++) {
+            *segment_symbol(codeword, count, (size_t) indices[r]) ^=
+                    values[r];
+            if (positions != NULL) {
+                positions[r] = indices[r];
+            }
+            RS_PROBE3(correct, indices[r], values[r], (int) n);
+        }
+    }
+
+    STATS_DECODED(codec, corrected, nerasures);
+    RS_PROBE5(decode__return, (int) n - np, np, codec->m, corrected,
+              RS_PROBE_CLOCK(decode__return) - probeStart);
+
+    return corrected;
+}
+
+int rs_codec_decode_chase(const rs_codec_t * codec, uint8_t * codeword, int n,
+                          const float * reliability, int nweak, int trials,
+                          int * positions) {
+
+    int np = codec->nparity;
+    if (n <= np || n > codec->nn || reliability == NULL || nweak < 1 ||
+        nweak > np || nweak > RS_CODEC_MAX_CHASE || trials < 1 ||
+        trials > (1 << nweak)) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE4(decode__entry, n - np, np, codec->m, 0);
+    uint64_t probeStart = RS_PROBE_CLOCK(decode__return);
+    STATS_BEGIN(codec);
+
+    uint8_t s[RS_CODEC_MAX_PARITY];
+    int corrected = rs_codec_syndromes(codec, codeword, n, s);
+    int bestErasures = 0;
+
+    if (corrected > 0) {
+        // The least reliable symbols, least reliable first
+        int weak[RS_CODEC_MAX_CHASE];
+        int count = 0;
+        for (int i = 0; i < n; i++) {
+            float r = reliability[i];
+            if (count == nweak && r >= reliability[weak[count - 1]]) {
+                continue;
+            }
+            int j = count < nweak ? count++ : count - 1;
+            for (; j > 0 && reliability[weak[j - 1]] > r; j--) {
+                weak[j] = weak[j - 1];
+            }
+            weak[j] = i;
+        }
+
+        // Every pattern solves the same syndromes
+        int best[RS_CODEC_MAX_PARITY];
+        uint8_t bestValues[RS_CODEC_MAX_PARITY];
+        float bestCost = 0;
+        corrected = RS_ERR_UNCORRECTABLE;
+
+        for (int t = 0; t < trials; t++) {
+            int erasures[RS_CODEC_MAX_CHASE];
+            int nerasures = 0;
+            for (int b = 0; b < nweak; b++) {
+                if ((t >> b) & 1) {
+                    erasures[nerasures++] = weak[b];
+                }
+            }
+
+            int indices[RS_CODEC_MAX_PARITY];
+            uint8_t values[RS_CODEC_MAX_PARITY];
+            int found = solve_errata(codec, s, n, erasures, nerasures,
+                                     indices, values);
+            if (found < 0 ||
+                !errata_match(codec, s, n, indices, values, found)) {
+                continue;
+            }
+
+            float cost = 0;
+            for (int r = 0; r < found; r++) {
+                cost += reliability[indices[r]];
+            }
+            if (corrected < 0 || cost < bestCost) {
+                memcpy(best, indices, (size_t) found * sizeof(int));
+                memcpy(bestValues, values, (size_t) found);
+                bestCost = cost;
+                corrected = found;
+                bestErasures = nerasures;
+            }
+        }
+
+        for (int r = 0; r < corrected; r++) {
+            codeword[best[r]] ^= bestValues[r];
+            if (positions != NULL) {
+                positions[r] = best[r];
+            }
+            RS_PROBE3(correct, best[r], bestValues[r], n);
+        }
+    }
+
+    STATS_DECODED(codec, corrected, bestErasures);
+    RS_PROBE5(decode__return, n - np, np, codec->m, corrected,
+              RS_PROBE_CLOCK(decode__return) - probeStart);
+
+    return corrected;
+}
+
+int rs_codec_decode_gmd(const rs_codec_t * codec, uint8_t * codeword, int n,
+                        const float * reliability, int * positions) {
+
+    const rs_field_t * field = codec->field;
+    int np = codec->nparity;
+    if (n <= np || n > codec->nn || reliability == NULL) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    RS_PROBE4(decode__entry, n - np, np, codec->m, 0);
+    uint64_t probeStart = RS_PROBE_CLOCK(decode__return);
+    STATS_BEGIN(codec);
+
+    uint8_t s[RS_CODEC_MAX_PARITY];
+    int corrected = rs_codec_syndromes(codec, codeword, n, s);
+    int nerasures = 0;
+
+    if (corrected > 0) {
+        // The np least reliable symbols, least reliable first, and the
+        // reliabilities scaled to 0..1 for the acceptance test
+        int weak[RS_CODEC_MAX_PARITY];
+        int count = 0;
+        float peak = 0;
+        for (int i = 0; i < n; i++) {
+            float r = reliability[i];
+            if (r > peak) {
+                peak = r;
+            }
+            if (count == np && r >= reliability[weak[count - 1]]) {
+                continue;
+            }
+            int j = count < np ? count++ : count - 1;
+            for (; j > 0 && reliability[weak[j - 1]] > r; j--) {
+                weak[j] = weak[j - 1];
+            }
+            weak[j] = i;
+        }
+        float scale = peak > 0 ? 1 / peak : 0;
+        float total = 0;
+        for (int i = 0; i < n; i++) {
+            total += peak > 0 ? reliability[i] * scale : 1;
+        }
+
+        // A codeword whose corrected symbols' scaled reliabilities sum to
+        // less than this is the only one that can (Forney's GMD criterion:
+        // agreements minus disagreements, weighted, exceed n - d), so the
+        // search stops there
+        float accept = (total - (float) (n - np - 1)) / 2;
+
+        key_basis_t basis;
+        key_init(codec, s, &basis);
+
+        int best[RS_CODEC_MAX_PARITY];
+        uint8_t bestValues[RS_CODEC_MAX_PARITY];
+        float bestCost = 0;
+        corrected = RS_ERR_UNCORRECTABLE;
+
+        for (int e = 0; e <= np; e += 2) {
+            if (e > 0) {
+                for (int w = e - 2; w < e; w++) {
+                    key_erase(codec, &basis, codec->prim *
+                              locator_log(codec->nn, n, weak[w]) % codec->nn);
+                }
+            }
+
+            // The errata locator must leave e + 2 * errors <= np
+            int l = basis.degA[0] >= basis.degB[0] + 1 ? 0 : 1;
+            int deg = basis.degA[l];
+            if (deg < 1 || 2 * deg - e > np || basis.a[l][0] == 0) {
+                continue;
+            }
+            uint8_t lambda[RS_CODEC_MAX_PARITY + 1] = {0};
+            uint8_t norm = rs_field_div(field, 1, basis.a[l][0]);
+            for (int j = 0; j <= deg; j++) {
+                lambda[j] = rs_field_mul(field, norm, basis.a[l][j]);
+            }
+
+            int indices[RS_CODEC_MAX_PARITY];
+            uint8_t values[RS_CODEC_MAX_PARITY];
+            int found = locate_errata(codec, s, n, lambda, indices, values);
+            if (found < 0 ||
+                !errata_match(codec, s, n, indices, values, found)) {
+                continue;
+            }
+
+            float cost = 0;
+            for (int r = 0; r < found; r++) {
+                cost += peak > 0 ? reliability[indices[r]] * scale : 1;
+            }
+            if (corrected < 0 || cost < bestCost) {
+                memcpy(best, indices, (size_t) found * sizeof(int));
+                memcpy(bestValues, values, (size_t) found);
+                bestCost = cost;
+                corrected = found;
+                nerasures = e;
+            }
+            if (bestCost < accept) {
+                break;
+            }
+        }
+
+        for (int r = 0; r < corrected; r++) {
+            codeword[best[r]] ^= bestValues[r];
+            if (positions != NULL) {
+                positions[r] = best[r];
+            }
+            RS_PROBE3(correct, best[r], bestValues[r], n);
+        }
+    }
+
+    STATS_DECODED(codec, corrected, nerasures);
+    RS_PROBE5(decode__return, n - np, np, codec->m, corrected,
+              RS_PROBE_CLOCK(decode__return) - probeStart);
+
+    return corrected;
+}
+
+static int remainder_syndromes(const rs_codec_t * codec, const uint8_t * rem,
+                               uint8_t * syndromes) {
+
+    const rs_field_t * field = codec->field;
+    int np = codec->nparity;
+
+    int nonZero = 0;
+    for (int j = 0; j < np; j++) {
+        nonZero |= rem[j];
+    }
+    if (nonZero == 0 || syndromes == NULL) {
+        if (syndromes != NULL) {
+            memset(syndromes, 0, (size_t) np);
+        }
+        return nonZero != 0;
+    }
+
+    for (int i = 0; i < np; i++) {
+        int rootLog = (codec->prim * (codec->fcr + i)) % codec->nn;
+        uint8_t s = rem[0];
+
+        for (int j = 1; j < np; j++) {
+            // s = s * alpha^rootLog + rem[j]
+            if (s != 0) {
+                s = field->exp[field->log[s] + rootLog];
+            }
+            s ^= rem[j];
+        }
+        syndromes[i] = s;
+    }
+
+    return 1;
+}
+
+static int solve_errata(const rs_codec_t * codec, const uint8_t * s, int n,
+                        const int * erasures, int nerasures, int * indices,
+                        uint8_t * values) {
+
+    const rs_field_t * field = codec->field;
+    int nn = codec->nn;
+    int np = codec->nparity;
+    int prim = codec->prim;
+
+    // The syndromes see the error at locator X as X^prim, so the locators
+    // below are all X^prim. Errata locator lambda(x), lowest degree first,
+    // seeded with the erasure locator prod(1 + X_i x)
+    uint8_t lambda[RS_CODEC_MAX_PARITY + 1] = {0};
+    uint8_t b[RS_CODEC_MAX_PARITY + 1] = {0};
+    uint8_t tmp[RS_CODEC_MAX_PARITY + 1];
+    lambda[0] = 1;
+
+    for (int e = 0; e < nerasures; e++) {
+        if (erasures[e] < 0 || erasures[e] >= n) {
+            return RS_ERR_INVALID_ARGS;
+        }
+        uint8_t x = field->exp[prim * locator_log(nn, n, erasures[e]) % nn];
+        for (int j = e + 1; j > 0; j--) {
+            lambda[j] ^= rs_field_mul(field, x, lambda[j - 1]);
+        }
+    }
+
+    // Berlekamp-Massey
+    memcpy(b, lambda, sizeof(b));
+    int el = nerasures;
+
+    for (int r = nerasures + 1; r <= np; r++) {
+        uint8_t discr = 0;
+        for (int i = 0; i < r; i++) {
+            discr ^= rs_field_mul(field, lambda[i], s[r - 1 - i]);
+        }
+
+        if (discr == 0) {
+            // b(x) = x * b(x)
+            memmove(&b[1], b, (size_t) np);
+            b[0] = 0;
+            continue;
+        }
+
+        // tmp(x) = lambda(x) - discr * x * b(x)
+        tmp[0] = lambda[0];
+        for (int i = 0; i < np; i++) {
+            tmp[i + 1] = lambda[i + 1] ^ rs_field_mul(field, discr, b[i]);
+        }
+
+        if (2 * el <= r + nerasures - 1) {
+            el = r + nerasures - el;
+            // b(x) = lambda(x) / discr
+            for (int i = 0; i <= np; i++) {
+                b[i] = rs_field_div(field, lambda[i], discr);
+            }
+        } else {
+            memmove(&b[1], b, (size_t) np);
+            b[0] = 0;
+        }
+        memcpy(lambda, tmp, sizeof(tmp));
+    }
+
+    // Beyond the code's capability the register length can outgrow what
+    // the syndromes determine, or lambda fall short of it, and the roots
+    // found would not make a codeword
+    if (2 * el > np + nerasures || poly_degree(lambda, np) != el) {
+        return RS_ERR_UNCORRECTABLE;
+    }
+
+    return locate_errata(codec, s, n, lambda, indices, values);
+}
+
+static int locate_errata(const rs_codec_t * codec, const uint8_t * s, int n,
+                         const uint8_t * lambda, int * indices,
+                         uint8_t * values) {
+
+    const rs_field_t * field = codec->field;
+    int nn = codec->nn;
+    int np = codec->nparity;
+    int prim = codec->prim;
+
+    int degLambda = 0;
+    for (int i = 0; i <= np; i++) {
+        if (lambda[i] != 0) {
+            degLambda = i;
+        }
+    }
+    if (degLambda == 0) {
+        // Non-zero syndromes but no errata located
+        return RS_ERR_UNCORRECTABLE;
+    }
+
+    // Chien search. reg[j] holds lambda[j] * X^-j for the current position,
+    // walking positions from the last symbol (X = 1) backwards, each step
+    // multiplying X by alpha^prim.
+    int reg[RS_CODEC_MAX_PARITY + 1];
+    for (int j = 0; j <= degLambda; j++) {
+        reg[j] = lambda[j] ? field->log[lambda[j]] : -1;
+    }
+
+    int locs[RS_CODEC_MAX_PARITY];
+    int nroots = 0;
+
+    for (int d = 0; d < n && nroots < degLambda; d++) {
+        uint8_t sum = lambda[0];
+        for (int j = 1; j <= degLambda; j++) {
+            if (reg[j] >= 0) {
+                sum ^= field->exp[reg[j]];
+                // Step to the next position: multiply by alpha^(-prim * j)
+                reg[j] = (reg[j] + nn - prim * j % nn) % nn;
+            }
+        }
+        if (sum == 0) {
+            locs[nroots++] = d;
+        }
+    }
+    if (nroots != degLambda) {
+        return RS_ERR_UNCORRECTABLE;
+    }
+
+    // omega(x) = s(x) * lambda(x) mod x^np
+    uint8_t omega[RS_CODEC_MAX_PARITY];
+    for (int i = 0; i < np; i++) {
+        uint8_t o = 0;
+        for (int j = 0; j <= i && j <= degLambda; j++) {
+            o ^= rs_field_mul(field, s[i - j], lambda[j]);
+        }
+        omega[i] = o;
+    }
+
+    // Forney: e = X^(1 - fcr) * omega(X^-1) / lambda'(X^-1)
+    int corrected = 0;
+    for (int r = 0; r < nroots; r++) {
+        int xLog = prim * locs[r] % nn;
+        int xInvLog = (nn - xLog) % nn;
+
+        uint8_t num = 0;
+        for (int i = np - 1; i >= 0; i--) {
+            num = rs_field_mul(field, num, field->exp[xInvLog]) ^ omega[i];
+        }
+
+        // Formal derivative keeps only the odd terms
+        uint8_t den = 0;
+        for (int j = 1; j <= degLambda; j += 2) {
+            if (lambda[j] != 0) {
+                den ^= field->exp[(field->log[lambda[j]] +
+                                   xInvLog * (j - 1)) % nn];
+            }
+        }
+        if (den == 0) {
+            return RS_ERR_UNCORRECTABLE;
+        }
+
+        int scaleLog = (xLog * ((1 - codec->fcr) % nn + nn)) % nn;
+        uint8_t value = rs_field_mul(field, rs_field_div(field, num, den),
+                                     field->exp[scaleLog]);
+        if (value != 0) {
+            indices[corrected] = n - 1 - locs[r];
+            values[corrected] = value;
+            corrected++;
+        }
+    }
+
+    return corrected;
+}
+
+static int errata_match(const rs_codec_t * codec, const uint8_t * s, int n,
+                        const int * indices, const uint8_t * values,
+                        int count) {
+
+    const rs_field_t * field = codec->field;
+    int nn = codec->nn;
+
+    // Syndrome i of an error e at locator X is e * X^(prim * (fcr + i))
+    for (int i = 0; i < codec->nparity; i++) {
+        int rootLog = (codec->prim * (codec->fcr + i)) % nn;
+        uint8_t sum = s[i];
+        for (int r = 0; r < count; r++) {
+            int power = locator_log(nn, n, indices[r]) * rootLog % nn;
+            sum ^= field->exp[(field->log[values[r]] + power) % nn];
+        }
+        if (sum != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void key_init(const rs_codec_t * codec, const uint8_t * s,
+                     key_basis_t * basis) {
+
+    const rs_field_t * field = codec->field;
+
+    // (1, 0) and (0, 1) span every (lambda, omega), then the solutions of
+    // omega = s * lambda mod x^(r + 1) are kept at each r. Multiplying by x
+    // meets the constraint at r, as a solution mod x^r has none below it.
+    memset(basis, 0, sizeof(*basis));
+    basis->a[0][0] = 1;
+    basis->degA[0] = 0;
+    basis->degB[0] = -1;
+    basis->b[1][0] = 1;
+    basis->degA[1] = -1;
+    basis->degB[1] = 0;
+
+    for (int r = 0; r < codec->nparity; r++) {
+        // Coefficient of x^r in s * lambda - omega
+        uint8_t delta[2];
+        for (int i = 0; i < 2; i++) {
+            uint8_t d = basis->b[i][r];
+            for (int j = 0; j <= basis->degA[i] && j <= r; j++) {
+                d ^= rs_field_mul(field, s[r - j], basis->a[i][j]);
+            }
+            delta[i] = d;
+        }
+        key_constrain(field, basis, delta, 0, 1);
+    }
+}
+
+static void key_erase(const rs_codec_t * codec, key_basis_t * basis,
+                      int xLog) {
+
+    const rs_field_t * field = codec->field;
+    int nn = codec->nn;
+
+    // lambda(X^-1) = 0, met by multiplying by (1 + X x)
+    uint8_t xInv = field->exp[(nn - xLog) % nn];
+    uint8_t delta[2];
+    for (int i = 0; i < 2; i++) {
+        uint8_t d = 0;
+        for (int j = basis->degA[i]; j >= 0; j--) {
+            d = rs_field_mul(field, d, xInv) ^ basis->a[i][j];
+        }
+        delta[i] = d;
+    }
+    key_constrain(field, basis, delta, 1, field->exp[xLog]);
+}
+
+static void key_constrain(const rs_field_t * field, key_basis_t * basis,
+                          const uint8_t * delta, uint8_t c0, uint8_t c1) {
+
+    int p = -1;
+    for (int i = 0; i < 2; i++) {
+        if (delta[i] != 0 &&
+            (p < 0 || key_order(basis, i) < key_order(basis, p))) {
+            p = i;
+        }
+    }
+    if (p < 0) {
+        return;
+    }
+
+    // The other = delta[p] * other - delta[other] * pivot, whose leading
+    // term is unchanged since the pivot's is the lesser
+    int o = 1 - p;
+    if (delta[o] != 0) {
+        int degA = basis->degA[o] > basis->degA[p] ? basis->degA[o] :
+                                                     basis->degA[p];
+        int degB = basis->degB[o] > basis->degB[p] ? basis->degB[o] :
+                                                     basis->degB[p];
+        for (int j = 0; j <= degA; j++) {
+            basis->a[o][j] = rs_field_mul(field, delta[p], basis->a[o][j]) ^
+                             rs_field_mul(field, delta[o], basis->a[p][j]);
+        }
+        for (int j = 0; j <= degB; j++) {
+            basis->b[o][j] = rs_field_mul(field, delta[p], basis->b[o][j]) ^
+                             rs_field_mul(field, delta[o], basis->b[p][j]);
+        }
+        basis->degA[o] = poly_degree(basis->a[o], degA);
+        basis->degB[o] = poly_degree(basis->b[o], degB);
+    }
+
+    // pivot = (c0 + c1 x) * pivot
+    uint8_t * a = basis->a[p];
+    uint8_t * b = basis->b[p];
+    for (int j = basis->degA[p] + 1; j > 0; j--) {
+        a[j] = rs_field_mul(field, c0, a[j]) ^ rs_field_mul(field, c1, a[j - 1]);
+    }
+    a[0] = rs_field_mul(field, c0, a[0]);
+    for (int j = basis->degB[p] + 1; j > 0; j--) {
+        b[j] = rs_field_mul(field, c0, b[j]) ^ rs_field_mul(field, c1, b[j - 1]);
+    }
+    b[0] = rs_field_mul(field, c0, b[0]);
+    basis->degA[p] += basis->degA[p] >= 0;
+    basis->degB[p] += basis->degB[p] >= 0;
+}
+
+static int key_order(const key_basis_t * basis, int i) {
+
+    int degA = basis->degA[i];
+    int degB = basis->degB[i] + 1;
+
+    return degA >= degB ? 2 * degA + 1 : 2 * degB;
+}
+
+static int poly_degree(const uint8_t * p, int max) {
+
+    while (max >= 0 && p[max] == 0) {
+        max--;
+    }
+    return max;
+}
+
+static int locator_log(int nn, int n, int index) {
+
+    return (n - 1 - index) % nn;
+}
+
+static void resolve_kernels(void) {
+
+    lfsrKernels[RS_KERNEL_SCALAR] = lfsr_scalar;
+    // The lanes kernel only differs for batches
+    lfsrKernels[RS_KERNEL_LANES] = lfsr_scalar;
+    lfsrLanesKernels[RS_KERNEL_LANES] = lfsr_lanes;
+
+#if defined(RS_CODEC_X86)
+    // Constructors may run before the CPU model is, so initialise it here
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        lfsrKernels[RS_KERNEL_SSSE3] = lfsr_ssse3;
+        lfsrLanesKernels[RS_KERNEL_SSSE3] = lfsr_ssse3_lanes;
+        defaultKernel = RS_KERNEL_SSSE3;
+    }
+#endif
+
+    const char * name = getenv(RS_CODEC_KERNEL_ENV);
+    if (name != NULL) {
+        int kernel = rs_codec_kernel_lookup(name);
+        if (kernel >= 0 && lfsrKernels[kernel] != NULL) {
+            forcedKernel = kernel;
+        }
+    }
+}
+
+static void lfsr_run(const rs_codec_t * codec, const uint8_t * msg,
+                     size_t count, uint8_t * parity) {
+
+    codec->lfsr(codec, msg, count, parity);
+}
+
+static void lfsr_scalar(const rs_codec_t * codec, const uint8_t * msg,
+                        size_t count, uint8_t * parity) {
+
+    int np = codec->nparity;
+
+    // Same LFSR as rs_encode_message(). Leading zeros of a shortened code
+    // leave the register at zero so they are skipped entirely.
+    for (size_t i = 0; i < count; i++) {
+        int feedback = (msg[i] ^ parity[0]) & codec->nn;
+        const uint8_t * row = &codec->genProducts[feedback * np];
+
+        for (int j = 0; j < np - 1; j++) {
+            parity[j] = parity[j + 1] ^ row[j];
+        }
+        parity[np - 1] = row[np - 1];
+    }
+}
+
+static void lfsr_lanes(const rs_codec_t * codec, const uint8_t * const * msg,
+                       size_t count, uint8_t * const * parity) {
+
+    int np = codec->nparity;
+    int nn = codec->nn;
+    uint8_t * p0 = parity[0];
+    uint8_t * p1 = parity[1];
+    uint8_t * p2 = parity[2];
+    uint8_t * p3 = parity[3];
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t * r0 = &codec->genProducts[((msg[0][i] ^ p0[0]) & nn) *
+                                                 np];
+        const uint8_t * r1 = &codec->genProducts[((msg[1][i] ^ p1[0]) & nn) *
+                                                 np];
+        const uint8_t * r2 = &codec->genProducts[((msg[2][i] ^ p2[0]) & nn) *
+                                                 np];
+        const uint8_t * r3 = &codec->genProducts[((msg[3][i] ^ p3[0]) & nn) *
+                                                 np];
+
+        for (int j = 0; j < np - 1; j++) {
+            p0[j] = p0[j + 1] ^ r0[j];
+            p1[j] = p1[j + 1] ^ r1[j];
+            p2[j] = p2[j + 1] ^ r2[j];
+            p3[j] = p3[j + 1] ^ r3[j];
+        }
+        p0[np - 1] = r0[np - 1];
+        p1[np - 1] = r1[np - 1];
+        p2[np - 1] = r2[np - 1];
+        p3[np - 1] = r3[np - 1];
+    }
+}
+
+#if defined(RS_CODEC_X86)
+// Run the SSSE3 kernel with the register in regs registers. Inlined into
+// a copy per register count so the registers stay in registers.
+__attribute__((target("ssse3"), always_inline))
+static inline void lfsr_ssse3_regs(const rs_codec_t * codec,
+                                   const uint8_t * msg, size_t count,
+                                   uint8_t * parity, int regs) {
+
+    int np = codec->nparity;
+    int nn = codec->nn;
+    size_t stride = (size_t) regs * 16;
+
+    uint8_t buffer[64] __attribute__((aligned(16))) = {0};
+    memcpy(buffer, parity, (size_t) np);
+    __m128i r[4];
+    for (int v = 0; v < regs; v++) {
+        r[v] = _mm_load_si128((const __m128i *) &buffer[v * 16]);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        int feedback = (msg[i] ^ _mm_cvtsi128_si32(r[0])) & nn;
+        const uint8_t * row = &codec->kernelTable[(size_t) feedback * stride];
+
+        // Shift the whole register down a byte and add the row
+        for (int v = 0; v < regs - 1; v++) {
+            r[v] = _mm_xor_si128(_mm_alignr_epi8(r[v + 1], r[v], 1),
+                                 _mm_load_si128((const __m128i *)
+                                                &row[v * 16]));
+        }
+        r[regs - 1] = _mm_xor_si128(_mm_srli_si128(r[regs - 1], 1),
+                                    _mm_load_si128((const __m128i *)
+                                                   &row[(regs - 1) * 16]));
+    }
+
+    for (int v = 0; v < regs; v++) {
+        _mm_store_si128((__m128i *) &buffer[v * 16], r[v]);
+    }
+    memcpy(parity, buffer, (size_t) np);
+}
+
+// The same over four messages, whose registers are independent so their
+// feedback latencies overlap.
+__attribute__((target("ssse3"), always_inline))
+static inline void lfsr_ssse3_lanes_regs(const rs_codec_t * codec,
+                                         const uint8_t * const * msg,
+                                         size_t count,
+                                         uint8_t * const * parity, int regs) {
+
+    int np = codec->nparity;
+    int nn = codec->nn;
+    size_t stride = (size_t) regs * 16;
+
+    uint8_t buffer[64] __attribute__((aligned(16)));
+    __m128i r[4][4];
+    for (int l = 0; l < 4; l++) {
+        memset(buffer, 0, sizeof(buffer));
+        memcpy(buffer, parity[l], (size_t) np);
+        for (int v = 0; v < regs; v++) {
+            r[l][v] = _mm_load_si128((const __m128i *) &buffer[v * 16]);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t * row[4];
+        for (int l = 0; l < 4; l++) {
+            int feedback = (msg[l][i] ^ _mm_cvtsi128_si32(r[l][0])) & nn;
+            row[l] = &codec->kernelTable[(size_t) feedback * stride];
+        }
+        for (int l = 0; l < 4; l++) {
+            for (int v = 0; v < regs - 1; v++) {
+                r[l][v] = _mm_xor_si128(
+                        _mm_alignr_epi8(r[l][v + 1], r[l][v], 1),
+                        _mm_load_si128((const __m128i *) &row[l][v * 16]));
+            }
+            r[l][regs - 1] = _mm_xor_si128(
+                    _mm_srli_si128(r[l][regs - 1], 1),
+                    _mm_load_si128((const __m128i *)
+                                   &row[l][(regs - 1) * 16]));
+        }
+    }
+
+    for (int l = 0; l < 4; l++) {
+        for (int v = 0; v < regs; v++) {
+            _mm_store_si128((__m128i *) &buffer[v * 16], r[l][v]);
+        }
+        memcpy(parity[l], buffer, (size_t) np);
+    }
+}
+
+__attribute__((target("ssse3")))
+static void lfsr_ssse3_lanes(const rs_codec_t * codec,
+                             const uint8_t * const * msg, size_t count,
+                             uint8_t * const * parity) {
+
+    switch ((codec->nparity + 15) / 16) {
+        case 1:
+            lfsr_ssse3_lanes_regs(codec, msg, count, parity, 1);
+            break;
+        case 2:
+            lfsr_ssse3_lanes_regs(codec, msg, count, parity, 2);
+            break;
+        case 3:
+            lfsr_ssse3_lanes_regs(codec, msg, count, parity, 3);
+            break;
+        default:
+            lfsr_ssse3_lanes_regs(codec, msg, count, parity, 4);
+            break;
+    }
+}
+
+__attribute__((target("ssse3")))
+static void lfsr_ssse3(const rs_codec_t * codec, const uint8_t * msg,
+                       size_t count, uint8_t * parity) {
+
+    switch ((codec->nparity + 15) / 16) {
+        case 1:
+            lfsr_ssse3_regs(codec, msg, count, parity, 1);
+            break;
+        case 2:
+            lfsr_ssse3_regs(codec, msg, count, parity, 2);
+            break;
+        case 3:
+            lfsr_ssse3_regs(codec, msg, count, parity, 3);
+            break;
+        default:
+            lfsr_ssse3_regs(codec, msg, count, parity, 4);
+            break;
+    }
+}
+#endif
+
+static uint8_t * segment_symbol(const struct iovec * segments, int count,
+                                size_t index) {
+
+    for (int i = 0; i < count; i++) {
+        if (index < segments[i].iov_len) {
+            return (uint8_t *) segments[i].iov_base + index;
+        }
+        index -= segments[i].iov_len;
+    }
+    return NULL;
+}
+
+static size_t segment_length(const struct iovec * segments, int count) {
+
+    if (count < 0 || (count > 0 && segments == NULL)) {
+        return SIZE_MAX;
+    }
+
+    size_t length = 0;
+    for (int i = 0; i < count; i++) {
+        if (segments[i].iov_len > 0 && segments[i].iov_base == NULL) {
+            return SIZE_MAX;
+        }
+        length += segments[i].iov_len;
+    }
+    return length;
+}
+
+static int frame_segments(const rs_codec_t * codec, uint8_t * frame, int n,
+                          struct iovec * segments) {
+
+    int np = codec->nparity;
+    int header = codec->layoutHeader;
+    int lead = codec->layoutLead;
+
+    if (frame == NULL || n <= np || n > codec->nn ||
+        n - np < header) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    int k = n - np;
+
+    switch (codec->layout) {
+        case RS_LAYOUT_PREFIX:
+            segments[0].iov_base = frame + np;
+            segments[0].iov_len = (size_t) k;
+            segments[1].iov_base = frame;
+            segments[1].iov_len = (size_t) np;
+            segments[2].iov_base = frame + np;
+            segments[2].iov_len = 0;
+            return 1;
+
+        case RS_LAYOUT_SPLIT:
+            segments[0].iov_base = frame + lead;
+            segments[0].iov_len = (size_t) header;
+            segments[1].iov_base = frame + np + header;
+            segments[1].iov_len = (size_t) (k - header);
+            segments[2].iov_base = frame;
+            segments[2].iov_len = (size_t) lead;
+            segments[3].iov_base = frame + lead + header;
+            segments[3].iov_len = (size_t) (np - lead);
+            return 2;
+
+        default:
+            segments[0].iov_base = frame;
+            segments[0].iov_len = (size_t) k;
+            segments[1].iov_base = frame + k;
+            segments[1].iov_len = (size_t) np;
+            segments[2].iov_base = frame + n;
+            segments[2].iov_len = 0;
+            return 1;
+    }
+}
@@ -0,0 +1,399 @@
+//
+// General Reed-Solomon codec over GF(2^m), 3 <= m <= 8. Unlike
+// rs_encode_message(), the codec context builds its field and generator
+// tables at initialisation so any symbol size and parity count can be used,
+// and it provides a matching errors-and-erasures decoder.
+//
+// Codewords are systematic and laid out as in MATLAB rsenc(): the k message
+// symbols are followed by the parity symbols. Codewords shorter than
+// 2^m - 1 symbols are treated as shortened codes (implicit leading zeros),
+// so the message length can vary from call to call.
+//
+// The generator polynomial follows the MATLAB rsgenpoly() defaults, i.e. its
+// roots are alpha^1 .. alpha^(nparity), unless another field polynomial,
+// first root and root step are given to rs_codec_init_generator() (for
+// CCSDS, say, whose roots are alpha^(11 * (112 + i))).
+//
+// The tables are built once per distinct code and shared between contexts,
+// so creating a context for a code already in use is cheap.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_CODEC_H
+#define RS_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "rs_galois.h"
+#include "rs_stats.h"
+
+// Maximum number of parity symbols (2t) supported by a codec context.
+#define RS_CODEC_MAX_PARITY     (64)
+
+// The MATLAB rsgenpoly() generator, with roots alpha^1 .. alpha^(nparity).
+#define RS_CODEC_DEFAULT_FCR    (1)
+#define RS_CODEC_DEFAULT_PRIM   (1)
+
+// Maximum least reliable symbols rs_codec_decode_chase() considers.
+#define RS_CODEC_MAX_CHASE      (16)
+
+// Error codes. All codec functions return a negative value on failure.
+#define RS_ERR_INVALID_ARGS     (-1)
+#define RS_ERR_NO_MEMORY        (-2)
+#define RS_ERR_UNCORRECTABLE    (-3)
+#define RS_ERR_IO               (-4)
+#define RS_ERR_FORMAT           (-5)
+
+// Frame layouts, i.e. where the parity sits in a transmitted frame.
+#define RS_LAYOUT_SUFFIX        (0)     // message, parity (MATLAB rsenc())
+#define RS_LAYOUT_PREFIX        (1)     // parity, message
+#define RS_LAYOUT_SPLIT         (2)     // parity split around a header
+
+// Encoder kernels, i.e. how the LFSR is run. They all produce the same
+// parity; which is fastest depends on the host and the code, see rs_plan.h.
+// The kernels the CPU supports are found once, when the library is loaded,
+// and new contexts get the best of them unless the environment variable
+// RS_CODEC_KERNEL names another, e.g. RS_CODEC_KERNEL=scalar, to compare
+// kernels or reproduce a problem on any host.
+#define RS_KERNEL_SCALAR        (0)     // one table row per symbol
+#define RS_KERNEL_LANES         (1)     // batches run 4 codewords in step
+#define RS_KERNEL_SSSE3         (2)     // register held in SSE registers,
+                                        // batches 4 codewords in step
+#define RS_KERNEL_COUNT         (3)
+
+#define RS_CODEC_KERNEL_ENV     "RS_CODEC_KERNEL"
+
+typedef struct rs_codec {
+    const rs_field_t * field;   // GF(2^m) tables
+    int m;                      // bits per symbol
+    int nn;                     // maximum codeword length, 2^m - 1
+    int nparity;                // parity symbols per codeword (2t)
+    int fcr;                    // first consecutive root, as a power of the
+                                // root step below
+    int prim;                   // root step: roots are alpha^(prim * (fcr + i))
+
+    // Generator polynomial, highest degree first. genpoly[0] is always 1.
+    uint8_t genpoly[RS_CODEC_MAX_PARITY + 1];
+
+    // Product table of every field element with every generator coefficient
+    // (excluding the leading 1), laid out as [2^m][nparity]. This is the
+    // general form of GALOIS_PRODUCTS_4 and lets the encoder run with a
+    // single lookup per parity symbol.
+    const uint8_t * genProducts;
+
+    // The registry entry holding field, genProducts and kernelTable, which
+    // are shared by every context of the same code (see rs_registry.h).
+    const void * tables;
+
+    // Frame layout used by rs_codec_encode_frame() and
+    // rs_codec_decode_frame(), see rs_codec_set_layout().
+    int layout;
+    int layoutHeader;           // RS_LAYOUT_SPLIT header symbols
+    int layoutLead;             // RS_LAYOUT_SPLIT parity before the header
+
+    // Parity symbols left out by the punctured functions, see
+    // rs_codec_set_puncture().
+    uint64_t puncture;
+    int npunctured;
+
+    rs_codec_stats_t * stats;   // optional, see rs_codec_set_stats()
+
+    // Encoder kernel, see rs_codec_set_kernel(), its entry point for one
+    // message and the product table padded to whole vector registers per
+    // row if the kernel needs it.
+    int kernel;
+    void (*lfsr)(const struct rs_codec * codec, const uint8_t * msg,
+                 size_t count, uint8_t * parity);
+    const uint8_t * kernelTable;
+} rs_codec_t;
+
+// Initialise a codec context for m-bit symbols and nparity parity symbols.
+//
+// @param   codec: the context to initialise.
+// @param   m: bits per symbol, RS_FIELD_MIN_M..RS_FIELD_MAX_M.
+// @param   nparity: number of parity symbols, 1..RS_CODEC_MAX_PARITY and
+//                   less than 2^m - 1.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_init(rs_codec_t * codec, int m, int nparity);
+
+// Initialise a codec context with a given field and generator, whose roots
+// are alpha^(prim * (fcr + i)) for i = 0 .. nparity - 1.
+//
+// @param   poly: the primitive polynomial of GF(2^m), including the x^m term,
+//                or 0 for the default rs_field_default_poly(m).
+// @param   fcr: first consecutive root, 0..2^m - 2.
+// @param   prim: root step, 1..2^m - 2 and coprime with 2^m - 1.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_init_generator(rs_codec_t * codec, int m, int nparity, int poly,
+                            int fcr, int prim);
+
+// Release a codec context, and its tables once no other context uses them.
+void rs_codec_free(rs_codec_t * codec);
+
+// Attach a statistics block to a codec context, or detach it with NULL.
+// Every encode and decode call on the context is then counted and timed.
+// The block is not owned by the context and may be shared.
+//
+// @return  0 on success, RS_ERR_INVALID_ARGS if statistics were compiled
+//          out.
+int rs_codec_set_stats(rs_codec_t * codec, rs_codec_stats_t * stats);
+
+// Check whether an RS_KERNEL_ kernel can run on this CPU with this codec.
+//
+// @return  1 if so, otherwise 0.
+int rs_codec_kernel_supported(const rs_codec_t * codec, int kernel);
+
+// Name of an RS_KERNEL_ kernel, e.g. "ssse3", or NULL if it is unknown.
+const char * rs_codec_kernel_name(int kernel);
+
+// Look up a kernel by name.
+//
+// @return  an RS_KERNEL_ value, or -1 if the name is unknown.
+int rs_codec_kernel_lookup(const char * name);
+
+// The kernel rs_codec_init() selects: the one forced by RS_CODEC_KERNEL if
+// set (and supported), otherwise the best the CPU supports.
+int rs_codec_default_kernel(void);
+
+// The kernel forced by RS_CODEC_KERNEL, or -1 if none (or an unknown or
+// unsupported one) is.
+int rs_codec_kernel_forced(void);
+
+// Select the encoder kernel of a codec context, overriding the default.
+// The kernel is used for encoding and for the syndromes of the decoder.
+//
+// @return  0 on success, RS_ERR_INVALID_ARGS if the kernel is not supported
+//          (the context is then unchanged), RS_ERR_NO_MEMORY.
+int rs_codec_set_kernel(rs_codec_t * codec, int kernel);
+
+// Compute the parity symbols of a message. The parity buffer is overwritten
+// (it does not need to be zeroed first).
+//
+// @param   codec: an initialised codec context.
+// @param   msg: the k message symbols.
+// @param   k: number of message symbols. k + nparity must not exceed 2^m - 1.
+// @param   parity: output buffer for nparity symbols.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_encode(const rs_codec_t * codec, const uint8_t * msg, int k,
+                    uint8_t * parity);
+
+// Compute the parity of count messages of k symbols, the same as calling
+// rs_codec_encode() on each. Message c starts at msg + c * msgStride and
+// its parity is written to parity + c * parityStride, so a run of
+// contiguous codewords is encoded in place with both strides k + nparity
+// and parity = msg + k. With statistics attached the batch is counted as
+// count codewords but timed as a whole.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_encode_batch(const rs_codec_t * codec, const uint8_t * msg,
+                          int k, size_t msgStride, uint8_t * parity,
+                          size_t parityStride, int count);
+
+// Compute the parity of count messages given by pointers, each of its own
+// length, the same as calling rs_codec_encode() on each. Batches as
+// rs_codec_encode_batch() does, best when the lengths are similar.
+//
+// @param   msg: the count messages.
+// @param   k: the length of each message.
+// @param   parity: count output buffers for nparity symbols each.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_encode_list(const rs_codec_t * codec, const uint8_t * const * msg,
+                         const int * k, uint8_t * const * parity, int count);
+
+// Check count codewords of n symbols for errors by re-encoding them as a
+// batch, e.g. to pick out the few codewords of a stream that need
+// decoding. Codeword c starts at codewords + c * stride. Not counted in the
+// statistics.
+//
+// @param   dirty: receives count flags, 1 where a codeword has errors.
+// @return  the number of codewords with errors, otherwise a negative
+//          RS_ERR_ code.
+int rs_codec_check_batch(const rs_codec_t * codec, const uint8_t * codewords,
+                         int n, size_t stride, int count, uint8_t * dirty);
+
+// Compute the parity of a message gathered from a list of segments, e.g. a
+// header, payload and trailer in separate buffers, writing the parity
+// straight into its own list of segments (its place in the outgoing
+// packet). The encoder state runs on across segment boundaries, so the
+// result is the same as rs_codec_encode() on the concatenated message.
+//
+// @param   msg: msgCount segments holding the k message symbols in order.
+// @param   parity: parityCount segments whose lengths total nparity.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_encodev(const rs_codec_t * codec, const struct iovec * msg,
+                     int msgCount, const struct iovec * parity,
+                     int parityCount);
+
+// Set the frame layout of a codec context; rs_codec_init() selects
+// RS_LAYOUT_SUFFIX. The frame functions only permute where symbols are
+// stored, the codeword itself is still the message followed by the parity.
+//
+// With RS_LAYOUT_SPLIT a frame is laid out as
+//
+//   parity[0 .. lead-1], header, parity[lead .. nparity-1], payload
+//
+// where the header is the first header symbols of the message and the
+// payload the rest, so lead = 0 puts all of the parity between the header
+// and the payload.
+//
+// @param   layout: an RS_LAYOUT_ value.
+// @param   header: RS_LAYOUT_SPLIT header length, otherwise ignored.
+// @param   lead: RS_LAYOUT_SPLIT parity symbols before the header,
+//                0..nparity, otherwise ignored.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_set_layout(rs_codec_t * codec, int layout, int header, int lead);
+
+// Encode a frame in place. The message symbols must already be at their
+// places in the frame; the parity is written into its places.
+//
+// @param   frame: the n symbol frame.
+// @param   n: frame length, nparity < n <= 2^m - 1 (and, for
+//             RS_LAYOUT_SPLIT, at least the header plus nparity).
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_encode_frame(const rs_codec_t * codec, uint8_t * frame, int n);
+
+// Decode a frame in place. Erasures and positions are indices into the
+// frame.
+//
+// @return  as for rs_codec_decode().
+int rs_codec_decode_frame(const rs_codec_t * codec, uint8_t * frame, int n,
+                          const int * erasures, int nerasures,
+                          int * positions);
+
+// Set the puncturing pattern of a codec context, i.e. which of its parity
+// symbols rs_codec_encode_punctured() leaves out and
+// rs_codec_decode_punctured() puts back as erasures, so that one code
+// serves many rates. rs_codec_init() selects no puncturing, and the other
+// functions always use the whole code.
+//
+// @param   mask: bit j set to leave out parity symbol j, 0..nparity-1. At
+//                least one parity symbol must be kept.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_set_puncture(rs_codec_t * codec, uint64_t mask);
+
+// Compute the parity of a message, writing only the parity symbols the
+// puncturing pattern keeps, in order.
+//
+// @param   parity: output buffer for nparity - npunctured symbols.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_codec_encode_punctured(const rs_codec_t * codec, const uint8_t * msg,
+                              int k, uint8_t * parity);
+
+// Decode a punctured codeword in place: the message followed by the
+// parity symbols rs_codec_encode_punctured() wrote. The punctured symbols
+// are treated as erasures, so up to
+// (nparity - npunctured - nerasures) / 2 errors are corrected.
+//
+// @param   n: the received length, k + nparity - npunctured.
+// @param   erasures: indices (into codeword) of symbols known to be
+//                    unreliable, at most nparity - npunctured of them.
+// @param   positions: as for rs_codec_decode(), indices into codeword.
+// @return  as for rs_codec_decode(), not counting punctured symbols.
+int rs_codec_decode_punctured(const rs_codec_t * codec, uint8_t * codeword,
+                              int n, const int * erasures, int nerasures,
+                              int * positions);
+
+// Compute the syndromes of a received codeword.
+//
+// @param   codec: an initialised codec context.
+// @param   codeword: the n received symbols, message followed by parity.
+// @param   n: codeword length, nparity < n <= 2^m - 1.
+// @param   syndromes: output buffer for nparity syndromes. May be NULL if
+//                     only the check result is wanted.
+// @return  0 if the codeword is valid, 1 if any syndrome is non-zero,
+//          otherwise a negative RS_ERR_ code.
+int rs_codec_syndromes(const rs_codec_t * codec, const uint8_t * codeword,
+                       int n, uint8_t * syndromes);
+
+// Decode a received codeword in place, correcting up to
+// (nparity - nerasures) / 2 errors in addition to the given erasures.
+//
+// @param   codec: an initialised codec context.
+// @param   codeword: the n received symbols, corrected in place.
+// @param   n: codeword length, nparity < n <= 2^m - 1.
+// @param   erasures: indices (into codeword) of symbols known to be
+//                    unreliable. May be NULL if nerasures is 0.
+// @param   nerasures: number of erasures, at most nparity.
+// @param   positions: optional output of the indices of corrected symbols.
+//                     Must hold nparity elements if not NULL.
+// @return  the number of symbols corrected (>= 0), otherwise a negative
+//          RS_ERR_ code. The codeword is left unmodified on failure.
+int rs_codec_decode(const rs_codec_t * codec, uint8_t * codeword, int n,
+                    const int * erasures, int nerasures, int * positions);
+
+// Soft decision decode of a received codeword in place, Chase style. As
+// well as the hard decision decode, the nweak least reliable symbols are
+// erased in up to trials different patterns, and of the codewords found
+// the one closest to what was received is kept: the one whose corrected
+// symbols have the least total reliability. A pattern's corrections are
+// checked against the syndromes before they are compared, so only
+// codewords are ever returned. The syndromes are only
+// computed once, so each further trial costs one run of the errata solver
+// and trials bounds the time taken.
+//
+// Pattern t erases weak symbol b where bit b of t is set, the symbols
+// ordered from the least reliable, so pattern 0 is the hard decision, 1
+// erases the least reliable symbol, 2 the next, 3 both and so on.
+//
+// @param   reliability: n non-negative reliabilities, higher where the
+//                       demodulator was more certain, e.g. the ratio in dB
+//                       of the strongest tone to the next.
+// @param   nweak: least reliable symbols considered, 1..nparity and at
+//                 most RS_CODEC_MAX_CHASE.
+// @param   trials: patterns tried, 1..2^nweak.
+// @param   positions: as for rs_codec_decode().
+// @return  as for rs_codec_decode().
+int rs_codec_decode_chase(const rs_codec_t * codec, uint8_t * codeword, int n,
+                          const float * reliability, int nweak, int trials,
+                          int * positions);
+
+// Soft decision decode of a received codeword in place by generalised
+// minimum distance (GMD) decoding: the hard decision decode is followed by
+// decodes with the 2, 4, 6, ... up to nparity least reliable symbols
+// erased, and of the codewords found the one whose corrected symbols have
+// the least total reliability is kept, as for rs_codec_decode_chase().
+// Erasures are added in pairs, so with an odd nparity the last stage
+// erases nparity - 1 symbols and never all nparity.
+//
+// This corrects e errors on the least reliable symbols and f others
+// whenever e, rounded up to even, plus 2 * f is at most nparity, so up to
+// nparity (or nparity - 1) errors where the demodulator flags them,
+// against nparity / 2 for the hard decision decode.
+//
+// The syndromes are computed once, and each step adds its two erasures to
+// the errata locator of the last rather than solving afresh, so a step
+// costs little more than its Chien search. The steps stop as soon as a
+// codeword is found that meets Forney's GMD criterion, which no other
+// codeword can, so a frame the hard decision decode corrects with
+// confidence costs no more than that decode.
+//
+// @param   reliability: n non-negative reliabilities, as for
+//                       rs_codec_decode_chase().
+// @param   positions: as for rs_codec_decode().
+// @return  as for rs_codec_decode().
+int rs_codec_decode_gmd(const rs_codec_t * codec, uint8_t * codeword, int n,
+                        const float * reliability, int * positions);
+
+// Decode a codeword held in a list of segments, correcting it in place.
+// The segments hold the n codeword symbols in order, message then parity,
+// and may split it anywhere.
+//
+// @param   codeword: count segments whose lengths total n,
+//                    nparity < n <= 2^m - 1.
+// @return  as for rs_codec_decode(); erasures and positions index the
+//          codeword as a whole.
+int rs_codec_decodev(const rs_codec_t * codec, const struct iovec * codeword,
+                     int count, const int * erasures, int nerasures,
+                     int * positions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_CODEC_H
@@ -0,0 +1,719 @@
+//
+// Indexed FEC container allowing random access to any part of a protected
+// archive.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "rs_container.h"
+#include "rs_crc32.h"
+#include "rs_pipeline.h"
+#include "rs_trace.h"
+
+// Target bytes of blocks per pipeline batch.
+#define BATCH_BYTES             (1 << 20)
+
+// Symbol size of containers.
+#define CONTAINER_SYMBOL_SIZE   (8)
+
+typedef struct write_job {
+    rs_codec_t codec;
+    int k;
+    int depth;
+    const uint8_t * input;
+    uint64_t length;
+    uint64_t blocks;
+    size_t blockData;
+    size_t blockSize;
+    uint64_t batchBlocks;
+    uint8_t * index;            // index entries, filled in as blocks go out
+    int outFd;
+} write_job_t;
+
+typedef struct read_job {
+    rs_container_t container;
+    uint64_t batchBlocks;
+    int verbose;
+    int outFd;
+    rs_file_stats_t stats;
+} read_job_t;
+
+static int encode_blocks(void * ctx, int worker, uint64_t batch,
+                         uint8_t * slot, size_t * length);
+static int write_blocks(void * ctx, uint64_t batch, const uint8_t * slot,
+                        size_t length);
+static int decode_blocks(void * ctx, int worker, uint64_t batch,
+                         uint8_t * slot, size_t * length);
+static int write_data(void * ctx, uint64_t batch, const uint8_t * slot,
+                      size_t length);
+
+// Decode count codewords of a block starting at codeword first (wrapping),
+// storing the data symbols that fall in [from, to) of the block's data at
+// out[position - from].
+static void decode_codewords(const rs_container_t * container,
+                             const uint8_t * block, int first, int count,
+                             size_t from, size_t to, uint8_t * out,
+                             rs_file_stats_t * stats);
+
+static uint64_t batch_blocks(size_t blockSize);
+
+void rs_container_params_default(rs_container_params_t * params) {
+
+    params->k = RS_FILE_DEFAULT_K;
+    params->nparity = RS_FILE_DEFAULT_PARITY;
+    params->depth = RS_CONTAINER_DEFAULT_DEPTH;
+    params->poly = 0;
+    params->fcr = RS_CODEC_DEFAULT_FCR;
+    params->prim = RS_CODEC_DEFAULT_PRIM;
+    params->codecStats = NULL;
+}
+
+int rs_container_write(int inFd, int outFd,
+                       const rs_container_params_t * params, int threads) {
+
+    write_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    if (params->depth < 1 || params->depth > RS_CONTAINER_MAX_DEPTH) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    int err = rs_codec_init_generator(&job.codec, CONTAINER_SYMBOL_SIZE,
+                                      params->nparity, params->poly,
+                                      params->fcr, params->prim);
+    if (err) {
+        return err;
+    }
+    if (params->k < 1 || params->k + params->nparity > job.codec.nn) {
+        rs_codec_free(&job.codec);
+        return RS_ERR_INVALID_ARGS;
+    }
+    rs_codec_set_stats(&job.codec, params->codecStats);
+
+    err = rs_file_map(inFd, &job.input, &job.length);
+    if (err) {
+        rs_codec_free(&job.codec);
+        return err;
+    }
+
+    job.k = params->k;
+    job.depth = params->depth;
+    job.outFd = outFd;
+    job.blockData = (size_t) job.depth * (size_t) job.k;
+    job.blockSize = (size_t) job.depth * (size_t) (job.k + params->nparity);
+    job.blocks = (job.length + job.blockData - 1) / job.blockData;
+    job.batchBlocks = batch_blocks(job.blockSize);
+
+    uint64_t indexOffset = RS_CONTAINER_HEADER_SIZE +
+                           job.blocks * job.blockSize;
+    size_t indexSize = (size_t) job.blocks * RS_CONTAINER_INDEX_ENTRY;
+
+    job.index = calloc(1, indexSize + 1);
+    if (job.index == NULL) {
+        err = RS_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    uint8_t header[RS_CONTAINER_HEADER_SIZE] = {0};
+    memcpy(header, RS_CONTAINER_MAGIC, 4);
+    header[4] = RS_CONTAINER_VERSION;
+    header[5] = CONTAINER_SYMBOL_SIZE;
+    rs_file_put_le(&header[6], (uint64_t) params->nparity, 2);
+    rs_file_put_le(&header[8], (uint64_t) job.k, 2);
+    rs_file_put_le(&header[10], (uint64_t) job.depth, 2);
+    rs_file_put_le(&header[12], (uint64_t) job.codec.field->poly, 2);
+    rs_file_put_le(&header[14], (uint64_t) job.codec.fcr, 2);
+    rs_file_put_le(&header[16], job.length, 8);
+    rs_file_put_le(&header[24], job.blocks, 8);
+    rs_file_put_le(&header[32], indexOffset, 8);
+    rs_file_put_le(&header[40], (uint64_t) job.codec.prim, 2);
+    rs_file_put_le(&header[60], rs_crc32(0, header, 60), 4);
+
+    err = rs_file_write_all(outFd, header, sizeof(header));
+    if (err) {
+        goto done;
+    }
+
+    uint64_t batches = (job.blocks + job.batchBlocks - 1) / job.batchBlocks;
+    size_t slotSize = (size_t) job.batchBlocks *
+                      (sizeof(uint32_t) + job.blockSize);
+    err = rs_pipeline_run(batches, threads, slotSize, encode_blocks,
+                          write_blocks, &job);
+    if (err == -1) {
+        err = RS_ERR_NO_MEMORY;
+    }
+    if (err) {
+        goto done;
+    }
+
+    uint8_t footer[RS_CONTAINER_FOOTER_SIZE] = {0};
+    memcpy(footer, RS_CONTAINER_INDEX_MAGIC, 4);
+    rs_file_put_le(&footer[8], indexOffset, 8);
+    rs_file_put_le(&footer[16], job.blocks, 8);
+    rs_file_put_le(&footer[24], rs_crc32(0, job.index, indexSize), 4);
+    rs_file_put_le(&footer[28], rs_crc32(0, footer, 28), 4);
+
+    err = rs_file_write_all(outFd, job.index, indexSize);
+    if (!err) {
+        err = rs_file_write_all(outFd, footer, sizeof(footer));
+    }
+
+done:
+    free(job.index);
+    if (job.input != NULL) {
+        munmap((void *) job.input, job.length);
+    }
+    rs_codec_free(&job.codec);
+
+    return err;
+}
+
+int rs_container_open(rs_container_t * container, int fd) {
+
+    return rs_container_open_mode(container, fd, RS_CONTAINER_READ);
+}
+
+int rs_container_open_mode(rs_container_t * container, int fd, int mode) {
+
+    memset(container, 0, sizeof(*container));
+
+    if (mode == RS_CONTAINER_READ) {
+        int err = rs_file_map(fd, &container->map, &container->size);
+        if (err) {
+            return err;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+            return RS_ERR_IO;
+        }
+        container->size = (uint64_t) st.st_size;
+
+        void * addr = mmap(NULL, (size_t) container->size,
+                           PROT_READ | PROT_WRITE,
+                           mode == RS_CONTAINER_SHARED ? MAP_SHARED
+                                                       : MAP_PRIVATE,
+                           fd, 0);
+        if (addr == MAP_FAILED) {
+            return RS_ERR_IO;
+        }
+        container->map = addr;
+        container->writable = addr;
+    }
+    container->mode = mode;
+
+    const uint8_t * header = container->map;
+    uint64_t size = container->size;
+    if (size < RS_CONTAINER_HEADER_SIZE + RS_CONTAINER_FOOTER_SIZE ||
+        memcmp(header, RS_CONTAINER_MAGIC, 4) != 0 ||
+        header[4] != RS_CONTAINER_VERSION ||
+        rs_file_get_le(&header[60], 4) != rs_crc32(0, header, 60)) {
+        rs_container_close(container);
+        return RS_ERR_FORMAT;
+    }
+
+    int m = header[5];
+    container->nparity = (int) rs_file_get_le(&header[6], 2);
+    container->k = (int) rs_file_get_le(&header[8], 2);
+    container->depth = (int) rs_file_get_le(&header[10], 2);
+    int poly = (int) rs_file_get_le(&header[12], 2);
+    int fcr = (int) rs_file_get_le(&header[14], 2);
+    container->length = rs_file_get_le(&header[16], 8);
+    container->blocks = rs_file_get_le(&header[24], 8);
+    uint64_t indexOffset = rs_file_get_le(&header[32], 8);
+    int prim = (int) rs_file_get_le(&header[40], 2);
+
+    container->n = container->k + container->nparity;
+    if (m != CONTAINER_SYMBOL_SIZE || container->k < 1 ||
+        container->depth < 1 || container->depth > RS_CONTAINER_MAX_DEPTH ||
+        rs_codec_init_generator(&container->codec, m, container->nparity,
+                                poly, fcr, prim != 0 ? prim : 1)) {
+        rs_container_close(container);
+        return RS_ERR_FORMAT;
+    }
+
+    rs_codec_t * codec = &container->codec;
+    container->blockData = (size_t) container->depth * (size_t) container->k;
+    container->blockSize = (size_t) container->depth * (size_t) container->n;
+
+    uint64_t blocks = container->blocks;
+    if (container->n > codec->nn ||
+        blocks != (container->length + container->blockData - 1) /
+                  container->blockData ||
+        indexOffset != RS_CONTAINER_HEADER_SIZE +
+                       blocks * container->blockSize ||
+        size != indexOffset + blocks * RS_CONTAINER_INDEX_ENTRY +
+                RS_CONTAINER_FOOTER_SIZE) {
+        rs_container_close(container);
+        return RS_ERR_FORMAT;
+    }
+
+    const uint8_t * footer = container->map + size - RS_CONTAINER_FOOTER_SIZE;
+    container->index = container->map + indexOffset;
+    size_t indexSize = (size_t) blocks * RS_CONTAINER_INDEX_ENTRY;
+
+    // The header alone places every block, so a damaged index or footer
+    // only loses the block CRCs rather than the whole archive
+    container->indexed =
+            memcmp(footer, RS_CONTAINER_INDEX_MAGIC, 4) == 0 &&
+            rs_file_get_le(&footer[28], 4) == rs_crc32(0, footer, 28) &&
+            rs_file_get_le(&footer[8], 8) == indexOffset &&
+            rs_file_get_le(&footer[16], 8) == blocks &&
+            rs_file_get_le(&footer[24], 4) ==
+            rs_crc32(0, container->index, indexSize);
+
+    for (uint64_t b = 0; b < blocks && container->indexed; b++) {
+        const uint8_t * entry = container->index +
+                                b * RS_CONTAINER_INDEX_ENTRY;
+        uint64_t offset = rs_file_get_le(entry, 8);
+        if (offset > indexOffset - container->blockSize) {
+            container->indexed = 0;
+        }
+    }
+
+    return 0;
+}
+
+void rs_container_close(rs_container_t * container) {
+
+    if (container->map != NULL) {
+        munmap((void *) container->map, container->size);
+    }
+    rs_codec_free(&container->codec);
+    container->map = NULL;
+    container->writable = NULL;
+    container->index = NULL;
+}
+
+uint64_t rs_container_block_offset(const rs_container_t * container,
+                                   uint64_t block) {
+
+    if (!container->indexed) {
+        return RS_CONTAINER_HEADER_SIZE + block * container->blockSize;
+    }
+    const uint8_t * entry = container->index +
+                            block * RS_CONTAINER_INDEX_ENTRY;
+    return rs_file_get_le(entry, 8);
+}
+
+int rs_container_check_data(const rs_container_t * container, uint64_t block,
+                            const uint8_t * data) {
+
+    if (!container->indexed) {
+        return 1;
+    }
+    const uint8_t * entry = container->index +
+                            block * RS_CONTAINER_INDEX_ENTRY;
+    return rs_crc32(0, data, container->blockData) ==
+           (uint32_t) rs_file_get_le(&entry[8], 4);
+}
+
+int rs_container_read_block(const rs_container_t * container, uint64_t block,
+                            uint8_t * data, rs_file_stats_t * stats) {
+
+    if (block >= container->blocks) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    const uint8_t * blockPtr = container->map +
+                               rs_container_block_offset(container, block);
+
+    rs_file_stats_t local;
+    memset(&local, 0, sizeof(local));
+    decode_codewords(container, blockPtr, 0, container->depth, 0,
+                     container->blockData, data, &local);
+
+    if (!rs_container_check_data(container, block, data) &&
+        local.failed == 0) {
+        // Miscorrected beyond the capability of the code
+        local.failed = 1;
+    }
+
+    if (stats != NULL) {
+        stats->codewords += local.codewords;
+        stats->corrected += local.corrected;
+        stats->symbols += local.symbols;
+        stats->failed += local.failed;
+    }
+
+    return local.failed ? RS_ERR_UNCORRECTABLE : 0;
+}
+
+int rs_container_repair_block(const rs_container_t * container,
+                              uint64_t block, rs_file_stats_t * stats) {
+
+    if (block >= container->blocks || container->writable == NULL) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    uint8_t * blockPtr = container->writable +
+                         rs_container_block_offset(container, block);
+
+    int depth = container->depth;
+    int n = container->n;
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+    int positions[RS_CODEC_MAX_PARITY];
+
+    rs_file_stats_t local;
+    memset(&local, 0, sizeof(local));
+
+    for (int c = 0; c < depth; c++) {
+        for (int s = 0; s < n; s++) {
+            codeword[s] = blockPtr[s * depth + c];
+        }
+
+        // Syndromes first; only a damaged codeword is actually decoded
+        int result = rs_codec_decode(&container->codec, codeword, n, NULL, 0,
+                                     positions);
+        local.codewords++;
+        if (result > 0) {
+            local.corrected++;
+            local.symbols += (uint64_t) result;
+            for (int i = 0; i < result; i++) {
+                blockPtr[positions[i] * depth + c] = codeword[positions[i]];
+            }
+        } else if (result < 0) {
+            local.failed++;
+        }
+    }
+
+    if (!rs_container_check_data(container, block, blockPtr) &&
+        local.failed == 0) {
+        local.failed = 1;
+    }
+
+    if (stats != NULL) {
+        stats->codewords += local.codewords;
+        stats->corrected += local.corrected;
+        stats->symbols += local.symbols;
+        stats->failed += local.failed;
+    }
+
+    return local.failed ? RS_ERR_UNCORRECTABLE : 0;
+}
+
+int rs_container_read(const rs_container_t * container, uint64_t offset,
+                      void * buffer, size_t length, rs_file_stats_t * stats) {
+
+    if (offset > container->length ||
+        length > container->length - offset) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    uint8_t * out = buffer;
+    uint64_t end = offset + length;
+    int result = 0;
+
+    while (offset < end) {
+        uint64_t block = offset / container->blockData;
+        uint64_t blockStart = block * container->blockData;
+        uint64_t blockEnd = blockStart + container->blockData;
+        uint64_t dataEnd = blockEnd < container->length ? blockEnd
+                                                        : container->length;
+
+        size_t from = (size_t) (offset - blockStart);
+        size_t to = (size_t) ((end < blockEnd ? end : blockEnd) - blockStart);
+        int err = 0;
+
+        if (from == 0 && blockStart + to == dataEnd) {
+            // Whole block wanted, decode it all so the CRC can be checked
+            if (to == container->blockData) {
+                err = rs_container_read_block(container, block, out, stats);
+            } else {
+                uint8_t * scratch = malloc(container->blockData);
+                if (scratch == NULL) {
+                    return RS_ERR_NO_MEMORY;
+                }
+                err = rs_container_read_block(container, block, scratch,
+                                              stats);
+                memcpy(out, scratch, to);
+                free(scratch);
+            }
+        } else {
+            // Only the codewords holding [from, to)
+            const uint8_t * blockPtr =
+                    container->map +
+                    rs_container_block_offset(container, block);
+            int depth = container->depth;
+            int count = to - from >= (size_t) depth ? depth
+                                                    : (int) (to - from);
+
+            rs_file_stats_t local;
+            memset(&local, 0, sizeof(local));
+            decode_codewords(container, blockPtr, (int) (from % depth),
+                             count, from, to, out, &local);
+            if (stats != NULL) {
+                stats->codewords += local.codewords;
+                stats->corrected += local.corrected;
+                stats->symbols += local.symbols;
+                stats->failed += local.failed;
+            }
+            err = local.failed ? RS_ERR_UNCORRECTABLE : 0;
+        }
+
+        if (err && (result == 0 || err != RS_ERR_UNCORRECTABLE)) {
+            result = err;
+        }
+        out += to - from;
+        offset = blockStart + to;
+    }
+
+    return result;
+}
+
+int rs_container_decode(int inFd, int outFd, const rs_file_options_t * options,
+                        rs_file_stats_t * stats) {
+
+    read_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    int err = rs_container_open(&job.container, inFd);
+    if (err) {
+        if (stats != NULL) {
+            memset(stats, 0, sizeof(*stats));
+        }
+        return err;
+    }
+
+    if (!job.container.indexed) {
+        fprintf(stderr, "warning: container index damaged, decoding blocks "
+                        "without CRC checks\n");
+    }
+    rs_codec_set_stats(&job.container.codec, options->codecStats);
+    job.batchBlocks = batch_blocks(job.container.blockSize);
+    job.verbose = options->verbose;
+    job.outFd = outFd;
+
+    uint64_t batches = (job.container.blocks + job.batchBlocks - 1) /
+                       job.batchBlocks;
+    size_t slotSize = (size_t) job.batchBlocks *
+                      (sizeof(rs_file_stats_t) + job.container.blockData);
+
+    err = rs_pipeline_run(batches, options->threads, slotSize,
+                          decode_blocks, write_data, &job);
+    if (err == -1) {
+        err = RS_ERR_NO_MEMORY;
+    }
+    if (!err && job.stats.failed > 0) {
+        err = RS_ERR_UNCORRECTABLE;
+    }
+
+    rs_container_close(&job.container);
+    if (stats != NULL) {
+        *stats = job.stats;
+    }
+
+    return err;
+}
+
+static int encode_blocks(void * ctx, int worker, uint64_t batch,
+                         uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    write_job_t * job = ctx;
+    int k = job->k;
+    int depth = job->depth;
+    int np = job->codec.nparity;
+
+    uint64_t first = batch * job->batchBlocks;
+    uint64_t count = job->blocks - first;
+    if (count > job->batchBlocks) {
+        count = job->batchBlocks;
+    }
+
+    // CRCs of each block's data lead the slot
+    uint32_t * crcs = (uint32_t *) slot;
+    uint8_t * blocks = slot + job->batchBlocks * sizeof(uint32_t);
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+
+    // Separate passes over the batch so each stage can be traced
+    uint64_t start = rs_trace_begin();
+    for (uint64_t b = 0; b < count; b++) {
+        uint8_t * block = blocks + b * job->blockSize;
+        uint64_t offset = (first + b) * job->blockData;
+        size_t take = job->blockData;
+        if (offset + take > job->length) {
+            take = (size_t) (job->length - offset);
+        }
+
+        memcpy(block, &job->input[offset], take);
+        memset(&block[take], 0, job->blockData - take);
+    }
+    rs_trace_end("segment", start, batch);
+
+    start = rs_trace_begin();
+    for (uint64_t b = 0; b < count; b++) {
+        crcs[b] = rs_crc32(0, blocks + b * job->blockSize, job->blockData);
+    }
+    rs_trace_end("crc", start, batch);
+
+    // Encoding gathers and scatters the interleaved codewords
+    start = rs_trace_begin();
+    for (uint64_t b = 0; b < count; b++) {
+        uint8_t * block = blocks + b * job->blockSize;
+        for (int c = 0; c < depth; c++) {
+            for (int s = 0; s < k; s++) {
+                codeword[s] = block[s * depth + c];
+            }
+            rs_codec_encode(&job->codec, codeword, k, &codeword[k]);
+            for (int j = 0; j < np; j++) {
+                block[(k + j) * depth + c] = codeword[k + j];
+            }
+        }
+    }
+    rs_trace_end("encode", start, batch);
+
+    *length = (size_t) count * job->blockSize;
+    return 0;
+}
+
+static int write_blocks(void * ctx, uint64_t batch, const uint8_t * slot,
+                        size_t length) {
+
+    write_job_t * job = ctx;
+    const uint32_t * crcs = (const uint32_t *) slot;
+    uint64_t first = batch * job->batchBlocks;
+    uint64_t count = length / job->blockSize;
+
+    for (uint64_t b = 0; b < count; b++) {
+        uint8_t * entry = job->index + (first + b) * RS_CONTAINER_INDEX_ENTRY;
+        rs_file_put_le(entry, RS_CONTAINER_HEADER_SIZE +
+                              (first + b) * job->blockSize, 8);
+        rs_file_put_le(&entry[8], crcs[b], 4);
+    }
+
+    uint64_t start = rs_trace_begin();
+    int err = rs_file_write_all(job->outFd,
+                                slot + job->batchBlocks * sizeof(uint32_t),
+                                length);
+    rs_trace_end("write", start, batch);
+
+    return err;
+}
+
+static int decode_blocks(void * ctx, int worker, uint64_t batch,
+                         uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    read_job_t * job = ctx;
+    const rs_container_t * container = &job->container;
+
+    uint64_t first = batch * job->batchBlocks;
+    uint64_t count = container->blocks - first;
+    if (count > job->batchBlocks) {
+        count = job->batchBlocks;
+    }
+
+    // Per-block statistics lead the slot
+    rs_file_stats_t * stats = (rs_file_stats_t *) slot;
+    uint8_t * data = slot + job->batchBlocks * sizeof(rs_file_stats_t);
+
+    uint64_t start = rs_trace_begin();
+    for (uint64_t b = 0; b < count; b++) {
+        memset(&stats[b], 0, sizeof(stats[b]));
+        rs_container_read_block(container, first + b,
+                                data + b * container->blockData, &stats[b]);
+    }
+    rs_trace_end("decode", start, batch);
+
+    // Drop the padding of the final block
+    uint64_t end = (first + count) * container->blockData;
+    size_t bytes = (size_t) count * container->blockData;
+    if (end > container->length) {
+        bytes -= (size_t) (end - container->length);
+    }
+
+    *length = bytes;
+    return 0;
+}
+
+static int write_data(void * ctx, uint64_t batch, const uint8_t * slot,
+                      size_t length) {
+
+    read_job_t * job = ctx;
+    const rs_file_stats_t * stats = (const rs_file_stats_t *) slot;
+    uint64_t first = batch * job->batchBlocks;
+    uint64_t count = job->container.blocks - first;
+    if (count > job->batchBlocks) {
+        count = job->batchBlocks;
+    }
+
+    for (uint64_t b = 0; b < count; b++) {
+        job->stats.codewords += stats[b].codewords;
+        job->stats.corrected += stats[b].corrected;
+        job->stats.symbols += stats[b].symbols;
+        job->stats.failed += stats[b].failed;
+
+        if (job->verbose && stats[b].failed) {
+            fprintf(stderr, "block %llu: uncorrectable\n",
+                    (unsigned long long) (first + b));
+        } else if (job->verbose && stats[b].symbols) {
+            fprintf(stderr, "block %llu: corrected %llu symbols\n",
+                    (unsigned long long) (first + b),
+                    (unsigned long long) stats[b].symbols);
+        }
+    }
+
+    uint64_t start = rs_trace_begin();
+    int err = rs_file_write_all(job->outFd,
+                                slot + job->batchBlocks *
+                                       sizeof(rs_file_stats_t),
+                                length);
+    rs_trace_end("write", start, batch);
+
+    return err;
+}
+
+static void decode_codewords(const rs_container_t * container,
+                             const uint8_t * block, int first, int count,
+                             size_t from, size_t to, uint8_t * out,
+                             rs_file_stats_t * stats) {
+
+    int depth = container->depth;
+    int n = container->n;
+    int k = container->k;
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+
+    for (int i = 0; i < count; i++) {
+        int c = (first + i) % depth;
+
+        for (int s = 0; s < n; s++) {
+            codeword[s] = block[s * depth + c];
+        }
+
+        int result = rs_codec_decode(&container->codec, codeword, n, NULL, 0,
+                                     NULL);
+        stats->codewords++;
+        if (result > 0) {
+            stats->corrected++;
+            stats->symbols += (uint64_t) result;
+        } else if (result < 0) {
+            stats->failed++;
+        }
+
+        // Data symbol s of codeword c sits at s * depth + c
+        size_t s = from > (size_t) c ? (from - (size_t) c + depth - 1) / depth
+                                     : 0;
+        for (; s < (size_t) k; s++) {
+            size_t position = s * (size_t) depth + (size_t) c;
+            if (position >= to) {
+                break;
+            }
+            out[position - from] = codeword[s];
+        }
+    }
+}
+
+static uint64_t batch_blocks(size_t blockSize) {
+
+    uint64_t blocks = BATCH_BYTES / blockSize;
+    return blocks > 0 ? blocks : 1;
+}
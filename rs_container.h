@@ -0,0 +1,198 @@
+//
+// Indexed FEC container allowing random access to any part of a protected
+// archive. The data is cut into fixed size blocks, each of which holds
+// depth interleaved codewords, so any byte range can be recovered by
+// decoding only the codewords that cover it.
+//
+// Within a block, byte p belongs to codeword p % depth as its symbol
+// p / depth. The first depth * k bytes of a block are therefore the data in
+// its natural order, followed by depth * nparity bytes of parity, and a
+// burst of up to depth * nparity / 2 corrupted bytes is correctable. The
+// final block is zero padded.
+//
+// Layout (all integers little endian):
+//
+//   header, RS_CONTAINER_HEADER_SIZE bytes
+//     0     4   magic "RSCF"
+//     4     1   format version (1)
+//     5     1   m, bits per symbol (8)
+//     6     2   nparity, parity symbols per codeword (2t)
+//     8     2   k, data symbols per codeword
+//     10    2   interleave depth, codewords per block
+//     12    2   primitive polynomial of the field
+//     14    2   first consecutive root of the generator (fcr)
+//     16    8   length of the original data in bytes
+//     24    8   number of blocks
+//     32    8   offset of the index
+//     40    2   root step of the generator (prim), 0 (for 1) in older files
+//     42    18  reserved, zero
+//     60    4   CRC-32 of bytes 0..59
+//   blocks, depth * (k + nparity) bytes each
+//   index, RS_CONTAINER_INDEX_ENTRY bytes per block
+//     0     8   file offset of the block
+//     8     4   CRC-32 of the block's depth * k data bytes
+//     12    4   reserved, zero
+//   footer, RS_CONTAINER_FOOTER_SIZE bytes
+//     0     4   magic "RSIX"
+//     4     4   reserved, zero
+//     8     8   offset of the index
+//     16    8   number of blocks
+//     24    4   CRC-32 of the index
+//     28    4   CRC-32 of bytes 0..27
+//
+// The data CRCs in the index catch the rare miscorrection of a block whose
+// errors exceed the capability of the code.
+//
+// The index and footer have no FEC of their own, but the blocks sit at
+// fixed offsets after the header, so an archive whose index or footer is
+// damaged still opens: its blocks are then found by position and decoded
+// without the CRC check (see indexed below).
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_CONTAINER_H
+#define RS_CONTAINER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+#include "rs_file.h"
+
+#define RS_CONTAINER_MAGIC          "RSCF"
+#define RS_CONTAINER_INDEX_MAGIC    "RSIX"
+#define RS_CONTAINER_VERSION        (1)
+#define RS_CONTAINER_HEADER_SIZE    (64)
+#define RS_CONTAINER_INDEX_ENTRY    (16)
+#define RS_CONTAINER_FOOTER_SIZE    (32)
+
+// Default interleave depth.
+#define RS_CONTAINER_DEFAULT_DEPTH  (16)
+
+// Maximum interleave depth.
+#define RS_CONTAINER_MAX_DEPTH      (1024)
+
+// rs_container_open_mode() modes.
+#define RS_CONTAINER_READ           (0)     // read only
+#define RS_CONTAINER_PRIVATE        (1)     // repairs stay in memory
+#define RS_CONTAINER_SHARED         (2)     // repairs go back to the file
+
+typedef struct rs_container_params {
+    int k;                      // data symbols per codeword
+    int nparity;                // parity symbols per codeword
+    int depth;                  // codewords interleaved per block
+    int poly;                   // primitive polynomial, 0 for the default
+    int fcr;                    // first consecutive root of the generator
+    int prim;                   // root step of the generator
+    rs_codec_stats_t * codecStats;  // optional, attached to the codec
+} rs_container_params_t;
+
+// An open container. All fields are read only.
+typedef struct rs_container {
+    const uint8_t * map;        // the whole file
+    uint8_t * writable;         // the same mapping, unless opened read only
+    uint64_t size;
+    int mode;
+
+    rs_codec_t codec;
+    int k;
+    int nparity;
+    int n;                      // k + nparity
+    int depth;
+
+    uint64_t length;            // bytes of original data
+    uint64_t blocks;
+    size_t blockData;           // data bytes per block, depth * k
+    size_t blockSize;           // bytes per block, depth * n
+    const uint8_t * index;
+
+    // 0 if the index or footer is damaged, in which case blocks are found
+    // by position and have no CRCs to check against.
+    int indexed;
+} rs_container_t;
+
+// Fill in the default parameters: RS(255, 223) interleaved to depth 16.
+void rs_container_params_default(rs_container_params_t * params);
+
+// Write the contents of inFd as a container to outFd. outFd may be a pipe.
+//
+// @param   threads: worker threads, 0 for one per CPU.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_container_write(int inFd, int outFd,
+                       const rs_container_params_t * params, int threads);
+
+// Map a container for reading and validate its header and index. A
+// damaged index or footer is not an error, see indexed.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_container_open(rs_container_t * container, int fd);
+
+// Map a container with the given RS_CONTAINER_ mode. The writable modes let
+// rs_container_repair_block() correct blocks in place, either privately
+// (copy on write) or back to the file.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_container_open_mode(rs_container_t * container, int fd, int mode);
+
+// Unmap a container.
+void rs_container_close(rs_container_t * container);
+
+// File offset of a block, 0..blocks-1.
+uint64_t rs_container_block_offset(const rs_container_t * container,
+                                   uint64_t block);
+
+// Check the recovered data of a block against its index CRC.
+//
+// @return  1 if it matches or the index is damaged (so there is nothing to
+//          check against), otherwise 0.
+int rs_container_check_data(const rs_container_t * container, uint64_t block,
+                            const uint8_t * data);
+
+// Recover the data of a whole block, checking it against the index CRC.
+// Thread safe for concurrent calls on the same container.
+//
+// @param   block: block number, 0..blocks-1.
+// @param   data: receives blockData bytes.
+// @param   stats: optional, incremented by the block's decoding results.
+// @return  0 on success, RS_ERR_UNCORRECTABLE if any codeword failed or the
+//          CRC did not match (data then holds the best effort), otherwise
+//          another negative RS_ERR_ code.
+int rs_container_read_block(const rs_container_t * container, uint64_t block,
+                            uint8_t * data, rs_file_stats_t * stats);
+
+// Check every codeword of a block and write any corrections back into the
+// mapping, so the block's data can afterwards be used in place. Only
+// damaged codewords are decoded. Requires a writable mode. Concurrent
+// repairs of the same block must be serialised by the caller.
+//
+// @return  as for rs_container_read_block().
+int rs_container_repair_block(const rs_container_t * container,
+                              uint64_t block, rs_file_stats_t * stats);
+
+// Recover a byte range of the original data, decoding only the codewords
+// which hold it. Ranges covering whole blocks are also CRC checked.
+//
+// @param   offset: offset into the original data.
+// @param   buffer: receives length bytes.
+// @param   stats: optional, incremented by the decoding results.
+// @return  0 on success, RS_ERR_INVALID_ARGS if the range is beyond the end
+//          of the data, otherwise as for rs_container_read_block().
+int rs_container_read(const rs_container_t * container, uint64_t offset,
+                      void * buffer, size_t length, rs_file_stats_t * stats);
+
+// Decode a whole container to outFd using all CPUs.
+//
+// @return  as for rs_file_decode().
+int rs_container_decode(int inFd, int outFd, const rs_file_options_t * options,
+                        rs_file_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_CONTAINER_H
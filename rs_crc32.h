@@ -0,0 +1,29 @@
+//
+// CRC-32 (IEEE 802.3) checksums.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_CRC32_H
+#define RS_CRC32_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Update a CRC-32 with more data. Start with crc = 0.
+//
+// @param   crc: the CRC of the preceding data, or 0.
+// @param   data: the data to checksum.
+// @param   length: bytes of data.
+// @return  the CRC of the preceding data followed by this data.
+uint32_t rs_crc32(uint32_t crc, const void * data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_CRC32_H
@@ -0,0 +1,103 @@
+//
+// DVB/ATSC RS(204, 188) profile.
+//
+// @author Jarrod Bennett
+//
+
+#include <string.h>
+
+#include "rs_dvb.h"
+
+// Packets encoded or checked per batch, small enough to stay in L1.
+#define BATCH_PACKETS           (64)
+
+int rs_dvb_init(rs_dvb_t * dvb) {
+
+    if (dvb == NULL) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    return rs_codec_init_generator(&dvb->codec, 8, RS_DVB_PARITY, RS_DVB_POLY,
+                                   RS_DVB_FCR, 1);
+}
+
+void rs_dvb_free(rs_dvb_t * dvb) {
+
+    if (dvb == NULL) {
+        return;
+    }
+    rs_codec_free(&dvb->codec);
+}
+
+int rs_dvb_encode(const rs_dvb_t * dvb, const uint8_t * packets,
+                  size_t count, uint8_t * coded) {
+
+    while (count > 0) {
+        int batch = count < BATCH_PACKETS ? (int) count : BATCH_PACKETS;
+
+        // Two passes over the batch: copy the packets into place, then
+        // encode the copies, still in L1, writing each one's parity
+        // straight behind it
+        for (int p = 0; p < batch; p++) {
+            memcpy(&coded[(size_t) p * RS_DVB_CODED],
+                   &packets[(size_t) p * RS_DVB_PACKET], RS_DVB_PACKET);
+        }
+        int err = rs_codec_encode_batch(&dvb->codec, coded, RS_DVB_PACKET,
+                                        RS_DVB_CODED, &coded[RS_DVB_PACKET],
+                                        RS_DVB_CODED, batch);
+        if (err) {
+            return err;
+        }
+
+        packets += (size_t) batch * RS_DVB_PACKET;
+        coded += (size_t) batch * RS_DVB_CODED;
+        count -= (size_t) batch;
+    }
+
+    return 0;
+}
+
+int rs_dvb_decode(const rs_dvb_t * dvb, const uint8_t * coded, size_t count,
+                  uint8_t * packets, int * results) {
+
+    int total = 0;
+    int failed = 0;
+    uint8_t dirty[BATCH_PACKETS];
+
+    for (size_t first = 0; first < count; first += BATCH_PACKETS) {
+        int batch = count - first < BATCH_PACKETS ? (int) (count - first) :
+                                                    BATCH_PACKETS;
+        const uint8_t * in = &coded[first * RS_DVB_CODED];
+        int err = rs_codec_check_batch(&dvb->codec, in, RS_DVB_CODED,
+                                       RS_DVB_CODED, batch, dirty);
+        if (err < 0) {
+            return err;
+        }
+
+        for (int p = 0; p < batch; p++) {
+            const uint8_t * cw = &in[(size_t) p * RS_DVB_CODED];
+            uint8_t * out = &packets[(first + (size_t) p) * RS_DVB_PACKET];
+
+            int result = 0;
+            if (!dirty[p]) {
+                memcpy(out, cw, RS_DVB_PACKET);
+            } else {
+                uint8_t scratch[RS_DVB_CODED];
+                memcpy(scratch, cw, RS_DVB_CODED);
+                result = rs_codec_decode(&dvb->codec, scratch, RS_DVB_CODED,
+                                         NULL, 0, NULL);
+                memcpy(out, scratch, RS_DVB_PACKET);
+                if (result < 0) {
+                    out[1] |= RS_DVB_TEI;
+                    failed = 1;
+                } else {
+                    total += result;
+                }
+            }
+            if (results != NULL) {
+                results[first + (size_t) p] = result;
+            }
+        }
+    }
+
+    return failed ? RS_ERR_UNCORRECTABLE : total;
+}
@@ -0,0 +1,78 @@
+//
+// DVB/ATSC RS(204, 188) profile (ETSI EN 300 421 and friends): the
+// RS(255, 239) code over the field of x^8 + x^4 + x^3 + x^2 + 1 with the
+// generator roots alpha^0 .. alpha^15, shortened to protect one 188-byte
+// MPEG-TS packet, sync byte included, with 16 bytes of parity.
+//
+// The functions work on buffers of many packets. Packets are encoded in
+// L1-sized batches: each batch is copied into the coded buffer, then the
+// copies are encoded together with rs_codec_encode_batch(), so the encoder
+// runs several at a time and the input is read only once. Decoding first
+// checks a whole batch with rs_codec_check_batch(), only fully decoding the
+// (rare) packets with errors. With statistics attached to the codec, only
+// those packets are counted as decoded.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_DVB_H
+#define RS_DVB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+
+#define RS_DVB_PACKET           (188)   // MPEG-TS packet
+#define RS_DVB_PARITY           (16)
+#define RS_DVB_CODED            (RS_DVB_PACKET + RS_DVB_PARITY)
+#define RS_DVB_POLY             (0x11d)
+#define RS_DVB_FCR              (0)
+
+// MPEG-TS transport_error_indicator, set in byte 1 of packets that could
+// not be corrected.
+#define RS_DVB_TEI              (0x80)
+
+typedef struct rs_dvb {
+    rs_codec_t codec;
+} rs_dvb_t;
+
+// Initialise a DVB codec.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_dvb_init(rs_dvb_t * dvb);
+
+// Release a DVB codec.
+void rs_dvb_free(rs_dvb_t * dvb);
+
+// Encode packets.
+//
+// @param   packets: count packets of RS_DVB_PACKET bytes.
+// @param   coded: receives count packets of RS_DVB_CODED bytes. Must not
+//                 overlap packets.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_dvb_encode(const rs_dvb_t * dvb, const uint8_t * packets,
+                  size_t count, uint8_t * coded);
+
+// Decode packets. A packet which cannot be corrected is passed on as
+// received with its transport_error_indicator set, as a demodulator would.
+//
+// @param   coded: count packets of RS_DVB_CODED bytes.
+// @param   packets: receives count packets of RS_DVB_PACKET bytes. Must not
+//                   overlap coded.
+// @param   results: optional, receives the symbols corrected in each packet
+//                   or RS_ERR_UNCORRECTABLE.
+// @return  the total number of symbols corrected, RS_ERR_UNCORRECTABLE if
+//          any packet failed, otherwise another negative RS_ERR_ code.
+int rs_dvb_decode(const rs_dvb_t * dvb, const uint8_t * coded, size_t count,
+                  uint8_t * packets, int * results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_DVB_H
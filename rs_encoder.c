@@ -22,6 +22,7 @@
 //
 
 #include "rs_encoder.h"
+#include "rs_probes.h"
 
 static int galois_field_add(int m, int l, int r);
 
@@ -37,6 +38,9 @@ int rs_encode_message(const uint8_t * msg, int k, int t, int m,
     // TODO: since the msg appears in the codeword (systematic code) no need to
     //       include message in code output variable
 
+    RS_PROBE3(message__entry, k, t, m);
+    uint64_t probeStart = RS_PROBE_CLOCK(message__return);
+
     // Encoded code length
     int n = k + t;
 
@@ -81,6 +85,9 @@ int rs_encode_message(const uint8_t * msg, int k, int t, int m,
         parity[m - 1] = galois_field_add(m, 0, rhs[m - 1]);
     }
 
+    RS_PROBE4(message__return, k, t, m,
+              RS_PROBE_CLOCK(message__return) - probeStart);
+
     return 0;
 }
 
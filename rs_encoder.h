@@ -15,7 +15,8 @@
 // This implementation is based off of the MATLAB rsenc() function. Many
 // components including the generator polynomial are fixed and have been
 // precomputed via a MATLAB script in order to reduce encoding complexity.
-// The API does not support configurable generator polynomials or similar.
+// This API does not support configurable generator polynomials or similar;
+// for those, see rs_codec_init_generator() in rs_codec.h.
 // @ref https://au.mathworks.com/help/comm/ref/rsenc.html
 //
 // @author Jarrod Bennett
@@ -0,0 +1,399 @@
+//
+// FEC protection of whole files.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rs_codec.h"
+#include "rs_file.h"
+#include "rs_pipeline.h"
+#include "rs_trace.h"
+
+// Codewords per pipeline batch. Around 1 MiB of output for RS(255, 223).
+#define BATCH_CODEWORDS         (4096)
+
+// Symbol size of protected files.
+#define FILE_SYMBOL_SIZE        (8)
+
+typedef struct file_job {
+    rs_codec_t codec;
+    int k;
+    int verbose;
+    const uint8_t * input;      // mapped input file
+    uint64_t length;            // bytes of original data
+    uint64_t codewords;         // total codewords
+    int outFd;
+    rs_file_stats_t stats;
+} file_job_t;
+
+static int encode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length);
+static int decode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length);
+static int write_batch(void * ctx, uint64_t batch, const uint8_t * slot,
+                       size_t length);
+static int write_decoded_batch(void * ctx, uint64_t batch,
+                               const uint8_t * slot, size_t length);
+
+
+void rs_file_options_default(rs_file_options_t * options) {
+
+    options->k = RS_FILE_DEFAULT_K;
+    options->nparity = RS_FILE_DEFAULT_PARITY;
+    options->poly = 0;
+    options->fcr = RS_CODEC_DEFAULT_FCR;
+    options->prim = RS_CODEC_DEFAULT_PRIM;
+    options->threads = 0;
+    options->verbose = 0;
+    options->depth = 0;
+    options->ioFlags = 0;
+    options->codecStats = NULL;
+}
+
+void rs_file_header_pack(const rs_file_header_t * header, uint8_t * buffer) {
+
+    memset(buffer, 0, RS_FILE_HEADER_SIZE);
+    memcpy(buffer, RS_FILE_MAGIC, 4);
+    buffer[4] = RS_FILE_VERSION;
+    buffer[5] = (uint8_t) header->m;
+    rs_file_put_le(&buffer[6], (uint64_t) header->nparity, 2);
+    rs_file_put_le(&buffer[8], (uint64_t) header->k, 2);
+    rs_file_put_le(&buffer[10], (uint64_t) (header->shard + 1), 2);
+    rs_file_put_le(&buffer[12], (uint64_t) header->poly, 2);
+    buffer[14] = (uint8_t) header->fcr;
+    buffer[15] = (uint8_t) header->prim;
+    rs_file_put_le(&buffer[16], header->length, 8);
+}
+
+int rs_file_header_unpack(const uint8_t * buffer, rs_file_header_t * header) {
+
+    if (memcmp(buffer, RS_FILE_MAGIC, 4) != 0 ||
+        buffer[4] != RS_FILE_VERSION) {
+        return RS_ERR_FORMAT;
+    }
+
+    header->m = buffer[5];
+    header->nparity = (int) rs_file_get_le(&buffer[6], 2);
+    header->k = (int) rs_file_get_le(&buffer[8], 2);
+    header->shard = (int) rs_file_get_le(&buffer[10], 2) - 1;
+    header->poly = (int) rs_file_get_le(&buffer[12], 2);
+    header->fcr = buffer[14];
+    header->prim = buffer[15];
+    header->length = rs_file_get_le(&buffer[16], 8);
+
+    // A zero root step can only be an older header
+    if (header->prim == 0) {
+        header->poly = rs_field_default_poly(header->m);
+        header->fcr = RS_CODEC_DEFAULT_FCR;
+        header->prim = RS_CODEC_DEFAULT_PRIM;
+    }
+
+    if (header->m != FILE_SYMBOL_SIZE || header->k < 1 ||
+        header->nparity < 1 ||
+        header->k + header->nparity > (1 << header->m) - 1 ||
+        header->shard >= header->k + header->nparity) {
+        return RS_ERR_FORMAT;
+    }
+
+    return 0;
+}
+
+int rs_file_encode(int inFd, int outFd, const rs_file_options_t * options) {
+
+    file_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    int err = rs_codec_init_generator(&job.codec, FILE_SYMBOL_SIZE,
+                                      options->nparity, options->poly,
+                                      options->fcr, options->prim);
+    if (err) {
+        return err;
+    }
+    rs_codec_set_stats(&job.codec, options->codecStats);
+    if (options->k < 1 || options->k + options->nparity > job.codec.nn) {
+        rs_codec_free(&job.codec);
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    err = rs_file_map(inFd, &job.input, &job.length);
+    if (err) {
+        rs_codec_free(&job.codec);
+        return err;
+    }
+
+    job.k = options->k;
+    job.outFd = outFd;
+    job.codewords = (job.length + (uint64_t) job.k - 1) / (uint64_t) job.k;
+
+    rs_file_header_t header = {FILE_SYMBOL_SIZE, job.k, options->nparity,
+                               -1, job.length, job.codec.field->poly,
+                               job.codec.fcr, job.codec.prim};
+    uint8_t packed[RS_FILE_HEADER_SIZE];
+    rs_file_header_pack(&header, packed);
+
+    err = rs_file_write_all(outFd, packed, sizeof(packed));
+    if (!err) {
+        uint64_t batches = (job.codewords + BATCH_CODEWORDS - 1) /
+                           BATCH_CODEWORDS;
+        size_t slotSize = (size_t) BATCH_CODEWORDS *
+                          (size_t) (job.k + options->nparity);
+
+        err = rs_pipeline_run(batches, options->threads, slotSize,
+                              encode_batch, write_batch, &job);
+        if (err == -1) {
+            err = RS_ERR_NO_MEMORY;
+        }
+    }
+
+    if (job.input != NULL) {
+        munmap((void *) job.input, job.length);
+    }
+    rs_codec_free(&job.codec);
+
+    return err;
+}
+
+int rs_file_decode(int inFd, int outFd, const rs_file_options_t * options,
+                   rs_file_stats_t * stats) {
+
+    file_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    uint64_t size;
+    int err = rs_file_map(inFd, &job.input, &size);
+    if (err) {
+        return err;
+    }
+
+    rs_file_header_t header;
+    if (size < RS_FILE_HEADER_SIZE ||
+        rs_file_header_unpack(job.input, &header) || header.shard >= 0) {
+        err = RS_ERR_FORMAT;
+        goto done;
+    }
+
+    job.k = header.k;
+    job.length = header.length;
+    job.codewords = (job.length + (uint64_t) job.k - 1) / (uint64_t) job.k;
+    job.verbose = options->verbose;
+    job.outFd = outFd;
+
+    // The file must hold exactly the data plus the parity of each codeword
+    if (size != RS_FILE_HEADER_SIZE + job.length +
+                job.codewords * (uint64_t) header.nparity) {
+        err = RS_ERR_FORMAT;
+        goto done;
+    }
+
+    err = rs_codec_init_generator(&job.codec, header.m, header.nparity,
+                                  header.poly, header.fcr, header.prim);
+    if (err) {
+        err = err == RS_ERR_INVALID_ARGS ? RS_ERR_FORMAT : err;
+        goto done;
+    }
+    rs_codec_set_stats(&job.codec, options->codecStats);
+
+    uint64_t batches = (job.codewords + BATCH_CODEWORDS - 1) /
+                       BATCH_CODEWORDS;
+    size_t slotSize = BATCH_CODEWORDS * (sizeof(int) + (size_t) job.k);
+
+    err = rs_pipeline_run(batches, options->threads, slotSize,
+                          decode_batch, write_decoded_batch, &job);
+    if (err == -1) {
+        err = RS_ERR_NO_MEMORY;
+    }
+    if (!err && job.stats.failed > 0) {
+        err = RS_ERR_UNCORRECTABLE;
+    }
+    rs_codec_free(&job.codec);
+
+done:
+    if (stats != NULL) {
+        *stats = job.stats;
+    }
+    if (job.input != NULL) {
+        munmap((void *) job.input, size);
+    }
+
+    return err;
+}
+
+static int encode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    file_job_t * job = ctx;
+    uint64_t first = batch * BATCH_CODEWORDS;
+    uint64_t last = first + BATCH_CODEWORDS;
+    if (last > job->codewords) {
+        last = job->codewords;
+    }
+
+    uint64_t start = rs_trace_begin();
+    uint8_t * out = slot;
+    for (uint64_t cw = first; cw < last; cw++) {
+        uint64_t offset = cw * (uint64_t) job->k;
+        int k = job->k;
+        if (offset + (uint64_t) k > job->length) {
+            k = (int) (job->length - offset);
+        }
+
+        memcpy(out, &job->input[offset], (size_t) k);
+        rs_codec_encode(&job->codec, out, k, &out[k]);
+        out += k + job->codec.nparity;
+    }
+    rs_trace_end("encode", start, batch);
+
+    *length = (size_t) (out - slot);
+    return 0;
+}
+
+static int decode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    file_job_t * job = ctx;
+    int np = job->codec.nparity;
+    uint64_t first = batch * BATCH_CODEWORDS;
+    uint64_t last = first + BATCH_CODEWORDS;
+    if (last > job->codewords) {
+        last = job->codewords;
+    }
+
+    // Per-codeword results lead the slot, followed by the decoded data
+    int * results = (int *) slot;
+    uint8_t * out = slot + BATCH_CODEWORDS * sizeof(int);
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+
+    const uint8_t * in = job->input + RS_FILE_HEADER_SIZE +
+                         first * (uint64_t) (job->k + np);
+    uint64_t start = rs_trace_begin();
+
+    for (uint64_t cw = first; cw < last; cw++) {
+        int k = job->k;
+        if (cw * (uint64_t) k + (uint64_t) k > job->length) {
+            k = (int) (job->length - cw * (uint64_t) k);
+        }
+
+        memcpy(codeword, in, (size_t) (k + np));
+        results[cw - first] = rs_codec_decode(&job->codec, codeword, k + np,
+                                              NULL, 0, NULL);
+        memcpy(out, codeword, (size_t) k);
+
+        in += k + np;
+        out += k;
+    }
+    rs_trace_end("decode", start, batch);
+
+    *length = (size_t) (out - slot);
+    return 0;
+}
+
+static int write_batch(void * ctx, uint64_t batch, const uint8_t * slot,
+                       size_t length) {
+
+    file_job_t * job = ctx;
+    uint64_t start = rs_trace_begin();
+    int err = rs_file_write_all(job->outFd, slot, length);
+    rs_trace_end("write", start, batch);
+
+    return err;
+}
+
+static int write_decoded_batch(void * ctx, uint64_t batch,
+                               const uint8_t * slot, size_t length) {
+
+    file_job_t * job = ctx;
+    const int * results = (const int *) slot;
+    size_t resultsSize = BATCH_CODEWORDS * sizeof(int);
+
+    uint64_t first = batch * BATCH_CODEWORDS;
+    uint64_t count = job->codewords - first;
+    if (count > BATCH_CODEWORDS) {
+        count = BATCH_CODEWORDS;
+    }
+
+    rs_file_stats_add(&job->stats, results, first, count, job->verbose);
+
+    uint64_t start = rs_trace_begin();
+    int err = rs_file_write_all(job->outFd, slot + resultsSize,
+                                length - resultsSize);
+    rs_trace_end("write", start, batch);
+
+    return err;
+}
+
+void rs_file_stats_add(rs_file_stats_t * stats, const int * results,
+                       uint64_t first, uint64_t count, int verbose) {
+
+    for (uint64_t i = 0; i < count; i++) {
+        int result = results[i];
+        if (result > 0) {
+            stats->corrected++;
+            stats->symbols += (uint64_t) result;
+        } else if (result < 0) {
+            stats->failed++;
+        }
+
+        if (verbose && result != 0) {
+            if (result > 0) {
+                fprintf(stderr, "codeword %llu: corrected %d symbols\n",
+                        (unsigned long long) (first + i), result);
+            } else {
+                fprintf(stderr, "codeword %llu: uncorrectable\n",
+                        (unsigned long long) (first + i));
+            }
+        }
+    }
+    stats->codewords += count;
+}
+
+int rs_file_map(int fd, const uint8_t ** map, uint64_t * size) {
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return RS_ERR_IO;
+    }
+
+    *size = (uint64_t) st.st_size;
+    *map = NULL;
+    if (*size == 0) {
+        return 0;
+    }
+
+    void * addr = mmap(NULL, (size_t) *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        return RS_ERR_IO;
+    }
+    madvise(addr, (size_t) *size, MADV_SEQUENTIAL);
+
+    *map = addr;
+    return 0;
+}
+
+int rs_file_write_all(int fd, const uint8_t * buffer, size_t length) {
+
+    while (length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return RS_ERR_IO;
+        }
+        buffer += written;
+        length -= (size_t) written;
+    }
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+//
+// FEC protection of whole files. A protected file is a fixed size header
+// followed by the codewords of the input, each made of up to k data bytes
+// followed by nparity parity bytes. Files are processed with 8-bit symbols;
+// the final codeword is shortened to the remaining data rather than padded.
+//
+// Header layout (all integers little endian):
+//
+//   offset  size  field
+//   0       4     magic "RSEC"
+//   4       1     format version (1)
+//   5       1     m, bits per symbol (8)
+//   6       2     nparity, parity symbols per codeword
+//   8       2     k, data symbols per codeword
+//   10      2     shard index + 1 for a shard file (see rs_shard.h), else 0
+//   12      2     primitive polynomial of the field
+//   14      1     first consecutive root of the generator (fcr)
+//   15      1     root step of the generator (prim)
+//   16      8     length of the original data in bytes
+//   24      8     reserved, zero
+//
+// Files written before the code was configurable have zero in bytes 12..15
+// and use the default, MATLAB compatible, code.
+//
+// Encoding and decoding run through rs_pipeline so that reading (from an
+// mmap of the input), coding and writing overlap, with coding spread over
+// all CPUs.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_FILE_H
+#define RS_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rs_codec.h"
+
+#define RS_FILE_MAGIC           "RSEC"
+#define RS_FILE_VERSION         (1)
+#define RS_FILE_HEADER_SIZE     (32)
+
+// Default code: RS(255, 223) with 8-bit symbols.
+#define RS_FILE_DEFAULT_K       (223)
+#define RS_FILE_DEFAULT_PARITY  (32)
+
+typedef struct rs_file_header {
+    int m;
+    int k;
+    int nparity;
+    int shard;                  // shard index, or -1 if not a shard file
+    uint64_t length;
+    int poly;                   // primitive polynomial of the field
+    int fcr;                    // first consecutive root of the generator
+    int prim;                   // root step of the generator
+} rs_file_header_t;
+
+typedef struct rs_file_options {
+    int k;                      // data symbols per codeword
+    int nparity;                // parity symbols per codeword
+    int poly;                   // primitive polynomial, 0 for the default
+    int fcr;                    // first consecutive root of the generator
+    int prim;                   // root step of the generator
+    int threads;                // worker threads, 0 for one per CPU
+    int verbose;                // report each corrected codeword on stderr
+    int depth;                  // I/O queue depth, 0 for the default
+    int ioFlags;                // RS_IO_ flags for shard I/O
+    rs_codec_stats_t * codecStats;  // optional, attached to the codec
+} rs_file_options_t;
+
+typedef struct rs_file_stats {
+    uint64_t codewords;         // codewords processed
+    uint64_t corrected;         // codewords which needed correction
+    uint64_t symbols;           // symbols corrected
+    uint64_t failed;            // uncorrectable codewords
+} rs_file_stats_t;
+
+// Store the low bytes of value little endian.
+static inline void rs_file_put_le(uint8_t * buffer, uint64_t value,
+                                  int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        buffer[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+// Load a little endian value of the given number of bytes.
+static inline uint64_t rs_file_get_le(const uint8_t * buffer, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t) buffer[i] << (8 * i);
+    }
+    return value;
+}
+
+// Fill in the default options.
+void rs_file_options_default(rs_file_options_t * options);
+
+// Serialise a header into RS_FILE_HEADER_SIZE bytes.
+void rs_file_header_pack(const rs_file_header_t * header, uint8_t * buffer);
+
+// Parse and validate a header. The code of an older header is filled in
+// with the defaults.
+//
+// @return  0 on success, otherwise RS_ERR_FORMAT.
+int rs_file_header_unpack(const uint8_t * buffer, rs_file_header_t * header);
+
+// Map a whole regular file read-only for sequential access. The mapping
+// is released with munmap(). An empty file gives a NULL map.
+//
+// @return  0 on success, otherwise RS_ERR_IO.
+int rs_file_map(int fd, const uint8_t ** map, uint64_t * size);
+
+// Write a whole buffer to a file descriptor, retrying short writes.
+//
+// @return  0 on success, otherwise RS_ERR_IO.
+int rs_file_write_all(int fd, const uint8_t * buffer, size_t length);
+
+// Tally the per-codeword decode results of a batch into stats, reporting
+// each correction or failure on stderr if verbose.
+void rs_file_stats_add(rs_file_stats_t * stats, const int * results,
+                       uint64_t first, uint64_t count, int verbose);
+
+// FEC protect the contents of inFd, writing the protected file to outFd.
+// inFd must be a regular (mappable) file; outFd may be a pipe.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_file_encode(int inFd, int outFd, const rs_file_options_t * options);
+
+// Decode a protected file, writing the repaired data to outFd. Codewords
+// which cannot be corrected are written out as received.
+//
+// @param   stats: optional, receives the decoding statistics.
+// @return  0 if every codeword decoded, RS_ERR_UNCORRECTABLE if any failed,
+//          otherwise another negative RS_ERR_ code.
+int rs_file_decode(int inFd, int outFd, const rs_file_options_t * options,
+                   rs_file_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_FILE_H
@@ -0,0 +1,74 @@
+//
+// Galois field GF(2^m) arithmetic used by the Reed-Solomon codec.
+//
+// @author Jarrod Bennett
+//
+
+#include "rs_galois.h"
+
+// Default primitive polynomials indexed by m, as used by MATLAB gf().
+static const int DEFAULT_PRIMITIVE_POLYS[RS_FIELD_MAX_M + 1] = {
+        0, 0, 0,
+        0x0b,   // x^3 + x + 1
+        0x13,   // x^4 + x + 1
+        0x25,   // x^5 + x^2 + 1
+        0x43,   // x^6 + x + 1
+        0x89,   // x^7 + x^3 + 1
+        0x11d,  // x^8 + x^4 + x^3 + x^2 + 1
+};
+
+int rs_field_default_poly(int m) {
+
+    if (m < RS_FIELD_MIN_M || m > RS_FIELD_MAX_M) {
+        return 0;
+    }
+    return DEFAULT_PRIMITIVE_POLYS[m];
+}
+
+int rs_field_init(rs_field_t * field, int m, int poly) {
+
+    if (m < RS_FIELD_MIN_M || m > RS_FIELD_MAX_M) {
+        return 1;
+    }
+
+    // The polynomial must be of degree m exactly
+    if ((poly >> m) != 1) {
+        return 2;
+    }
+
+    int nn = (1 << m) - 1;
+
+    field->m = m;
+    field->nn = nn;
+    field->poly = poly;
+
+    for (int i = 0; i <= nn; i++) {
+        field->log[i] = 0;
+    }
+
+    // Walk the powers of alpha. If alpha returns to 1 before visiting every
+    // non-zero element then the polynomial is not primitive.
+    int x = 1;
+    for (int i = 0; i < nn; i++) {
+        if (i > 0 && x == 1) {
+            return 3;
+        }
+        field->exp[i] = (uint8_t) x;
+        field->exp[i + nn] = (uint8_t) x;
+        field->log[x] = (uint8_t) i;
+
+        x <<= 1;
+        if (x & (1 << m)) {
+            x ^= poly;
+        }
+    }
+    if (x != 1) {
+        return 3;
+    }
+
+    // Pad the tail so a doubled log of nn (the log[0] marker) stays in range
+    field->exp[2 * nn] = field->exp[0];
+    field->log[0] = (uint8_t) nn;
+
+    return 0;
+}
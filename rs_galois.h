@@ -0,0 +1,86 @@
+//
+// Galois field GF(2^m) arithmetic used by the Reed-Solomon codec. Fields are
+// represented by log/antilog tables so multiplication and division are a pair
+// of table lookups. The antilog table is stored twice over so that the sum of
+// two logs never needs to be reduced modulo 2^m - 1.
+//
+// Symbol sizes from 3 to 8 bits are supported. The default primitive
+// polynomials match the ones used by MATLAB's gf()/rsenc() so that codewords
+// are interchangeable with the MATLAB reference implementation.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_GALOIS_H
+#define RS_GALOIS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// Smallest and largest supported bits per symbol.
+#define RS_FIELD_MIN_M          (3)
+#define RS_FIELD_MAX_M          (8)
+
+// Number of elements in the largest supported field.
+#define RS_FIELD_MAX_SIZE       (1 << RS_FIELD_MAX_M)
+
+typedef struct rs_field {
+    int m;          // bits per symbol
+    int nn;         // 2^m - 1, the order of the multiplicative group
+    int poly;       // primitive polynomial, including the x^m term
+
+    // alpha^i for i in [0, 2 * nn). Doubled to avoid a modulo on multiply.
+    uint8_t exp[2 * RS_FIELD_MAX_SIZE];
+
+    // log_alpha(x) for x in [1, nn]. log[0] is set to nn as a marker value
+    // and must never be used in arithmetic.
+    uint8_t log[RS_FIELD_MAX_SIZE];
+} rs_field_t;
+
+// Get the default (MATLAB compatible) primitive polynomial for m bits per
+// symbol.
+//
+// @param   m: the symbol size in bits.
+// @return  the primitive polynomial, or 0 if m is not supported.
+int rs_field_default_poly(int m);
+
+// Build the log/antilog tables for GF(2^m).
+//
+// @param   field: the field to initialise.
+// @param   m: the symbol size in bits, RS_FIELD_MIN_M..RS_FIELD_MAX_M.
+// @param   poly: the primitive polynomial including the x^m term.
+// @return  0 on success, otherwise non-zero if m is unsupported or poly is
+//          not primitive.
+int rs_field_init(rs_field_t * field, int m, int poly);
+
+// Multiply two field elements.
+static inline uint8_t rs_field_mul(const rs_field_t * field, uint8_t l,
+                                   uint8_t r) {
+    if (l == 0 || r == 0) {
+        return 0;
+    }
+    return field->exp[field->log[l] + field->log[r]];
+}
+
+// Divide l by r. r must be non-zero.
+static inline uint8_t rs_field_div(const rs_field_t * field, uint8_t l,
+                                   uint8_t r) {
+    if (l == 0) {
+        return 0;
+    }
+    return field->exp[field->log[l] + field->nn - field->log[r]];
+}
+
+// alpha^e for any non-negative exponent e.
+static inline uint8_t rs_field_alpha_pow(const rs_field_t * field, int e) {
+    return field->exp[e % field->nn];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_GALOIS_H
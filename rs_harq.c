@@ -0,0 +1,128 @@
+//
+// Incremental redundancy (type II hybrid ARQ) on a low rate mother code.
+//
+// @author Jarrod Bennett
+//
+
+#include <string.h>
+
+#include "rs_harq.h"
+
+int rs_harq_init(rs_harq_t * harq, int m, int nparity, int first, int step) {
+
+    if (harq == NULL || first < 1 || first > nparity || step < 1) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    int err = rs_codec_init(&harq->codec, m, nparity);
+    if (err) {
+        return err;
+    }
+    harq->first = first;
+    harq->step = step;
+
+    return 0;
+}
+
+void rs_harq_free(rs_harq_t * harq) {
+
+    if (harq == NULL) {
+        return;
+    }
+    rs_codec_free(&harq->codec);
+}
+
+int rs_harq_encode(const rs_harq_t * harq, const uint8_t * msg, int k,
+                   rs_harq_tx_t * tx) {
+
+    tx->sent = 0;
+    return rs_codec_encode(&harq->codec, msg, k, tx->parity);
+}
+
+int rs_harq_next(const rs_harq_t * harq, rs_harq_tx_t * tx, uint8_t * parity) {
+
+    int remaining = harq->codec.nparity - tx->sent;
+    int count = tx->sent == 0 ? harq->first : harq->step;
+    if (count > remaining) {
+        count = remaining;
+    }
+
+    memcpy(parity, &tx->parity[tx->sent], (size_t) count);
+    tx->sent += count;
+
+    return count;
+}
+
+int rs_harq_rx_init(const rs_harq_t * harq, rs_harq_rx_t * rx,
+                    const uint8_t * msg, int k) {
+
+    if (k < 1 || k + harq->codec.nparity > harq->codec.nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    memcpy(rx->codeword, msg, (size_t) k);
+    rx->k = k;
+    rx->received = 0;
+
+    return 0;
+}
+
+int rs_harq_rx_add(const rs_harq_t * harq, rs_harq_rx_t * rx,
+                   const uint8_t * parity, int count) {
+
+    if (count < 0 || rx->received + count > harq->codec.nparity) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    memcpy(&rx->codeword[rx->k + rx->received], parity, (size_t) count);
+    rx->received += count;
+
+    return 0;
+}
+
+int rs_harq_decode(const rs_harq_t * harq, const rs_harq_rx_t * rx,
+                   const int * erasures, int nerasures, uint8_t * msg) {
+
+    int np = harq->codec.nparity;
+    int k = rx->k;
+    int n = k + np;
+    if (nerasures < 0 || nerasures + np - rx->received > np) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // The parity not yet received is erased, and zeroed so that it only
+    // adds erasure values to find rather than errors
+    uint8_t codeword[RS_FIELD_MAX_SIZE - 1];
+    int erased[RS_CODEC_MAX_PARITY];
+    int nerased = 0;
+
+    memcpy(codeword, rx->codeword, (size_t) (k + rx->received));
+    memset(&codeword[k + rx->received], 0, (size_t) (np - rx->received));
+
+    for (int i = 0; i < nerasures; i++) {
+        if (erasures[i] < 0 || erasures[i] >= k + rx->received) {
+            return RS_ERR_INVALID_ARGS;
+        }
+        erased[nerased++] = erasures[i];
+    }
+    for (int j = rx->received; j < np; j++) {
+        erased[nerased++] = k + j;
+    }
+
+    int positions[RS_CODEC_MAX_PARITY];
+    int result = rs_codec_decode(&harq->codec, codeword, n, erased, nerased,
+                                 positions);
+    if (result < 0) {
+        return result;
+    }
+
+    memcpy(msg, codeword, (size_t) k);
+
+    // Only symbols that were actually received count as corrected
+    int corrected = 0;
+    for (int r = 0; r < result; r++) {
+        corrected += positions[r] < k + rx->received;
+    }
+
+    return corrected;
+}
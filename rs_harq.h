@@ -0,0 +1,111 @@
+//
+// Incremental redundancy (type II hybrid ARQ) on a low rate mother code.
+//
+// A frame is encoded once with the mother code's nparity parity symbols.
+// The first transmission carries the message and only the first few of
+// them, a high rate code, and each retransmission request is answered with
+// the next few, until the mother code is exhausted. The receiver keeps
+// everything it has been sent and decodes the mother codeword with the
+// parity not yet received as erasures. Since RS codes are MDS, with r
+// parity symbols received this corrects up to r / 2 errors, as much as a
+// code designed with r parity symbols would, and every retransmission adds
+// to rather than replaces what came before.
+//
+// As with any code at its limit, a frame with more errors than the parity
+// received can correct may be miscorrected rather than fail, so the
+// payload should carry a check (a CRC, say) to decide when to ask for more.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_HARQ_H
+#define RS_HARQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+
+typedef struct rs_harq {
+    rs_codec_t codec;           // the mother code
+    int first;                  // parity symbols in the first transmission
+    int step;                   // parity symbols per retransmission
+} rs_harq_t;
+
+// Sender state of one frame.
+typedef struct rs_harq_tx {
+    uint8_t parity[RS_CODEC_MAX_PARITY];    // the mother code's parity
+    int sent;                   // parity symbols sent so far
+} rs_harq_tx_t;
+
+// Receiver state of one frame.
+typedef struct rs_harq_rx {
+    uint8_t codeword[RS_FIELD_MAX_SIZE - 1];    // message, parity received
+    int k;
+    int received;               // parity symbols received so far
+} rs_harq_rx_t;
+
+// Initialise an incremental redundancy context with a mother code of
+// nparity parity symbols, see rs_codec_init().
+//
+// @param   first: parity symbols in the first transmission, 1..nparity.
+// @param   step: parity symbols per retransmission, at least 1 (the last
+//                may be shorter).
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_harq_init(rs_harq_t * harq, int m, int nparity, int first, int step);
+
+// Release an incremental redundancy context.
+void rs_harq_free(rs_harq_t * harq);
+
+// Encode a frame with the mother code, ready for rs_harq_next().
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_harq_encode(const rs_harq_t * harq, const uint8_t * msg, int k,
+                   rs_harq_tx_t * tx);
+
+// Get the parity of a frame's next transmission, the first transmission's
+// on the first call. No encoding is done.
+//
+// @param   parity: receives up to max(first, step) symbols.
+// @return  the number of parity symbols written, 0 once all of the mother
+//          code's parity has been sent.
+int rs_harq_next(const rs_harq_t * harq, rs_harq_tx_t * tx, uint8_t * parity);
+
+// Start receiving a frame from the message symbols of its first
+// transmission.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_harq_rx_init(const rs_harq_t * harq, rs_harq_rx_t * rx,
+                    const uint8_t * msg, int k);
+
+// Add the parity symbols of a frame's next transmission, in the order
+// rs_harq_next() gave them.
+//
+// @return  0 on success, RS_ERR_INVALID_ARGS if the frame would then have
+//          more parity than the mother code.
+int rs_harq_rx_add(const rs_harq_t * harq, rs_harq_rx_t * rx,
+                   const uint8_t * parity, int count);
+
+// Decode a frame from everything received so far. The receiver state is
+// not changed, so on failure more parity can be requested and added and the
+// frame decoded again.
+//
+// @param   erasures: optional indices of unreliable symbols among those
+//                    received, the message at 0..k-1 and the parity
+//                    following it in the order received.
+// @param   msg: receives the k corrected message symbols.
+// @return  the number of symbols corrected, RS_ERR_UNCORRECTABLE if the
+//          parity received so far is not enough, otherwise another
+//          negative RS_ERR_ code.
+int rs_harq_decode(const rs_harq_t * harq, const rs_harq_rx_t * rx,
+                   const int * erasures, int nerasures, uint8_t * msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_HARQ_H
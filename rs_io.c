@@ -0,0 +1,359 @@
+//
+// Batched positional file I/O over io_uring with a pread()/pwrite()
+// fallback. The ring is driven through the raw system calls so that no
+// liburing dependency is needed.
+//
+// @author Jarrod Bennett
+//
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "rs_codec.h"
+#include "rs_io.h"
+
+#if defined(RS_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#endif
+
+// Perform an operation synchronously, finishing any short transfer.
+static int sync_transfer(int fd, int write, uint8_t * buffer, size_t length,
+                         uint64_t offset);
+
+static int queue_op(rs_io_t * io, int fd, int write, uint8_t * buffer,
+                    size_t length, uint64_t offset, int bufferIndex);
+
+#if defined(RS_HAVE_IO_URING)
+static int uring_setup(rs_io_t * io);
+static void uring_teardown(rs_io_t * io);
+static int uring_enter(rs_io_t * io, unsigned submit, unsigned wait);
+static void uring_reap(rs_io_t * io);
+#endif
+
+int rs_io_init(rs_io_t * io, int depth, int flags) {
+
+    memset(io, 0, sizeof(*io));
+    io->ringFd = -1;
+    io->backend = RS_IO_BACKEND_SYNC;
+    io->depth = depth > 0 ? depth : RS_IO_DEFAULT_DEPTH;
+
+    io->ops = calloc((size_t) io->depth, sizeof(rs_io_op_t));
+    io->freeSlots = malloc((size_t) io->depth * sizeof(int));
+    if (io->ops == NULL || io->freeSlots == NULL) {
+        free(io->ops);
+        free(io->freeSlots);
+        return RS_ERR_NO_MEMORY;
+    }
+    for (int i = 0; i < io->depth; i++) {
+        io->freeSlots[i] = io->depth - 1 - i;
+    }
+    io->nfree = io->depth;
+
+#if defined(RS_HAVE_IO_URING)
+    if (!(flags & RS_IO_SYNC) && uring_setup(io) == 0) {
+        io->backend = RS_IO_BACKEND_URING;
+    }
+#else
+    (void) flags;
+#endif
+
+    return 0;
+}
+
+void rs_io_free(rs_io_t * io) {
+
+    rs_io_wait(io);
+
+#if defined(RS_HAVE_IO_URING)
+    if (io->backend == RS_IO_BACKEND_URING) {
+        uring_teardown(io);
+    }
+#endif
+
+    free(io->ops);
+    free(io->freeSlots);
+    io->ops = NULL;
+    io->freeSlots = NULL;
+}
+
+void rs_io_register_buffers(rs_io_t * io, const struct iovec * buffers,
+                            int count) {
+
+#if defined(RS_HAVE_IO_URING)
+    if (io->backend != RS_IO_BACKEND_URING || io->registered) {
+        return;
+    }
+    long ret = syscall(__NR_io_uring_register, io->ringFd,
+                       IORING_REGISTER_BUFFERS, buffers, (unsigned) count);
+    io->registered = ret == 0;
+#else
+    (void) io;
+    (void) buffers;
+    (void) count;
+#endif
+}
+
+int rs_io_read(rs_io_t * io, int fd, void * buffer, size_t length,
+               uint64_t offset, int bufferIndex) {
+
+    return queue_op(io, fd, 0, buffer, length, offset, bufferIndex);
+}
+
+int rs_io_write(rs_io_t * io, int fd, const void * buffer, size_t length,
+                uint64_t offset, int bufferIndex) {
+
+    return queue_op(io, fd, 1, (uint8_t *) buffer, length, offset,
+                    bufferIndex);
+}
+
+int rs_io_wait(rs_io_t * io) {
+
+#if defined(RS_HAVE_IO_URING)
+    if (io->backend == RS_IO_BACKEND_URING) {
+        while (io->queued > 0 || io->inflight > 0) {
+            if (uring_enter(io, (unsigned) io->queued,
+                            (unsigned) (io->queued + io->inflight)) != 0) {
+                break;
+            }
+            uring_reap(io);
+        }
+    }
+#endif
+
+    int err = io->error;
+    io->error = 0;
+    return err;
+}
+
+const char * rs_io_backend_name(const rs_io_t * io) {
+
+    return io->backend == RS_IO_BACKEND_URING ? "io_uring" : "pread/pwrite";
+}
+
+static int queue_op(rs_io_t * io, int fd, int write, uint8_t * buffer,
+                    size_t length, uint64_t offset, int bufferIndex) {
+
+    if (io->backend == RS_IO_BACKEND_SYNC) {
+        int err = sync_transfer(fd, write, buffer, length, offset);
+        if (err) {
+            io->error = err;
+        }
+        return err;
+    }
+
+#if defined(RS_HAVE_IO_URING)
+    // Make room by submitting the batch so far and reaping completions
+    while (io->nfree == 0) {
+        if (uring_enter(io, (unsigned) io->queued, 1) != 0) {
+            return RS_ERR_IO;
+        }
+        uring_reap(io);
+    }
+
+    int slot = io->freeSlots[--io->nfree];
+    rs_io_op_t * op = &io->ops[slot];
+    op->fd = fd;
+    op->write = write;
+    op->buffer = buffer;
+    op->length = length;
+    op->offset = offset;
+
+    unsigned tail = *io->sqTail;
+    unsigned index = tail & *io->sqMask;
+    struct io_uring_sqe * sqe = &((struct io_uring_sqe *) io->sqes)[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (io->registered && bufferIndex >= 0) {
+        sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t) bufferIndex;
+    } else {
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buffer;
+    sqe->len = (uint32_t) length;
+    sqe->off = offset;
+    sqe->user_data = (uint64_t) slot;
+
+    io->sqArray[index] = index;
+    __atomic_store_n(io->sqTail, tail + 1, __ATOMIC_RELEASE);
+    io->queued++;
+#else
+    (void) bufferIndex;
+#endif
+
+    return 0;
+}
+
+static int sync_transfer(int fd, int write, uint8_t * buffer, size_t length,
+                         uint64_t offset) {
+
+    while (length > 0) {
+        ssize_t done = write ? pwrite(fd, buffer, length, (off_t) offset)
+                             : pread(fd, buffer, length, (off_t) offset);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return RS_ERR_IO;
+        }
+        buffer += done;
+        length -= (size_t) done;
+        offset += (uint64_t) done;
+    }
+
+    return 0;
+}
+
+#if defined(RS_HAVE_IO_URING)
+
+static int uring_setup(rs_io_t * io) {
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    long fd = syscall(__NR_io_uring_setup, (unsigned) io->depth, &params);
+    if (fd < 0) {
+        return -1;
+    }
+    io->ringFd = (int) fd;
+
+    io->sqRingSize = params.sq_off.array +
+                     params.sq_entries * sizeof(unsigned);
+    io->cqRingSize = params.cq_off.cqes +
+                     params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (io->cqRingSize > io->sqRingSize) {
+            io->sqRingSize = io->cqRingSize;
+        }
+        io->cqRingSize = io->sqRingSize;
+    }
+
+    io->sqRing = mmap(NULL, io->sqRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, io->ringFd,
+                      IORING_OFF_SQ_RING);
+    if (io->sqRing == MAP_FAILED) {
+        io->sqRing = NULL;
+        uring_teardown(io);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        io->cqRing = io->sqRing;
+    } else {
+        io->cqRing = mmap(NULL, io->cqRingSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, io->ringFd,
+                          IORING_OFF_CQ_RING);
+        if (io->cqRing == MAP_FAILED) {
+            io->cqRing = NULL;
+            uring_teardown(io);
+            return -1;
+        }
+    }
+
+    io->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    io->sqes = mmap(NULL, io->sqesSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, io->ringFd, IORING_OFF_SQES);
+    if (io->sqes == MAP_FAILED) {
+        io->sqes = NULL;
+        uring_teardown(io);
+        return -1;
+    }
+
+    uint8_t * sq = io->sqRing;
+    uint8_t * cq = io->cqRing;
+    io->sqHead = (unsigned *) (sq + params.sq_off.head);
+    io->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    io->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    io->sqArray = (unsigned *) (sq + params.sq_off.array);
+    io->cqHead = (unsigned *) (cq + params.cq_off.head);
+    io->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    io->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    io->cqes = cq + params.cq_off.cqes;
+
+    // Never queue more than the ring holds
+    if ((unsigned) io->depth > params.sq_entries) {
+        io->depth = (int) params.sq_entries;
+        io->nfree = io->depth;
+    }
+
+    return 0;
+}
+
+static void uring_teardown(rs_io_t * io) {
+
+    if (io->sqes != NULL) {
+        munmap(io->sqes, io->sqesSize);
+    }
+    if (io->cqRing != NULL && io->cqRing != io->sqRing) {
+        munmap(io->cqRing, io->cqRingSize);
+    }
+    if (io->sqRing != NULL) {
+        munmap(io->sqRing, io->sqRingSize);
+    }
+    if (io->ringFd >= 0) {
+        close(io->ringFd);
+    }
+    io->sqes = NULL;
+    io->cqRing = NULL;
+    io->sqRing = NULL;
+    io->ringFd = -1;
+}
+
+static int uring_enter(rs_io_t * io, unsigned submit, unsigned wait) {
+
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, io->ringFd, submit, wait,
+                           wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0) {
+            io->queued -= (int) ret;
+            io->inflight += (int) ret;
+            return 0;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            io->error = RS_ERR_IO;
+            return -1;
+        }
+        // Nothing was consumed, retry after reaping what has finished
+        uring_reap(io);
+    }
+}
+
+static void uring_reap(rs_io_t * io) {
+
+    unsigned head = *io->cqHead;
+    unsigned tail = __atomic_load_n(io->cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe * cqe =
+                &((struct io_uring_cqe *) io->cqes)[head & *io->cqMask];
+        int slot = (int) cqe->user_data;
+        rs_io_op_t * op = &io->ops[slot];
+
+        if (cqe->res < 0) {
+            io->error = RS_ERR_IO;
+        } else if ((size_t) cqe->res < op->length) {
+            // Short transfer, finish the remainder synchronously
+            size_t done = (size_t) cqe->res;
+            if (done == 0 ||
+                sync_transfer(op->fd, op->write, op->buffer + done,
+                              op->length - done, op->offset + done)) {
+                io->error = RS_ERR_IO;
+            }
+        }
+
+        io->freeSlots[io->nfree++] = slot;
+        io->inflight--;
+        head++;
+    }
+
+    __atomic_store_n(io->cqHead, head, __ATOMIC_RELEASE);
+}
+
+#endif
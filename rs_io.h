@@ -0,0 +1,119 @@
+//
+// Batched positional file I/O for the file tools. Reads and writes are
+// queued and submitted together through io_uring where the kernel supports
+// it, optionally against pre-registered buffers. Where io_uring is not
+// available (old kernels, seccomp sandboxes, or builds without
+// <linux/io_uring.h>) every operation falls back to a plain pread()/pwrite()
+// at the time it is queued, so callers use a single code path.
+//
+// An rs_io_t is not thread safe; use one per thread.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_IO_H
+#define RS_IO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+// Default number of operations in flight.
+#define RS_IO_DEFAULT_DEPTH     (64)
+
+// Alignment of buffers, offsets and lengths for O_DIRECT.
+#define RS_IO_ALIGNMENT         (4096)
+
+// rs_io_init() flags.
+#define RS_IO_SYNC              (1 << 0)    // force pread()/pwrite()
+
+// Backends.
+#define RS_IO_BACKEND_SYNC      (0)
+#define RS_IO_BACKEND_URING     (1)
+
+typedef struct rs_io_op {
+    int fd;
+    int write;
+    uint8_t * buffer;
+    size_t length;
+    uint64_t offset;
+} rs_io_op_t;
+
+typedef struct rs_io {
+    int backend;
+    int depth;
+    int registered;         // buffers registered with the ring
+    int error;              // sticky error from a failed operation
+
+    // io_uring state, unused by the sync backend
+    int ringFd;
+    void * sqRing;
+    size_t sqRingSize;
+    void * cqRing;
+    size_t cqRingSize;
+    void * sqes;
+    size_t sqesSize;
+    unsigned * sqHead;
+    unsigned * sqTail;
+    unsigned * sqMask;
+    unsigned * sqArray;
+    unsigned * cqHead;
+    unsigned * cqTail;
+    unsigned * cqMask;
+    void * cqes;
+
+    int queued;             // prepared but not yet submitted
+    int inflight;           // submitted but not yet completed
+    rs_io_op_t * ops;       // indexed by slot, depth entries
+    int * freeSlots;
+    int nfree;
+} rs_io_t;
+
+// Set up an I/O context.
+//
+// @param   io: the context to initialise.
+// @param   depth: maximum operations in flight, 0 for RS_IO_DEFAULT_DEPTH.
+// @param   flags: RS_IO_ flags.
+// @return  0 on success, otherwise a negative RS_ERR_ code. Failure to set
+//          up io_uring is not an error; check io->backend.
+int rs_io_init(rs_io_t * io, int depth, int flags);
+
+// Tear down an I/O context. Outstanding operations are waited for.
+void rs_io_free(rs_io_t * io);
+
+// Register buffers for use with the buffer index argument of
+// rs_io_read()/rs_io_write(). Registration failing (e.g. due to
+// RLIMIT_MEMLOCK) is not an error, the buffers are then used unregistered.
+void rs_io_register_buffers(rs_io_t * io, const struct iovec * buffers,
+                            int count);
+
+// Queue a positional read or write. With the io_uring backend the operation
+// completes some time before the next rs_io_wait() returns; the buffer must
+// stay valid until then. With the sync backend it completes immediately.
+//
+// @param   bufferIndex: index of a registered buffer containing the data,
+//                       or -1 if the buffer is not registered.
+// @return  0 on success, otherwise RS_ERR_IO.
+int rs_io_read(rs_io_t * io, int fd, void * buffer, size_t length,
+               uint64_t offset, int bufferIndex);
+int rs_io_write(rs_io_t * io, int fd, const void * buffer, size_t length,
+                uint64_t offset, int bufferIndex);
+
+// Submit everything queued and wait for all operations to complete.
+//
+// @return  0 if every operation since the last wait transferred all of its
+//          data, otherwise RS_ERR_IO.
+int rs_io_wait(rs_io_t * io);
+
+// Name of the backend in use, for diagnostics.
+const char * rs_io_backend_name(const rs_io_t * io);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_IO_H
@@ -0,0 +1,199 @@
+//
+// Lazy verify-on-read access to a container.
+//
+// @author Jarrod Bennett
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rs_lazy.h"
+
+// Verify one block if it has not been already.
+static int verify_block(rs_lazy_t * lazy, uint64_t block);
+
+static int test_bit(const uint64_t * bitmap, uint64_t bit);
+static void set_bit(uint64_t * bitmap, uint64_t bit);
+
+int rs_lazy_open(rs_lazy_t * lazy, int fd) {
+
+    memset(lazy, 0, sizeof(*lazy));
+
+    int err = rs_container_open_mode(&lazy->container, fd,
+                                     RS_CONTAINER_PRIVATE);
+    if (err) {
+        return err;
+    }
+
+    size_t words = (size_t) ((lazy->container.blocks + 63) / 64) + 1;
+    lazy->verified = calloc(words, sizeof(uint64_t));
+    lazy->failed = calloc(words, sizeof(uint64_t));
+    if (lazy->verified == NULL || lazy->failed == NULL) {
+        free(lazy->verified);
+        free(lazy->failed);
+        rs_container_close(&lazy->container);
+        return RS_ERR_NO_MEMORY;
+    }
+
+    for (int i = 0; i < RS_LAZY_LOCKS; i++) {
+        pthread_mutex_init(&lazy->locks[i], NULL);
+    }
+
+    return 0;
+}
+
+void rs_lazy_close(rs_lazy_t * lazy) {
+
+    for (int i = 0; i < RS_LAZY_LOCKS; i++) {
+        pthread_mutex_destroy(&lazy->locks[i]);
+    }
+    free(lazy->verified);
+    free(lazy->failed);
+    lazy->verified = NULL;
+    lazy->failed = NULL;
+    rs_container_close(&lazy->container);
+}
+
+int rs_lazy_verify(rs_lazy_t * lazy, uint64_t offset, size_t length) {
+
+    const rs_container_t * container = &lazy->container;
+    if (offset > container->length || length > container->length - offset) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    if (length == 0) {
+        return 0;
+    }
+
+    uint64_t first = offset / container->blockData;
+    uint64_t last = (offset + length - 1) / container->blockData;
+    int result = 0;
+
+    for (uint64_t block = first; block <= last; block++) {
+        int err = verify_block(lazy, block);
+        if (err && result == 0) {
+            result = err;
+        }
+    }
+
+    return result;
+}
+
+const uint8_t * rs_lazy_block(rs_lazy_t * lazy, uint64_t block, int * err) {
+
+    const rs_container_t * container = &lazy->container;
+    if (block >= container->blocks) {
+        if (err != NULL) {
+            *err = RS_ERR_INVALID_ARGS;
+        }
+        return NULL;
+    }
+
+    int result = verify_block(lazy, block);
+    if (err != NULL) {
+        *err = result;
+    }
+
+    return container->map + rs_container_block_offset(container, block);
+}
+
+int rs_lazy_read(rs_lazy_t * lazy, uint64_t offset, void * buffer,
+                 size_t length) {
+
+    const rs_container_t * container = &lazy->container;
+    if (offset > container->length || length > container->length - offset) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    uint8_t * out = buffer;
+    uint64_t end = offset + length;
+    int result = 0;
+
+    while (offset < end) {
+        uint64_t block = offset / container->blockData;
+        uint64_t blockStart = block * container->blockData;
+        size_t from = (size_t) (offset - blockStart);
+        size_t take = container->blockData - from;
+        if (take > end - offset) {
+            take = (size_t) (end - offset);
+        }
+
+        int err;
+        const uint8_t * data = rs_lazy_block(lazy, block, &err);
+        if (err && result == 0) {
+            result = err;
+        }
+        memcpy(out, &data[from], take);
+
+        out += take;
+        offset += take;
+    }
+
+    return result;
+}
+
+void rs_lazy_get_counters(const rs_lazy_t * lazy,
+                          rs_lazy_counters_t * counters) {
+
+    const rs_lazy_counters_t * c = &lazy->counters;
+    counters->bytesVerified = __atomic_load_n(&c->bytesVerified,
+                                              __ATOMIC_RELAXED);
+    counters->blocksVerified = __atomic_load_n(&c->blocksVerified,
+                                               __ATOMIC_RELAXED);
+    counters->codewordsCorrected = __atomic_load_n(&c->codewordsCorrected,
+                                                   __ATOMIC_RELAXED);
+    counters->symbolsCorrected = __atomic_load_n(&c->symbolsCorrected,
+                                                 __ATOMIC_RELAXED);
+    counters->blocksFailed = __atomic_load_n(&c->blocksFailed,
+                                             __ATOMIC_RELAXED);
+}
+
+static int verify_block(rs_lazy_t * lazy, uint64_t block) {
+
+    // Fast path: already verified, no locking
+    if (test_bit(lazy->verified, block)) {
+        return test_bit(lazy->failed, block) ? RS_ERR_UNCORRECTABLE : 0;
+    }
+
+    pthread_mutex_t * lock = &lazy->locks[block % RS_LAZY_LOCKS];
+    pthread_mutex_lock(lock);
+
+    int result;
+    if (test_bit(lazy->verified, block)) {
+        // Another reader got here first
+        result = test_bit(lazy->failed, block) ? RS_ERR_UNCORRECTABLE : 0;
+    } else {
+        rs_file_stats_t stats;
+        memset(&stats, 0, sizeof(stats));
+        result = rs_container_repair_block(&lazy->container, block, &stats);
+
+        rs_lazy_counters_t * c = &lazy->counters;
+        __atomic_fetch_add(&c->bytesVerified, lazy->container.blockData,
+                           __ATOMIC_RELAXED);
+        __atomic_fetch_add(&c->blocksVerified, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&c->codewordsCorrected, stats.corrected,
+                           __ATOMIC_RELAXED);
+        __atomic_fetch_add(&c->symbolsCorrected, stats.symbols,
+                           __ATOMIC_RELAXED);
+        if (result) {
+            __atomic_fetch_add(&c->blocksFailed, 1, __ATOMIC_RELAXED);
+            set_bit(lazy->failed, block);
+        }
+        // Publishes the repaired block to lock-free readers
+        set_bit(lazy->verified, block);
+    }
+
+    pthread_mutex_unlock(lock);
+    return result;
+}
+
+static int test_bit(const uint64_t * bitmap, uint64_t bit) {
+
+    uint64_t word = __atomic_load_n(&bitmap[bit / 64], __ATOMIC_ACQUIRE);
+    return (int) ((word >> (bit % 64)) & 1);
+}
+
+static void set_bit(uint64_t * bitmap, uint64_t bit) {
+
+    __atomic_fetch_or(&bitmap[bit / 64], (uint64_t) 1 << (bit % 64),
+                      __ATOMIC_RELEASE);
+}
@@ -0,0 +1,90 @@
+//
+// Lazy verify-on-read access to a container. Nothing is checked when the
+// archive is opened; instead the first access to each block runs the
+// syndrome check over the block's codewords, decodes only those with
+// non-zero syndromes, and patches the corrections into a private
+// copy-on-write mapping of the file. A bitmap of verified blocks means
+// every later access reads the mapping directly with no further work.
+//
+// The unit of verification is the container block. With the default
+// RS(255, 223) code at depth 16 a block carries 3568 data bytes, so it is
+// close to a page of the archive.
+//
+// All functions are thread safe. Verification of the same block by
+// concurrent readers is serialised by a small set of striped locks;
+// verified blocks are read without locking.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_LAZY_H
+#define RS_LAZY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_container.h"
+
+// Number of striped verification locks.
+#define RS_LAZY_LOCKS           (64)
+
+typedef struct rs_lazy_counters {
+    uint64_t bytesVerified;     // data bytes of verified blocks
+    uint64_t blocksVerified;
+    uint64_t codewordsCorrected;
+    uint64_t symbolsCorrected;
+    uint64_t blocksFailed;      // blocks which could not be corrected
+} rs_lazy_counters_t;
+
+typedef struct rs_lazy {
+    rs_container_t container;
+    uint64_t * verified;        // one bit per block
+    uint64_t * failed;          // one bit per block, set with verified
+    pthread_mutex_t locks[RS_LAZY_LOCKS];
+    rs_lazy_counters_t counters;    // updated with relaxed atomics
+} rs_lazy_t;
+
+// Map a container for lazy verification.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_lazy_open(rs_lazy_t * lazy, int fd);
+
+// Unmap the container and release the bitmaps.
+void rs_lazy_close(rs_lazy_t * lazy);
+
+// Verify (and repair) every block overlapping a byte range of the data, if
+// not already done.
+//
+// @return  0 on success, RS_ERR_UNCORRECTABLE if any block could not be
+//          corrected, otherwise another negative RS_ERR_ code.
+int rs_lazy_verify(rs_lazy_t * lazy, uint64_t offset, size_t length);
+
+// Get the verified data of a block in place, without copying.
+//
+// @param   block: block number, 0..blocks-1.
+// @param   err: optional, receives the result as for rs_lazy_verify().
+// @return  a pointer to the block's blockData data bytes (the final block
+//          ends in padding), or NULL if block is out of range.
+const uint8_t * rs_lazy_block(rs_lazy_t * lazy, uint64_t block, int * err);
+
+// Copy a byte range of the data, verifying it first.
+//
+// @return  as for rs_lazy_verify(), or RS_ERR_INVALID_ARGS if the range is
+//          beyond the end of the data.
+int rs_lazy_read(rs_lazy_t * lazy, uint64_t offset, void * buffer,
+                 size_t length);
+
+// Take a snapshot of the counters.
+void rs_lazy_get_counters(const rs_lazy_t * lazy,
+                          rs_lazy_counters_t * counters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_LAZY_H
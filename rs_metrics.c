@@ -0,0 +1,181 @@
+//
+// OpenMetrics text exposition of codec statistics.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rs_codec.h"
+#include "rs_file.h"
+#include "rs_metrics.h"
+
+// Text being rendered. Output beyond the buffer is counted but dropped.
+typedef struct text {
+    char * buffer;
+    size_t size;
+    size_t length;
+} text_t;
+
+static void append(text_t * text, const char * format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+static void counter(text_t * text, const char * name, const char * help,
+                    const char * labels, uint64_t value);
+
+// Render a histogram from log2 buckets, bucket b counting values up to
+// 2^b - 1.
+static void histogram(text_t * text, const char * name, const char * help,
+                      const char * labels, const uint64_t * buckets,
+                      int nbuckets, uint64_t sum);
+
+size_t rs_metrics_render(const rs_codec_stats_t * stats, const char * labels,
+                         char * buffer, size_t size) {
+
+    rs_codec_stats_t s;
+    rs_stats_snapshot(stats, &s);
+    if (labels != NULL && labels[0] == '\0') {
+        labels = NULL;
+    }
+
+    text_t text = {buffer, size, 0};
+    if (size > 0) {
+        buffer[0] = '\0';
+    }
+
+    counter(&text, "rs_codec_encoded", "Codewords encoded.", labels,
+            s.encoded);
+    counter(&text, "rs_codec_decoded", "Codewords decoded.", labels,
+            s.decoded);
+    counter(&text, "rs_codec_corrected",
+            "Decoded codewords which needed correction.", labels,
+            s.corrected);
+    counter(&text, "rs_codec_failures", "Uncorrectable codewords.", labels,
+            s.failures);
+    counter(&text, "rs_codec_symbols_corrected", "Symbols corrected.",
+            labels, s.symbols);
+    counter(&text, "rs_codec_erasures", "Erasures given to the decoder.",
+            labels, s.erasures);
+
+    uint64_t correctionSum = s.symbols;
+    histogram(&text, "rs_codec_corrections",
+              "Symbols corrected per decoded codeword.", labels,
+              s.corrections, RS_STATS_CORRECTION_BUCKETS, correctionSum);
+    histogram(&text, "rs_codec_encode_cycles",
+              "Timestamp counter cycles per encode call.", labels,
+              s.encodeCycles.buckets, RS_STATS_BUCKETS, s.encodeCycles.sum);
+    histogram(&text, "rs_codec_decode_cycles",
+              "Timestamp counter cycles per decode call.", labels,
+              s.decodeCycles.buckets, RS_STATS_BUCKETS, s.decodeCycles.sum);
+
+    append(&text, "# EOF\n");
+
+    return text.length;
+}
+
+int rs_metrics_write_file(const rs_codec_stats_t * stats, const char * labels,
+                          const char * path) {
+
+    size_t length = rs_metrics_render(stats, labels, NULL, 0);
+    char * buffer = malloc(length + 1);
+    size_t pathLength = strlen(path);
+    char * temp = malloc(pathLength + 5);
+    if (buffer == NULL || temp == NULL) {
+        free(buffer);
+        free(temp);
+        return RS_ERR_NO_MEMORY;
+    }
+
+    // The counters may have moved on, so render again into the buffer
+    length = rs_metrics_render(stats, labels, buffer, length + 1);
+    memcpy(temp, path, pathLength);
+    memcpy(&temp[pathLength], ".tmp", 5);
+
+    int err = RS_ERR_IO;
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        err = rs_file_write_all(fd, (const uint8_t *) buffer, length);
+        if (close(fd) != 0) {
+            err = RS_ERR_IO;
+        }
+        if (err == 0 && rename(temp, path) != 0) {
+            err = RS_ERR_IO;
+        }
+        if (err) {
+            unlink(temp);
+        }
+    }
+
+    free(buffer);
+    free(temp);
+
+    return err;
+}
+
+static void append(text_t * text, const char * format, ...) {
+
+    size_t space = text->length < text->size ? text->size - text->length : 0;
+    char * at = space > 0 ? text->buffer + text->length : NULL;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(at, space, format, args);
+    va_end(args);
+
+    if (written > 0) {
+        text->length += (size_t) written;
+    }
+}
+
+static void counter(text_t * text, const char * name, const char * help,
+                    const char * labels, uint64_t value) {
+
+    append(text, "# TYPE %s counter\n# HELP %s %s\n", name, name, help);
+    if (labels != NULL) {
+        append(text, "%s_total{%s} %llu\n", name, labels,
+               (unsigned long long) value);
+    } else {
+        append(text, "%s_total %llu\n", name, (unsigned long long) value);
+    }
+}
+
+static void histogram(text_t * text, const char * name, const char * help,
+                      const char * labels, const uint64_t * buckets,
+                      int nbuckets, uint64_t sum) {
+
+    const char * sep = labels != NULL ? "," : "";
+    if (labels == NULL) {
+        labels = "";
+    }
+
+    append(text, "# TYPE %s histogram\n# HELP %s %s\n", name, name, help);
+
+    // The last bucket is open ended and only appears in +Inf
+    uint64_t cumulative = 0;
+    for (int b = 0; b < nbuckets - 1; b++) {
+        cumulative += buckets[b];
+        append(text, "%s_bucket{%s%sle=\"%llu\"} %llu\n", name, labels, sep,
+               (unsigned long long) ((1ULL << b) - 1),
+               (unsigned long long) cumulative);
+    }
+    cumulative += buckets[nbuckets - 1];
+    append(text, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep,
+           (unsigned long long) cumulative);
+
+    if (labels[0] != '\0') {
+        append(text, "%s_count{%s} %llu\n%s_sum{%s} %llu\n", name, labels,
+               (unsigned long long) cumulative, name, labels,
+               (unsigned long long) sum);
+    } else {
+        append(text, "%s_count %llu\n%s_sum %llu\n", name,
+               (unsigned long long) cumulative, name,
+               (unsigned long long) sum);
+    }
+}
@@ -0,0 +1,54 @@
+//
+// OpenMetrics (Prometheus) text exposition of codec statistics, for
+// scraping by a node exporter textfile collector or serving from a daemon.
+//
+// Metric families, all prefixed rs_codec_:
+//
+//   encoded_total, decoded_total          codewords
+//   corrected_total, failures_total       codewords
+//   symbols_corrected_total               symbols
+//   erasures_total                        erasures given to the decoder
+//   corrections                           histogram, symbols corrected per
+//                                         decoded codeword
+//   encode_cycles, decode_cycles          histograms, cycles per call
+//
+// Rates and ratios such as the failure rate are left to the query, e.g.
+// rate(rs_codec_failures_total[5m]) / rate(rs_codec_decoded_total[5m]).
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_METRICS_H
+#define RS_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "rs_stats.h"
+
+// Render a snapshot of stats as OpenMetrics text, ending in "# EOF".
+//
+// @param   labels: optional labels added to every sample, in exposition
+//                  form without braces, e.g. "link=\"uplink\"". May be NULL.
+// @param   buffer: receives the text, NUL terminated. May be NULL if size is
+//                  0, to find the length needed.
+// @return  the length of the text (excluding the NUL) as for snprintf();
+//          the text was truncated if this is size or more.
+size_t rs_metrics_render(const rs_codec_stats_t * stats, const char * labels,
+                         char * buffer, size_t size);
+
+// Render to a file, replacing it atomically via a temporary file so a
+// scraper never sees a partial exposition.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_metrics_write_file(const rs_codec_stats_t * stats, const char * labels,
+                          const char * path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_METRICS_H
@@ -0,0 +1,232 @@
+//
+// Ordered, multi-threaded batch pipeline.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rs_pipeline.h"
+
+// Slots per worker thread. Two gives double buffering.
+#define SLOTS_PER_THREAD        (2)
+
+typedef struct slot {
+    uint8_t * buffer;
+    size_t length;
+    uint64_t batch;     // the batch this slot is currently assigned to
+    int filled;         // batch has been produced and awaits consumption
+} slot_t;
+
+typedef struct pipeline {
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    slot_t * slots;
+    int nslots;
+
+    uint64_t nbatches;
+    uint64_t nextBatch; // next batch to hand to a worker
+    int error;          // first callback error, stops the pipeline
+
+    rs_pipeline_produce_fn produce;
+    void * ctx;
+} pipeline_t;
+
+typedef struct worker {
+    pipeline_t * pipeline;
+    int index;
+} worker_t;
+
+static int run(pipeline_t * p, int threads, rs_pipeline_consume_fn consume);
+static void * worker_main(void * arg);
+
+int rs_pipeline_cpu_count(void) {
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int) cpus : 1;
+}
+
+int rs_pipeline_threads(int threads, uint64_t nbatches) {
+
+    if (threads <= 0) {
+        threads = rs_pipeline_cpu_count();
+    }
+    if ((uint64_t) threads > nbatches) {
+        threads = nbatches > 0 ? (int) nbatches : 1;
+    }
+    return threads;
+}
+
+int rs_pipeline_run(uint64_t nbatches, int threads, size_t slotSize,
+                    rs_pipeline_produce_fn produce,
+                    rs_pipeline_consume_fn consume, void * ctx) {
+
+    threads = rs_pipeline_threads(threads, nbatches);
+
+    pipeline_t p;
+    p.nslots = threads * SLOTS_PER_THREAD;
+    p.produce = produce;
+    p.ctx = ctx;
+    p.nbatches = nbatches;
+
+    p.slots = calloc((size_t) p.nslots, sizeof(slot_t));
+    if (p.slots == NULL) {
+        return -1;
+    }
+    int result = 0;
+    for (int i = 0; i < p.nslots; i++) {
+        p.slots[i].buffer = malloc(slotSize);
+        if (p.slots[i].buffer == NULL) {
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        result = run(&p, threads, consume);
+    }
+
+    for (int i = 0; i < p.nslots; i++) {
+        free(p.slots[i].buffer);
+    }
+    free(p.slots);
+
+    return result;
+}
+
+int rs_pipeline_run_slots(uint64_t nbatches, uint8_t * const * slots,
+                          int nslots, rs_pipeline_produce_fn produce,
+                          rs_pipeline_consume_fn consume, void * ctx) {
+
+    if (nslots < SLOTS_PER_THREAD) {
+        return -1;
+    }
+
+    pipeline_t p;
+    p.nslots = nslots;
+    p.produce = produce;
+    p.ctx = ctx;
+    p.nbatches = nbatches;
+
+    p.slots = calloc((size_t) p.nslots, sizeof(slot_t));
+    if (p.slots == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < p.nslots; i++) {
+        p.slots[i].buffer = slots[i];
+    }
+
+    int result = run(&p, nslots / SLOTS_PER_THREAD, consume);
+    free(p.slots);
+
+    return result;
+}
+
+static int run(pipeline_t * p, int threads, rs_pipeline_consume_fn consume) {
+
+    p->nextBatch = 0;
+    p->error = 0;
+    for (int i = 0; i < p->nslots; i++) {
+        p->slots[i].batch = (uint64_t) i;
+        p->slots[i].filled = 0;
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->changed, NULL);
+
+    worker_t * workers = malloc((size_t) threads * sizeof(worker_t));
+    pthread_t * tids = malloc((size_t) threads * sizeof(pthread_t));
+    int started = 0;
+    if (workers != NULL && tids != NULL) {
+        for (; started < threads; started++) {
+            workers[started].pipeline = p;
+            workers[started].index = started;
+            if (pthread_create(&tids[started], NULL, worker_main,
+                               &workers[started])) {
+                break;
+            }
+        }
+    }
+
+    int result = started > 0 ? 0 : -1;
+    if (started == 0) {
+        p->error = -1;
+    }
+
+    // Consume batches in order on this thread
+    for (uint64_t batch = 0; batch < p->nbatches && result == 0; batch++) {
+        slot_t * slot = &p->slots[batch % (uint64_t) p->nslots];
+
+        pthread_mutex_lock(&p->lock);
+        while (!slot->filled && p->error == 0) {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        result = p->error;
+        pthread_mutex_unlock(&p->lock);
+
+        if (result == 0) {
+            result = consume(p->ctx, batch, slot->buffer, slot->length);
+        }
+
+        // Hand the slot to the batch nslots ahead
+        pthread_mutex_lock(&p->lock);
+        if (result != 0 && p->error == 0) {
+            p->error = result;
+        }
+        slot->filled = 0;
+        slot->batch = batch + (uint64_t) p->nslots;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    free(workers);
+
+    pthread_cond_destroy(&p->changed);
+    pthread_mutex_destroy(&p->lock);
+
+    return result;
+}
+
+static void * worker_main(void * arg) {
+
+    worker_t * worker = arg;
+    pipeline_t * p = worker->pipeline;
+
+    pthread_mutex_lock(&p->lock);
+    while (p->error == 0 && p->nextBatch < p->nbatches) {
+        uint64_t batch = p->nextBatch++;
+        slot_t * slot = &p->slots[batch % (uint64_t) p->nslots];
+
+        // Wait for the consumer to release the slot from its previous batch
+        while (slot->batch != batch && p->error == 0) {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        if (p->error != 0) {
+            break;
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        size_t length = 0;
+        int err = p->produce(p->ctx, worker->index, batch, slot->buffer,
+                             &length);
+
+        pthread_mutex_lock(&p->lock);
+        if (err != 0 && p->error == 0) {
+            p->error = err;
+        }
+        slot->length = length;
+        slot->filled = 1;
+        pthread_cond_broadcast(&p->changed);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
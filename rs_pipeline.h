@@ -0,0 +1,77 @@
+//
+// Ordered, multi-threaded batch pipeline. Work is split into numbered
+// batches which are processed by a pool of worker threads into a ring of
+// output slots, while the calling thread consumes the filled slots strictly
+// in batch order. Each worker owns two slots' worth of the ring so that
+// producing batch i + 1 overlaps with consuming batch i (double buffering),
+// and input mapped with mmap() is faulted in by the workers as they go.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_PIPELINE_H
+#define RS_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Produce one batch into an output slot.
+//
+// @param   ctx: caller context passed to rs_pipeline_run().
+// @param   worker: index of the calling worker thread, 0..threads-1, for
+//                  callers keeping per-thread state.
+// @param   batch: the batch number, 0..nbatches-1.
+// @param   slot: the output buffer of slotSize bytes.
+// @param   length: set to the number of bytes of slot to be consumed.
+// @return  0 on success, otherwise non-zero to abort the pipeline.
+typedef int (* rs_pipeline_produce_fn)(void * ctx, int worker,
+                                       uint64_t batch, uint8_t * slot,
+                                       size_t * length);
+
+// Consume one batch. Called on the calling thread, in batch order.
+//
+// @return  0 on success, otherwise non-zero to abort the pipeline.
+typedef int (* rs_pipeline_consume_fn)(void * ctx, uint64_t batch,
+                                       const uint8_t * slot, size_t length);
+
+// Run a pipeline to completion.
+//
+// @param   nbatches: the number of batches to process.
+// @param   threads: the number of worker threads, 0 for one per CPU.
+// @param   slotSize: the size in bytes of each output slot.
+// @param   produce: called from the worker threads.
+// @param   consume: called from the calling thread in batch order.
+// @param   ctx: passed through to produce and consume.
+// @return  0 on success, otherwise the first non-zero value returned by a
+//          callback, or -1 if the pipeline could not be started.
+int rs_pipeline_run(uint64_t nbatches, int threads, size_t slotSize,
+                    rs_pipeline_produce_fn produce,
+                    rs_pipeline_consume_fn consume, void * ctx);
+
+// Run a pipeline over caller-provided slot buffers, e.g. buffers aligned for
+// O_DIRECT or registered with io_uring. Batch b is always produced into
+// slots[b % nslots]. The number of worker threads is nslots / 2.
+//
+// @param   slots: nslots buffers, each large enough for any batch.
+// @param   nslots: the number of slots, at least 2.
+// @return  as for rs_pipeline_run().
+int rs_pipeline_run_slots(uint64_t nbatches, uint8_t * const * slots,
+                          int nslots, rs_pipeline_produce_fn produce,
+                          rs_pipeline_consume_fn consume, void * ctx);
+
+// Clamp a requested thread count: 0 selects one per CPU, and there are
+// never more threads than batches.
+int rs_pipeline_threads(int threads, uint64_t nbatches);
+
+// Number of online CPUs, used for the default thread count.
+int rs_pipeline_cpu_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_PIPELINE_H
@@ -0,0 +1,420 @@
+//
+// Encoder plans and wisdom.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rs_file.h"
+#include "rs_plan.h"
+
+// Minimum length of one timing run of a kernel.
+#define MEASURE_NS              (1000000)
+
+// Timing runs per kernel; the fastest counts.
+#define MEASURE_RUNS            (3)
+
+// Largest wisdom file read by rs_plan_import_wisdom_file().
+#define WISDOM_FILE_MAX         (1 << 20)
+
+typedef struct wisdom {
+    rs_plan_params_t params;
+    int kernel;
+} wisdom_t;
+
+static pthread_mutex_t wisdomLock = PTHREAD_MUTEX_INITIALIZER;
+static wisdom_t * wisdom;
+static int wisdomCount;
+static int wisdomSize;
+
+// Look up the wisdom for a code, or -1. Call with wisdomLock held.
+static int wisdom_find(const rs_plan_params_t * params);
+
+// Add or replace the wisdom for a code. Call with wisdomLock held.
+static int wisdom_add(const rs_plan_params_t * params, int kernel);
+
+// Time a kernel on a batch, returning the fastest ns per codeword.
+static double measure(rs_plan_t * plan, int kernel, uint8_t * batch,
+                      int count);
+
+static uint64_t now_ns(void);
+
+void rs_plan_params_default(rs_plan_params_t * params) {
+
+    params->m = 8;
+    params->nparity = 32;
+    params->k = 223;
+    params->batch = 1;
+}
+
+int rs_plan_create(rs_plan_t * plan, const rs_plan_params_t * params,
+                   int flags) {
+
+    if (plan == NULL || params == NULL || params->k < 1 ||
+        params->batch < 1) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    int err = rs_codec_init(&plan->codec, params->m, params->nparity);
+    if (err) {
+        return err;
+    }
+    if (params->k + params->nparity > plan->codec.nn) {
+        rs_codec_free(&plan->codec);
+        return RS_ERR_INVALID_ARGS;
+    }
+    plan->params = *params;
+    plan->fromWisdom = 0;
+    for (int kernel = 0; kernel < RS_KERNEL_COUNT; kernel++) {
+        plan->nanoseconds[kernel] = 0;
+    }
+
+    // rs_codec_init() has already selected a forced kernel
+    if (rs_codec_kernel_forced() >= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&wisdomLock);
+    int kernel = wisdom_find(params);
+    pthread_mutex_unlock(&wisdomLock);
+
+    if (kernel >= 0 && rs_codec_set_kernel(&plan->codec, kernel) == 0) {
+        plan->fromWisdom = 1;
+        return 0;
+    }
+
+    if (!(flags & RS_PLAN_MEASURE)) {
+        // Guess: vector registers if the CPU has them, otherwise lanes
+        // when there are codewords to run side by side
+        kernel = RS_KERNEL_SCALAR;
+        if (rs_codec_kernel_supported(&plan->codec, RS_KERNEL_SSSE3)) {
+            kernel = RS_KERNEL_SSSE3;
+        } else if (params->batch >= 4) {
+            kernel = RS_KERNEL_LANES;
+        }
+        err = rs_codec_set_kernel(&plan->codec, kernel);
+        if (err) {
+            rs_codec_free(&plan->codec);
+        }
+        return err;
+    }
+
+    // Time every supported kernel on a batch of random codewords
+    int n = params->k + params->nparity;
+    uint8_t * batch = malloc((size_t) params->batch * (size_t) n);
+    if (batch == NULL) {
+        rs_codec_free(&plan->codec);
+        return RS_ERR_NO_MEMORY;
+    }
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < (size_t) params->batch * (size_t) n; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        batch[i] = (uint8_t) (x & (uint32_t) plan->codec.nn);
+    }
+
+    int best = RS_KERNEL_SCALAR;
+    for (kernel = 0; kernel < RS_KERNEL_COUNT; kernel++) {
+        if (!rs_codec_kernel_supported(&plan->codec, kernel)) {
+            continue;
+        }
+        double ns = measure(plan, kernel, batch, params->batch);
+        if (ns < 0) {
+            free(batch);
+            rs_codec_free(&plan->codec);
+            return RS_ERR_NO_MEMORY;
+        }
+        plan->nanoseconds[kernel] = ns;
+        if (ns < plan->nanoseconds[best]) {
+            best = kernel;
+        }
+    }
+    free(batch);
+
+    err = rs_codec_set_kernel(&plan->codec, best);
+    if (err) {
+        rs_codec_free(&plan->codec);
+        return err;
+    }
+
+    pthread_mutex_lock(&wisdomLock);
+    wisdom_add(params, best);
+    pthread_mutex_unlock(&wisdomLock);
+
+    return 0;
+}
+
+void rs_plan_destroy(rs_plan_t * plan) {
+
+    if (plan == NULL) {
+        return;
+    }
+    rs_codec_free(&plan->codec);
+}
+
+int rs_plan_encode(const rs_plan_t * plan, const uint8_t * msg,
+                   size_t msgStride, uint8_t * parity, size_t parityStride,
+                   int count) {
+
+    return rs_codec_encode_batch(&plan->codec, msg, plan->params.k,
+                                 msgStride, parity, parityStride, count);
+}
+
+size_t rs_plan_export_wisdom(char * buffer, size_t size) {
+
+    pthread_mutex_lock(&wisdomLock);
+
+    size_t length = 0;
+    int written = snprintf(buffer, size, "%s", RS_PLAN_WISDOM_HEADER);
+    length += written > 0 ? (size_t) written : 0;
+
+    for (int i = 0; i < wisdomCount; i++) {
+        const wisdom_t * w = &wisdom[i];
+        char * at = length < size ? buffer + length : NULL;
+        written = snprintf(at, at != NULL ? size - length : 0,
+                           "%d %d %d %d %s\n", w->params.m,
+                           w->params.nparity, w->params.k, w->params.batch,
+                           rs_codec_kernel_name(w->kernel));
+        length += written > 0 ? (size_t) written : 0;
+    }
+
+    pthread_mutex_unlock(&wisdomLock);
+
+    return length;
+}
+
+int rs_plan_import_wisdom(const char * text) {
+
+    size_t headerLength = strlen(RS_PLAN_WISDOM_HEADER);
+    if (strncmp(text, RS_PLAN_WISDOM_HEADER, headerLength) != 0) {
+        return RS_ERR_FORMAT;
+    }
+
+    // Parse everything before importing anything
+    int count = 0;
+    for (const char * c = text + headerLength; *c != '\0'; c++) {
+        count += *c == '\n';
+    }
+    wisdom_t * parsed = malloc(((size_t) count + 1) * sizeof(wisdom_t));
+    if (parsed == NULL) {
+        return RS_ERR_NO_MEMORY;
+    }
+
+    int nparsed = 0;
+    const char * line = text + headerLength;
+    while (*line != '\0') {
+        const char * end = strchr(line, '\n');
+        if (end == NULL) {
+            end = line + strlen(line);
+        }
+
+        char name[32];
+        int used = 0;
+        wisdom_t * w = &parsed[nparsed];
+        if (end > line &&
+            (sscanf(line, "%d %d %d %d %31s%n", &w->params.m,
+                    &w->params.nparity, &w->params.k, &w->params.batch,
+                    name, &used) != 5 || line + used != end)) {
+            free(parsed);
+            return RS_ERR_FORMAT;
+        }
+        if (end > line) {
+            w->kernel = rs_codec_kernel_lookup(name);
+            nparsed += w->kernel >= 0;
+        }
+
+        line = *end == '\n' ? end + 1 : end;
+    }
+
+    int err = 0;
+    pthread_mutex_lock(&wisdomLock);
+    for (int i = 0; i < nparsed && err == 0; i++) {
+        err = wisdom_add(&parsed[i].params, parsed[i].kernel);
+    }
+    pthread_mutex_unlock(&wisdomLock);
+    free(parsed);
+
+    return err;
+}
+
+int rs_plan_export_wisdom_file(const char * path) {
+
+    size_t pathLength = strlen(path);
+    char * temp = malloc(pathLength + 5);
+    if (temp == NULL) {
+        return RS_ERR_NO_MEMORY;
+    }
+
+    // Planning in another thread may add wisdom between sizing the buffer
+    // and filling it, in which case the text was cut short, so size it
+    // again until it fits
+    char * buffer = NULL;
+    size_t length = rs_plan_export_wisdom(NULL, 0);
+    for (;;) {
+        char * grown = realloc(buffer, length + 1);
+        if (grown == NULL) {
+            free(buffer);
+            free(temp);
+            return RS_ERR_NO_MEMORY;
+        }
+        buffer = grown;
+        size_t needed = rs_plan_export_wisdom(buffer, length + 1);
+        if (needed <= length) {
+            length = needed;
+            break;
+        }
+        length = needed;
+    }
+    memcpy(temp, path, pathLength);
+    memcpy(&temp[pathLength], ".tmp", 5);
+
+    int err = RS_ERR_IO;
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        err = rs_file_write_all(fd, (const uint8_t *) buffer, length);
+        if (close(fd) != 0) {
+            err = RS_ERR_IO;
+        }
+        if (err == 0 && rename(temp, path) != 0) {
+            err = RS_ERR_IO;
+        }
+        if (err) {
+            unlink(temp);
+        }
+    }
+
+    free(buffer);
+    free(temp);
+
+    return err;
+}
+
+int rs_plan_import_wisdom_file(const char * path) {
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return RS_ERR_IO;
+    }
+
+    char * buffer = malloc(WISDOM_FILE_MAX + 1);
+    if (buffer == NULL) {
+        close(fd);
+        return RS_ERR_NO_MEMORY;
+    }
+
+    size_t length = 0;
+    ssize_t got;
+    while (length < WISDOM_FILE_MAX &&
+           (got = read(fd, buffer + length, WISDOM_FILE_MAX - length)) > 0) {
+        length += (size_t) got;
+    }
+    close(fd);
+
+    int err = RS_ERR_FORMAT;
+    if (got >= 0 && length < WISDOM_FILE_MAX) {
+        buffer[length] = '\0';
+        err = rs_plan_import_wisdom(buffer);
+    } else if (got < 0) {
+        err = RS_ERR_IO;
+    }
+    free(buffer);
+
+    return err;
+}
+
+void rs_plan_forget_wisdom(void) {
+
+    pthread_mutex_lock(&wisdomLock);
+    free(wisdom);
+    wisdom = NULL;
+    wisdomCount = 0;
+    wisdomSize = 0;
+    pthread_mutex_unlock(&wisdomLock);
+}
+
+static int wisdom_find(const rs_plan_params_t * params) {
+
+    for (int i = 0; i < wisdomCount; i++) {
+        const rs_plan_params_t * p = &wisdom[i].params;
+        if (p->m == params->m && p->nparity == params->nparity &&
+            p->k == params->k && p->batch == params->batch) {
+            return wisdom[i].kernel;
+        }
+    }
+    return -1;
+}
+
+static int wisdom_add(const rs_plan_params_t * params, int kernel) {
+
+    for (int i = 0; i < wisdomCount; i++) {
+        const rs_plan_params_t * p = &wisdom[i].params;
+        if (p->m == params->m && p->nparity == params->nparity &&
+            p->k == params->k && p->batch == params->batch) {
+            wisdom[i].kernel = kernel;
+            return 0;
+        }
+    }
+
+    if (wisdomCount == wisdomSize) {
+        int size = wisdomSize > 0 ? wisdomSize * 2 : 16;
+        wisdom_t * grown = realloc(wisdom, (size_t) size * sizeof(wisdom_t));
+        if (grown == NULL) {
+            return RS_ERR_NO_MEMORY;
+        }
+        wisdom = grown;
+        wisdomSize = size;
+    }
+    wisdom[wisdomCount].params = *params;
+    wisdom[wisdomCount].kernel = kernel;
+    wisdomCount++;
+
+    return 0;
+}
+
+static double measure(rs_plan_t * plan, int kernel, uint8_t * batch,
+                      int count) {
+
+    if (rs_codec_set_kernel(&plan->codec, kernel) != 0) {
+        return -1;
+    }
+
+    int k = plan->params.k;
+    size_t n = (size_t) (k + plan->params.nparity);
+    double best = 0;
+
+    for (int run = 0; run < MEASURE_RUNS; run++) {
+        uint64_t codewords = 0;
+        uint64_t start = now_ns();
+        uint64_t elapsed;
+        do {
+            rs_codec_encode_batch(&plan->codec, batch, k, n, batch + k, n,
+                                  count);
+            codewords += (uint64_t) count;
+            elapsed = now_ns() - start;
+        } while (elapsed < MEASURE_NS);
+
+        double ns = (double) elapsed / (double) codewords;
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+static uint64_t now_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
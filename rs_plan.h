@@ -0,0 +1,111 @@
+//
+// Encoder plans. Which encoder kernel (see RS_KERNEL_ in rs_codec.h) runs
+// fastest depends on the CPU, the symbol size, the parity count, the
+// message length and how many codewords are encoded per call, so, as with
+// FFTW, a plan is made for one such code on the host that will run it. A
+// plan is simply a codec context with the chosen kernel selected, usable
+// with every codec function and with rs_segment.
+//
+// With RS_PLAN_MEASURE each supported kernel is timed and the fastest is
+// remembered as wisdom for the rest of the process. Wisdom can be exported
+// as a string and imported by a later process, which then plans instantly:
+//
+//   rs-wisdom 1
+//   <m> <nparity> <k> <batch> <kernel>
+//   ...
+//
+// Wisdom naming a kernel this build does not know, or this CPU cannot
+// run, is ignored. A kernel forced with RS_CODEC_KERNEL overrides both
+// wisdom and measurement, so it applies to planned codecs too.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_PLAN_H
+#define RS_PLAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+
+#define RS_PLAN_WISDOM_HEADER   "rs-wisdom 1\n"
+
+// rs_plan_create() flags.
+#define RS_PLAN_ESTIMATE        (0)     // use wisdom, else a cheap guess
+#define RS_PLAN_MEASURE         (1)     // use wisdom, else time the kernels
+
+typedef struct rs_plan_params {
+    int m;                      // bits per symbol
+    int nparity;                // parity symbols per codeword
+    int k;                      // message symbols per codeword
+    int batch;                  // codewords per rs_plan_encode() call
+} rs_plan_params_t;
+
+// A plan. All fields are read only.
+typedef struct rs_plan {
+    rs_codec_t codec;           // with the chosen kernel
+    rs_plan_params_t params;
+    int fromWisdom;             // 1 if the kernel came from wisdom
+
+    // With RS_PLAN_MEASURE, the time per codeword of each kernel, 0 if it
+    // was not timed.
+    double nanoseconds[RS_KERNEL_COUNT];
+} rs_plan_t;
+
+// Fill in the default parameters: RS(255, 223), one codeword per call.
+void rs_plan_params_default(rs_plan_params_t * params);
+
+// Make a plan. Thread safe.
+//
+// @param   flags: RS_PLAN_ESTIMATE or RS_PLAN_MEASURE.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_plan_create(rs_plan_t * plan, const rs_plan_params_t * params,
+                   int flags);
+
+// Release a plan.
+void rs_plan_destroy(rs_plan_t * plan);
+
+// Encode a batch of messages, as rs_codec_encode_batch() with the plan's k.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_plan_encode(const rs_plan_t * plan, const uint8_t * msg,
+                   size_t msgStride, uint8_t * parity, size_t parityStride,
+                   int count);
+
+// Export the wisdom gathered so far.
+//
+// @param   buffer: receives the text, NUL terminated. May be NULL if size is
+//                  0, to find the length needed.
+// @return  the length of the text (excluding the NUL) as for snprintf().
+size_t rs_plan_export_wisdom(char * buffer, size_t size);
+
+// Add exported wisdom to the process's wisdom, replacing any for the same
+// code.
+//
+// @return  0 on success, RS_ERR_FORMAT if the text is not wisdom (nothing
+//          is then imported).
+int rs_plan_import_wisdom(const char * wisdom);
+
+// Export the wisdom to a file, replacing it atomically.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_plan_export_wisdom_file(const char * path);
+
+// Import wisdom from a file.
+//
+// @return  as for rs_plan_import_wisdom(), or RS_ERR_IO.
+int rs_plan_import_wisdom_file(const char * path);
+
+// Forget all wisdom.
+void rs_plan_forget_wisdom(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_PLAN_H
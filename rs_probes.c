@@ -0,0 +1,23 @@
+//
+// USDT probe semaphores, set by a tracer while it is attached to a probe.
+//
+// @author Jarrod Bennett
+//
+
+#include "rs_probes.h"
+
+#if defined(RS_HAVE_SDT)
+
+#define SEMAPHORE(name) \
+        volatile unsigned short RS_PROBE_SEMAPHORE(name) \
+        __attribute__((section(".probes")))
+
+SEMAPHORE(encode__entry);
+SEMAPHORE(encode__return);
+SEMAPHORE(decode__entry);
+SEMAPHORE(decode__return);
+SEMAPHORE(correct);
+SEMAPHORE(message__entry);
+SEMAPHORE(message__return);
+
+#endif
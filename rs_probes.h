@@ -0,0 +1,76 @@
+//
+// USDT (SystemTap / bpftrace) static probes. Where <sys/sdt.h> is available
+// the probes below are compiled in as single no-op instructions, which
+// tracers can attach to at run time, e.g.
+//
+//   bpftrace -e 'usdt:./rsdec:rs_codec:decode__return
+//                { @fixes = hist(arg3); @cycles = hist(arg4); }'
+//
+// Each probe has a semaphore which a tracer sets while attached; timings
+// are only taken when it is. Elsewhere the probes compile to nothing.
+// The CMake cache variable RS_PROBES forces them ON (failing to configure
+// without <sys/sdt.h>) or OFF; the default AUTO uses the header if found.
+//
+// Probes of provider rs_codec and their arguments:
+//
+//   encode__entry       k, nparity, m
+//   encode__return      k, nparity, m, cycles
+//   decode__entry       k, nparity, m, nerasures
+//   decode__return      k, nparity, m, corrections (or error), cycles
+//   correct             codeword index, error value, n
+//   message__entry      k, t, m            (rs_encode_message())
+//   message__return     k, t, m, cycles
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_PROBES_H
+#define RS_PROBES_H
+
+#include "rs_stats.h"
+
+#if defined(RS_HAVE_SDT)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define RS_PROBE_SEMAPHORE(name)    rs_codec_##name##_semaphore
+
+extern volatile unsigned short RS_PROBE_SEMAPHORE(encode__entry);
+extern volatile unsigned short RS_PROBE_SEMAPHORE(encode__return);
+extern volatile unsigned short RS_PROBE_SEMAPHORE(decode__entry);
+extern volatile unsigned short RS_PROBE_SEMAPHORE(decode__return);
+extern volatile unsigned short RS_PROBE_SEMAPHORE(correct);
+extern volatile unsigned short RS_PROBE_SEMAPHORE(message__entry);
+extern volatile unsigned short RS_PROBE_SEMAPHORE(message__return);
+
+// Whether a tracer is attached to a probe.
+#define RS_PROBE_ENABLED(name) \
+        __builtin_expect(RS_PROBE_SEMAPHORE(name) != 0, 0)
+
+#define RS_PROBE3(name, a, b, c) \
+        DTRACE_PROBE3(rs_codec, name, a, b, c)
+#define RS_PROBE4(name, a, b, c, d) \
+        DTRACE_PROBE4(rs_codec, name, a, b, c, d)
+#define RS_PROBE5(name, a, b, c, d, e) \
+        DTRACE_PROBE5(rs_codec, name, a, b, c, d, e)
+
+#else
+
+#define RS_PROBE_ENABLED(name)      (0)
+
+// The arguments are not evaluated
+#define RS_PROBE3(name, a, b, c) \
+        do { (void) sizeof((a) + (b) + (c)); } while (0)
+#define RS_PROBE4(name, a, b, c, d) \
+        do { (void) sizeof((a) + (b) + (c) + (d)); } while (0)
+#define RS_PROBE5(name, a, b, c, d, e) \
+        do { (void) sizeof((a) + (b) + (c) + (d) + (e)); } while (0)
+
+#endif
+
+// Timestamp for a probe's cycles argument, read only while it is traced.
+#define RS_PROBE_CLOCK(name) \
+        (RS_PROBE_ENABLED(name) ? rs_stats_cycles() : (uint64_t) 0)
+
+#endif //RS_PROBES_H
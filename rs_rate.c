@@ -0,0 +1,168 @@
+//
+// Rate-adaptive coding.
+//
+// @author Jarrod Bennett
+//
+
+#include <string.h>
+
+#include "rs_rate.h"
+
+// Frames grouped at a time by rs_rate_encode_batch().
+#define BATCH_FRAMES            (64)
+
+int rs_rate_init(rs_rate_t * rate, int m, const int * nparity, int count) {
+
+    return rs_rate_init_generator(rate, m, nparity, count, 0,
+                                  RS_CODEC_DEFAULT_FCR, RS_CODEC_DEFAULT_PRIM);
+}
+
+int rs_rate_init_generator(rs_rate_t * rate, int m, const int * nparity,
+                           int count, int poly, int fcr, int prim) {
+
+    if (rate == NULL || nparity == NULL || count < 1 || count > RS_RATE_MAX) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Sort the parity counts, refusing repeats
+    int sorted[RS_RATE_MAX];
+    for (int i = 0; i < count; i++) {
+        int np = nparity[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > np) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        if (j > 0 && sorted[j - 1] == np) {
+            return RS_ERR_INVALID_ARGS;
+        }
+        sorted[j] = np;
+    }
+
+    memset(rate->index, -1, sizeof(rate->index));
+    rate->count = 0;
+    for (int i = 0; i < count; i++) {
+        int err = rs_codec_init_generator(&rate->codecs[i], m, sorted[i],
+                                          poly, fcr, prim);
+        if (err) {
+            rs_rate_free(rate);
+            return err;
+        }
+        rate->nparity[i] = sorted[i];
+        rate->index[sorted[i]] = (int8_t) i;
+        rate->count++;
+    }
+
+    return 0;
+}
+
+void rs_rate_free(rs_rate_t * rate) {
+
+    if (rate == NULL) {
+        return;
+    }
+    for (int i = 0; i < rate->count; i++) {
+        rs_codec_free(&rate->codecs[i]);
+    }
+    memset(rate->index, -1, sizeof(rate->index));
+    rate->count = 0;
+}
+
+rs_codec_t * rs_rate_codec(rs_rate_t * rate, int nparity) {
+
+    if (nparity < 1 || nparity > RS_CODEC_MAX_PARITY ||
+        rate->index[nparity] < 0) {
+        return NULL;
+    }
+    return &rate->codecs[rate->index[nparity]];
+}
+
+int rs_rate_set_stats(rs_rate_t * rate, rs_codec_stats_t * stats) {
+
+    for (int i = 0; i < rate->count; i++) {
+        int err = rs_codec_set_stats(&rate->codecs[i], stats);
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+int rs_rate_encode(const rs_rate_t * rate, const uint8_t * msg, int k,
+                   int nparity, uint8_t * parity) {
+
+    if (nparity < 1 || nparity > RS_CODEC_MAX_PARITY ||
+        rate->index[nparity] < 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    return rs_codec_encode(&rate->codecs[rate->index[nparity]], msg, k,
+                           parity);
+}
+
+int rs_rate_decode(const rs_rate_t * rate, uint8_t * codeword, int n,
+                   int nparity, const int * erasures, int nerasures,
+                   int * positions) {
+
+    if (nparity < 1 || nparity > RS_CODEC_MAX_PARITY ||
+        rate->index[nparity] < 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    return rs_codec_decode(&rate->codecs[rate->index[nparity]], codeword, n,
+                           erasures, nerasures, positions);
+}
+
+int rs_rate_encode_batch(const rs_rate_t * rate, const rs_rate_frame_t * frames,
+                         int count) {
+
+    if (count < 0) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    // Check every frame first so that nothing is written on failure
+    for (int f = 0; f < count; f++) {
+        int np = frames[f].nparity;
+        if (np < 1 || np > RS_CODEC_MAX_PARITY || rate->index[np] < 0 ||
+            frames[f].k < 0 ||
+            frames[f].k + np > rate->codecs[rate->index[np]].nn) {
+            return RS_ERR_INVALID_ARGS;
+        }
+    }
+
+    const uint8_t * msg[BATCH_FRAMES];
+    int k[BATCH_FRAMES];
+    uint8_t * parity[BATCH_FRAMES];
+
+    for (int first = 0; first < count; first += BATCH_FRAMES) {
+        int batch = count - first < BATCH_FRAMES ? count - first :
+                                                   BATCH_FRAMES;
+        const rs_rate_frame_t * chunk = &frames[first];
+
+        // Counting sort of the chunk by rate, keeping the frame order
+        // within each rate
+        int start[RS_RATE_MAX + 1] = {0};
+        for (int f = 0; f < batch; f++) {
+            start[rate->index[chunk[f].nparity] + 1]++;
+        }
+        for (int r = 0; r < rate->count; r++) {
+            start[r + 1] += start[r];
+        }
+        int next[RS_RATE_MAX];
+        memcpy(next, start, sizeof(next));
+        for (int f = 0; f < batch; f++) {
+            int slot = next[rate->index[chunk[f].nparity]]++;
+            msg[slot] = chunk[f].msg;
+            k[slot] = chunk[f].k;
+            parity[slot] = chunk[f].parity;
+        }
+
+        for (int r = 0; r < rate->count; r++) {
+            int group = start[r + 1] - start[r];
+            if (group > 0) {
+                rs_codec_encode_list(&rate->codecs[r], &msg[start[r]],
+                                     &k[start[r]], &parity[start[r]], group);
+            }
+        }
+    }
+
+    return 0;
+}
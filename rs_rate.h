@@ -0,0 +1,105 @@
+//
+// Rate-adaptive coding: one context holding a codec for each of a set of
+// parity counts, so that a link can pick the parity count of every frame
+// from the channel quality. All the tables are built (or, through
+// rs_registry.h, shared) when the context is initialised, and choosing a
+// rate is a table index, so switching rates from frame to frame costs
+// nothing and never allocates.
+//
+// Every rate uses the same field and roots, alpha^(prim * (fcr + i)), so
+// the generator of a lower rate is a multiple of that of each higher rate.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_RATE_H
+#define RS_RATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+
+// Maximum parity counts per context.
+#define RS_RATE_MAX             (16)
+
+typedef struct rs_rate {
+    int count;
+    int nparity[RS_RATE_MAX];   // the parity counts, ascending
+    rs_codec_t codecs[RS_RATE_MAX];
+
+    // Index into codecs of each parity count, -1 if not configured.
+    int8_t index[RS_CODEC_MAX_PARITY + 1];
+} rs_rate_t;
+
+// A frame of a mixed rate batch, see rs_rate_encode_batch().
+typedef struct rs_rate_frame {
+    const uint8_t * msg;
+    int k;
+    int nparity;
+    uint8_t * parity;           // receives nparity symbols
+} rs_rate_frame_t;
+
+// Initialise a rate-adaptive context for the default (MATLAB compatible)
+// code with each of the given parity counts.
+//
+// @param   nparity: count distinct parity counts, each valid for
+//                   rs_codec_init(), in any order.
+// @param   count: 1..RS_RATE_MAX.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_rate_init(rs_rate_t * rate, int m, const int * nparity, int count);
+
+// Initialise a rate-adaptive context with a given field and roots, as for
+// rs_codec_init_generator().
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_rate_init_generator(rs_rate_t * rate, int m, const int * nparity,
+                           int count, int poly, int fcr, int prim);
+
+// Release a rate-adaptive context.
+void rs_rate_free(rs_rate_t * rate);
+
+// Get the codec of one parity count, e.g. to set its kernel or layout or
+// to use the other codec functions.
+//
+// @return  the codec, or NULL if the parity count is not configured.
+rs_codec_t * rs_rate_codec(rs_rate_t * rate, int nparity);
+
+// Attach a statistics block to every codec of the context, as
+// rs_codec_set_stats().
+int rs_rate_set_stats(rs_rate_t * rate, rs_codec_stats_t * stats);
+
+// Compute the nparity parity symbols of a message, as rs_codec_encode().
+//
+// @return  0 on success, RS_ERR_INVALID_ARGS if nparity is not configured
+//          or k is too long, otherwise a negative RS_ERR_ code.
+int rs_rate_encode(const rs_rate_t * rate, const uint8_t * msg, int k,
+                   int nparity, uint8_t * parity);
+
+// Decode a codeword of n symbols with nparity of them parity, as
+// rs_codec_decode().
+//
+// @return  as for rs_codec_decode(), or RS_ERR_INVALID_ARGS if nparity is
+//          not configured.
+int rs_rate_decode(const rs_rate_t * rate, uint8_t * codeword, int n,
+                   int nparity, const int * erasures, int nerasures,
+                   int * positions);
+
+// Encode a batch of frames of mixed rates and lengths. The frames are
+// grouped by rate internally, so each group is batched as by
+// rs_codec_encode_list() whatever order the frames come in.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code, in which case
+//          no parity has been written.
+int rs_rate_encode_batch(const rs_rate_t * rate, const rs_rate_frame_t * frames,
+                         int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_RATE_H
@@ -0,0 +1,264 @@
+//
+// Process-wide registry of codec tables.
+//
+// Tables live in a small chained hash table under a single mutex, which is
+// only taken while contexts are initialised or freed. Each entry is one
+// allocation holding the field, the generator and the product table; the
+// padded copy for the SSSE3 kernel is a second, aligned, allocation made
+// the first time a context selects that kernel.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rs_codec.h"
+#include "rs_registry.h"
+
+// Hash buckets. Only a handful of codes are expected at a time.
+#define BUCKETS                 (64)
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static rs_tables_t * buckets[BUCKETS];
+static int entries;
+static int idle;                // entries with no references
+static uint64_t releases;       // release clock for the idle entries
+
+static unsigned bucket_of(int m, int nparity, int poly, int fcr, int prim);
+
+// Build the tables of a code, or return NULL with *err set.
+static rs_tables_t * build_tables(int m, int nparity, int poly, int fcr,
+                                  int prim, int * err);
+
+// Build the generator polynomial with roots alpha^(prim * (fcr + i)).
+static void build_generator(const rs_field_t * field, int fcr, int prim,
+                            int nparity, uint8_t * genpoly);
+
+// Unlink and free an entry. Called with the lock held.
+static void remove_entry(rs_tables_t * tables);
+
+int rs_registry_acquire(int m, int nparity, int poly, int fcr, int prim,
+                        const rs_tables_t ** tables) {
+
+    if (poly == 0) {
+        poly = rs_field_default_poly(m);
+    }
+    unsigned b = bucket_of(m, nparity, poly, fcr, prim);
+
+    pthread_mutex_lock(&registryLock);
+    rs_tables_t * entry = buckets[b];
+    while (entry != NULL &&
+           (entry->m != m || entry->nparity != nparity ||
+            entry->poly != poly || entry->fcr != fcr ||
+            entry->prim != prim)) {
+        entry = entry->next;
+    }
+
+    if (entry == NULL) {
+        // Built under the lock so that racing contexts of a new code do
+        // not both build it; this is a one-off cost per code
+        int err;
+        entry = build_tables(m, nparity, poly, fcr, prim, &err);
+        if (entry == NULL) {
+            pthread_mutex_unlock(&registryLock);
+            return err;
+        }
+        entry->next = buckets[b];
+        buckets[b] = entry;
+        entries++;
+    } else if (entry->refs == 0) {
+        idle--;
+    }
+    entry->refs++;
+    pthread_mutex_unlock(&registryLock);
+
+    *tables = entry;
+    return 0;
+}
+
+void rs_registry_release(const rs_tables_t * tables) {
+
+    if (tables == NULL) {
+        return;
+    }
+    rs_tables_t * entry = (rs_tables_t *) tables;
+
+    pthread_mutex_lock(&registryLock);
+    if (--entry->refs == 0) {
+        entry->released = ++releases;
+        idle++;
+
+        // Over the limit, the entry idle the longest goes
+        if (idle > RS_REGISTRY_IDLE_MAX) {
+            rs_tables_t * oldest = NULL;
+            for (int b = 0; b < BUCKETS; b++) {
+                for (rs_tables_t * e = buckets[b]; e != NULL; e = e->next) {
+                    if (e->refs == 0 &&
+                        (oldest == NULL || e->released < oldest->released)) {
+                        oldest = e;
+                    }
+                }
+            }
+            remove_entry(oldest);
+        }
+    }
+    pthread_mutex_unlock(&registryLock);
+}
+
+const uint8_t * rs_registry_padded(const rs_tables_t * tables) {
+
+    rs_tables_t * entry = (rs_tables_t *) tables;
+
+    pthread_mutex_lock(&registryLock);
+    if (entry->padded == NULL) {
+        int np = entry->nparity;
+        int rows = 1 << entry->m;
+        size_t stride = (size_t) (np + 15) & ~(size_t) 15;
+        size_t size = (size_t) rows * stride;
+
+        uint8_t * padded;
+        if (posix_memalign((void **) &padded, 16, size) == 0) {
+            memset(padded, 0, size);
+            for (int x = 0; x < rows; x++) {
+                memcpy(&padded[(size_t) x * stride],
+                       &entry->products[(size_t) x * np], (size_t) np);
+            }
+            entry->padded = padded;
+            entry->size += size;
+        }
+    }
+    const uint8_t * padded = entry->padded;
+    pthread_mutex_unlock(&registryLock);
+
+    return padded;
+}
+
+void rs_registry_usage(int * count, size_t * bytes) {
+
+    pthread_mutex_lock(&registryLock);
+    size_t total = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        for (rs_tables_t * e = buckets[b]; e != NULL; e = e->next) {
+            total += e->size;
+        }
+    }
+    if (count != NULL) {
+        *count = entries;
+    }
+    if (bytes != NULL) {
+        *bytes = total;
+    }
+    pthread_mutex_unlock(&registryLock);
+}
+
+void rs_registry_trim(void) {
+
+    pthread_mutex_lock(&registryLock);
+    for (int b = 0; b < BUCKETS; b++) {
+        rs_tables_t * e = buckets[b];
+        while (e != NULL) {
+            rs_tables_t * next = e->next;
+            if (e->refs == 0) {
+                remove_entry(e);
+            }
+            e = next;
+        }
+    }
+    pthread_mutex_unlock(&registryLock);
+}
+
+static unsigned bucket_of(int m, int nparity, int poly, int fcr, int prim) {
+
+    uint32_t h = (uint32_t) m;
+    h = h * 31 + (uint32_t) nparity;
+    h = h * 31 + (uint32_t) poly;
+    h = h * 31 + (uint32_t) fcr;
+    h = h * 31 + (uint32_t) prim;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dU;
+    h ^= h >> 12;
+
+    return h % BUCKETS;
+}
+
+static rs_tables_t * build_tables(int m, int nparity, int poly, int fcr,
+                                  int prim, int * err) {
+
+    int rows = 1 << m;
+    size_t productsSize = (size_t) rows * (size_t) nparity;
+    size_t size = sizeof(rs_tables_t) + (size_t) nparity + 1 + productsSize;
+
+    rs_tables_t * tables = malloc(size);
+    if (tables == NULL) {
+        *err = RS_ERR_NO_MEMORY;
+        return NULL;
+    }
+    if (rs_field_init(&tables->field, m, poly)) {
+        free(tables);
+        *err = RS_ERR_INVALID_ARGS;
+        return NULL;
+    }
+
+    uint8_t * genpoly = (uint8_t *) (tables + 1);
+    uint8_t * products = genpoly + nparity + 1;
+    build_generator(&tables->field, fcr, prim, nparity, genpoly);
+
+    for (int x = 0; x < rows; x++) {
+        for (int j = 0; j < nparity; j++) {
+            products[x * nparity + j] =
+                    rs_field_mul(&tables->field, (uint8_t) x, genpoly[j + 1]);
+        }
+    }
+
+    tables->m = m;
+    tables->nparity = nparity;
+    tables->poly = poly;
+    tables->fcr = fcr;
+    tables->prim = prim;
+    tables->genpoly = genpoly;
+    tables->products = products;
+    tables->size = size;
+    tables->padded = NULL;
+    tables->refs = 0;
+    tables->released = 0;
+    tables->next = NULL;
+
+    return tables;
+}
+
+static void build_generator(const rs_field_t * field, int fcr, int prim,
+                            int nparity, uint8_t * genpoly) {
+
+    genpoly[0] = 1;
+    for (int i = 1; i <= nparity; i++) {
+        genpoly[i] = 0;
+    }
+
+    // Multiply by (x + alpha^(prim * (fcr + i))) for each root in turn
+    for (int i = 0; i < nparity; i++) {
+        uint8_t root = rs_field_alpha_pow(field, prim * (fcr + i));
+        for (int j = i + 1; j > 0; j--) {
+            genpoly[j] ^= rs_field_mul(field, root, genpoly[j - 1]);
+        }
+    }
+}
+
+static void remove_entry(rs_tables_t * tables) {
+
+    unsigned b = bucket_of(tables->m, tables->nparity, tables->poly,
+                           tables->fcr, tables->prim);
+    rs_tables_t ** link = &buckets[b];
+    while (*link != tables) {
+        link = &(*link)->next;
+    }
+    *link = tables->next;
+
+    entries--;
+    idle--;
+    free(tables->padded);
+    free(tables);
+}
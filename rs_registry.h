@@ -0,0 +1,87 @@
+//
+// Process-wide registry of codec tables. Contexts of the same code, i.e.
+// the same symbol size, parity count, field polynomial, first root and root
+// step, share one set of field, generator and product tables. They are
+// found by a hash lookup when a context is initialised and reference
+// counted, so memory grows with the number of distinct codes in use rather
+// than with the number of contexts.
+//
+// The last few tables to lose their last context are kept for a while, so
+// that contexts created and freed in turn do not rebuild them every time.
+// rs_registry_trim() frees them at once.
+//
+// rs_codec_init_generator() and rs_codec_free() go through the registry,
+// so it only needs calling directly to inspect or trim it. All functions
+// are thread safe.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_REGISTRY_H
+#define RS_REGISTRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_galois.h"
+
+// Tables kept after their last context is freed.
+#define RS_REGISTRY_IDLE_MAX    (8)
+
+// The tables of one code. All fields are read only.
+typedef struct rs_tables {
+    int m;
+    int nparity;
+    int poly;
+    int fcr;
+    int prim;
+
+    rs_field_t field;
+    const uint8_t * genpoly;    // nparity + 1 coefficients, highest first
+    const uint8_t * products;   // [2^m][nparity], see rs_codec_t
+    size_t size;                // bytes held, including padded
+
+    // Registry bookkeeping, under its lock.
+    uint8_t * padded;           // see rs_registry_padded(), or NULL
+    int refs;
+    uint64_t released;          // when refs last dropped to 0
+    struct rs_tables * next;    // in the hash chain
+} rs_tables_t;
+
+// Get the tables of a code, building them if they are not already held.
+// The arguments are those of rs_codec_init_generator() and must already be
+// valid, except for poly, which is checked here.
+//
+// @param   poly: the primitive polynomial, or 0 for the default.
+// @param   tables: receives the tables, to be released with
+//                  rs_registry_release().
+// @return  0 on success, RS_ERR_INVALID_ARGS if poly is not primitive or
+//          RS_ERR_NO_MEMORY.
+int rs_registry_acquire(int m, int nparity, int poly, int fcr, int prim,
+                        const rs_tables_t ** tables);
+
+// Drop a reference taken by rs_registry_acquire().
+void rs_registry_release(const rs_tables_t * tables);
+
+// Get the product table with each row padded to a multiple of 16 bytes
+// with zeros, as the SSSE3 kernel uses it. Built on first use.
+//
+// @return  the table, or NULL if out of memory.
+const uint8_t * rs_registry_padded(const rs_tables_t * tables);
+
+// Get the number of tables held and the bytes they take. Either pointer
+// may be NULL.
+void rs_registry_usage(int * count, size_t * bytes);
+
+// Free every table no context is using.
+void rs_registry_trim(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_REGISTRY_H
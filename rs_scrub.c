@@ -0,0 +1,487 @@
+//
+// Background scrubbing of containers.
+//
+// @author Jarrod Bennett
+//
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rs_crc32.h"
+#include "rs_scrub.h"
+
+// Target bytes of blocks between cache drops and checkpoint checks.
+#define BATCH_BYTES             (1 << 20)
+
+// Longest single sleep of the rate limit, so a stop is seen promptly.
+#define THROTTLE_SLICE_NS       (100000000ULL)
+
+// ioprio_set() arguments, which glibc does not define.
+#define IOPRIO_WHO_PROCESS      (1)
+#define IOPRIO_CLASS_IDLE       (3)
+#define IOPRIO_CLASS_SHIFT      (13)
+
+// Check one block, repairing it in the file if it is damaged.
+//
+// @return  0 if clean, 1 if repaired, otherwise a negative RS_ERR_ code.
+static int scrub_block(rs_scrub_t * scrub, uint64_t block, uint8_t * scratch,
+                       rs_scrub_stats_t * stats);
+
+// Lower the calling thread's CPU and I/O priority.
+static void lower_priority(const rs_scrub_options_t * options);
+
+// Sleep until bytes have taken their share of the rate limit since start,
+// or until the scrub is stopped.
+static void throttle(const rs_scrub_t * scrub, uint64_t bytes,
+                     const struct timespec * start);
+
+static int load_cursor(rs_scrub_t * scrub);
+static int save_cursor(const rs_scrub_t * scrub);
+
+static void add_stats(rs_scrub_stats_t * total, const rs_scrub_stats_t * add);
+static void * scrub_main(void * arg);
+
+void rs_scrub_options_default(rs_scrub_options_t * options) {
+
+    options->bytesPerSecond = 0;
+    options->nice = 10;
+    options->idleIo = 1;
+    options->dropCache = 1;
+    options->cursorPath = NULL;
+    options->checkpoint = RS_SCRUB_DEFAULT_CHECKPOINT;
+    options->verbose = 0;
+    options->codecStats = NULL;
+}
+
+int rs_scrub_open(rs_scrub_t * scrub, int fd,
+                  const rs_scrub_options_t * options) {
+
+    memset(scrub, 0, sizeof(*scrub));
+
+    // Read only mapping: repairs are written with pwrite() and only after
+    // they have been checked, so a failed repair never touches the file
+    int err = rs_container_open(&scrub->container, fd);
+    if (err) {
+        return err;
+    }
+
+    const uint8_t * footer = scrub->container.map + scrub->container.size -
+                             RS_CONTAINER_FOOTER_SIZE;
+    scrub->archiveId = (uint32_t) rs_file_get_le(&footer[24], 4);
+    rs_codec_set_stats(&scrub->container.codec, options->codecStats);
+    scrub->fd = fd;
+    scrub->options = *options;
+    if (scrub->options.checkpoint == 0) {
+        scrub->options.checkpoint = RS_SCRUB_DEFAULT_CHECKPOINT;
+    }
+
+    return load_cursor(scrub);
+}
+
+int rs_scrub_run(rs_scrub_t * scrub) {
+
+    const rs_container_t * container = &scrub->container;
+    const rs_scrub_options_t * options = &scrub->options;
+
+    uint8_t * scratch = malloc(container->blockSize);
+    if (scratch == NULL) {
+        return RS_ERR_NO_MEMORY;
+    }
+
+    lower_priority(options);
+
+    uint64_t batchBlocks = BATCH_BYTES / container->blockSize;
+    if (batchBlocks == 0) {
+        batchBlocks = 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t scrubbed = 0;
+    uint64_t sinceSave = 0;
+    int result = 0;
+
+    while (scrub->cursor < container->blocks &&
+           !__atomic_load_n(&scrub->stop, __ATOMIC_RELAXED)) {
+        uint64_t first = scrub->cursor;
+        uint64_t count = container->blocks - first;
+        if (count > batchBlocks) {
+            count = batchBlocks;
+        }
+
+        rs_scrub_stats_t local;
+        memset(&local, 0, sizeof(local));
+        int repaired = 0;
+        uint64_t block;
+
+        for (block = first; block < first + count; block++) {
+            if (__atomic_load_n(&scrub->stop, __ATOMIC_RELAXED)) {
+                break;
+            }
+            int err = scrub_block(scrub, block, scratch, &local);
+            if (err == 1) {
+                repaired = 1;
+            } else if (err == RS_ERR_UNCORRECTABLE) {
+                result = err;
+            } else if (err < 0) {
+                free(scratch);
+                return err;
+            }
+            throttle(scrub, scrubbed + (block + 1 - first) *
+                            container->blockSize, &start);
+        }
+
+        if (repaired && fdatasync(scrub->fd) != 0) {
+            free(scratch);
+            return RS_ERR_IO;
+        }
+
+        uint64_t offset = RS_CONTAINER_HEADER_SIZE +
+                          first * container->blockSize;
+        uint64_t bytes = (block - first) * container->blockSize;
+        if (options->dropCache) {
+            posix_fadvise(scrub->fd, (off_t) offset, (off_t) bytes,
+                          POSIX_FADV_DONTNEED);
+        }
+
+        add_stats(&scrub->stats, &local);
+        scrub->cursor = block;
+
+        sinceSave += bytes;
+        if (sinceSave >= options->checkpoint) {
+            sinceSave = 0;
+            int err = save_cursor(scrub);
+            if (err) {
+                free(scratch);
+                return err;
+            }
+        }
+
+        scrubbed += bytes;
+    }
+
+    free(scratch);
+
+    if (scrub->cursor == container->blocks) {
+        scrub->cursor = 0;
+        __atomic_fetch_add(&scrub->stats.passes, 1, __ATOMIC_RELAXED);
+    }
+    int err = save_cursor(scrub);
+
+    return err ? err : result;
+}
+
+int rs_scrub_start(rs_scrub_t * scrub) {
+
+    if (scrub->running) {
+        return RS_ERR_INVALID_ARGS;
+    }
+    __atomic_store_n(&scrub->stop, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&scrub->finished, 0, __ATOMIC_RELAXED);
+    if (pthread_create(&scrub->thread, NULL, scrub_main, scrub)) {
+        return RS_ERR_NO_MEMORY;
+    }
+    scrub->running = 1;
+
+    return 0;
+}
+
+void rs_scrub_stop(rs_scrub_t * scrub) {
+
+    __atomic_store_n(&scrub->stop, 1, __ATOMIC_RELAXED);
+}
+
+int rs_scrub_finished(const rs_scrub_t * scrub) {
+
+    return __atomic_load_n(&scrub->finished, __ATOMIC_ACQUIRE);
+}
+
+int rs_scrub_wait(rs_scrub_t * scrub) {
+
+    if (!scrub->running) {
+        return scrub->result;
+    }
+    pthread_join(scrub->thread, NULL);
+    scrub->running = 0;
+
+    return scrub->result;
+}
+
+void rs_scrub_get_stats(const rs_scrub_t * scrub, rs_scrub_stats_t * stats) {
+
+    const rs_scrub_stats_t * s = &scrub->stats;
+    stats->blocks = __atomic_load_n(&s->blocks, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&s->bytes, __ATOMIC_RELAXED);
+    stats->codewords = __atomic_load_n(&s->codewords, __ATOMIC_RELAXED);
+    stats->corrected = __atomic_load_n(&s->corrected, __ATOMIC_RELAXED);
+    stats->symbols = __atomic_load_n(&s->symbols, __ATOMIC_RELAXED);
+    stats->repairedBlocks = __atomic_load_n(&s->repairedBlocks,
+                                            __ATOMIC_RELAXED);
+    stats->failedBlocks = __atomic_load_n(&s->failedBlocks,
+                                          __ATOMIC_RELAXED);
+    stats->passes = __atomic_load_n(&s->passes, __ATOMIC_RELAXED);
+}
+
+void rs_scrub_close(rs_scrub_t * scrub) {
+
+    if (scrub->running) {
+        rs_scrub_stop(scrub);
+        rs_scrub_wait(scrub);
+    }
+    rs_container_close(&scrub->container);
+}
+
+static int scrub_block(rs_scrub_t * scrub, uint64_t block, uint8_t * scratch,
+                       rs_scrub_stats_t * stats) {
+
+    const rs_container_t * container = &scrub->container;
+    const rs_codec_t * codec = &container->codec;
+    int depth = container->depth;
+    int n = container->n;
+
+    uint64_t offset = rs_container_block_offset(container, block);
+    const uint8_t * blockPtr = container->map + offset;
+
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+    uint64_t damaged[(RS_CONTAINER_MAX_DEPTH + 63) / 64] = {0};
+    int ndamaged = 0;
+
+    stats->blocks++;
+    stats->bytes += container->blockSize;
+    stats->codewords += (uint64_t) depth;
+
+    // Syndrome check of every codeword; this is all a clean block costs
+    for (int c = 0; c < depth; c++) {
+        for (int s = 0; s < n; s++) {
+            codeword[s] = blockPtr[s * depth + c];
+        }
+        if (rs_codec_syndromes(codec, codeword, n, NULL) != 0) {
+            damaged[c / 64] |= (uint64_t) 1 << (c % 64);
+            ndamaged++;
+        }
+    }
+    if (ndamaged == 0) {
+        return 0;
+    }
+
+    // Repair a scratch copy and only write it back once it checks out
+    memcpy(scratch, blockPtr, container->blockSize);
+    int failed = 0;
+    rs_file_stats_t local;
+    memset(&local, 0, sizeof(local));
+
+    for (int c = 0; c < depth && !failed; c++) {
+        if (!(damaged[c / 64] >> (c % 64) & 1)) {
+            continue;
+        }
+        for (int s = 0; s < n; s++) {
+            codeword[s] = scratch[s * depth + c];
+        }
+        int result = rs_codec_decode(codec, codeword, n, NULL, 0, NULL);
+        if (result < 0) {
+            failed = 1;
+            break;
+        }
+        local.corrected++;
+        local.symbols += (uint64_t) result;
+        for (int s = 0; s < n; s++) {
+            scratch[s * depth + c] = codeword[s];
+        }
+    }
+
+    if (!failed && !rs_container_check_data(container, block, scratch)) {
+        failed = 1;
+    }
+
+    if (failed) {
+        stats->failedBlocks++;
+        if (scrub->options.verbose) {
+            fprintf(stderr, "block %llu: %d damaged codewords, "
+                            "uncorrectable\n",
+                    (unsigned long long) block, ndamaged);
+        }
+        return RS_ERR_UNCORRECTABLE;
+    }
+
+    ssize_t written = pwrite(scrub->fd, scratch, container->blockSize,
+                             (off_t) offset);
+    if (written != (ssize_t) container->blockSize) {
+        return RS_ERR_IO;
+    }
+
+    stats->corrected += local.corrected;
+    stats->symbols += local.symbols;
+    stats->repairedBlocks++;
+    if (scrub->options.verbose) {
+        fprintf(stderr, "block %llu: repaired %llu codewords "
+                        "(%llu symbols)\n",
+                (unsigned long long) block,
+                (unsigned long long) local.corrected,
+                (unsigned long long) local.symbols);
+    }
+
+    return 1;
+}
+
+static void lower_priority(const rs_scrub_options_t * options) {
+
+    // On Linux these apply to the calling thread alone
+    pid_t tid = (pid_t) syscall(SYS_gettid);
+
+    if (options->nice > 0) {
+        errno = 0;
+        int current = getpriority(PRIO_PROCESS, (id_t) tid);
+        if (errno == 0) {
+            setpriority(PRIO_PROCESS, (id_t) tid, current + options->nice);
+        }
+    }
+
+#if defined(SYS_ioprio_set)
+    if (options->idleIo) {
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, (int) tid,
+                IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+    }
+#endif
+}
+
+static void throttle(const rs_scrub_t * scrub, uint64_t bytes,
+                     const struct timespec * start) {
+
+    uint64_t bytesPerSecond = scrub->options.bytesPerSecond;
+    if (bytesPerSecond == 0) {
+        return;
+    }
+
+    uint64_t dueNs = (uint64_t) ((double) bytes * 1e9 /
+                                 (double) bytesPerSecond);
+
+    // Sleep in slices, since a signal handler's rs_scrub_stop() does not
+    // interrupt nanosleep() unless the signal arrives on this thread
+    while (!__atomic_load_n(&scrub->stop, __ATOMIC_RELAXED)) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t elapsedNs = (uint64_t) (now.tv_sec - start->tv_sec) *
+                             1000000000ULL +
+                             (uint64_t) (now.tv_nsec - start->tv_nsec);
+        if (dueNs <= elapsedNs) {
+            break;
+        }
+
+        uint64_t wait = dueNs - elapsedNs;
+        if (wait > THROTTLE_SLICE_NS) {
+            wait = THROTTLE_SLICE_NS;
+        }
+        struct timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = (long) wait;
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int load_cursor(rs_scrub_t * scrub) {
+
+    if (scrub->options.cursorPath == NULL) {
+        return 0;
+    }
+
+    int fd = open(scrub->options.cursorPath, O_RDONLY);
+    if (fd < 0) {
+        // No cursor yet: start from the beginning
+        return errno == ENOENT ? 0 : RS_ERR_IO;
+    }
+
+    uint8_t cursor[RS_SCRUB_CURSOR_SIZE];
+    ssize_t got = read(fd, cursor, sizeof(cursor));
+    close(fd);
+
+    if (got == (ssize_t) sizeof(cursor) &&
+        memcmp(cursor, RS_SCRUB_CURSOR_MAGIC, 4) == 0 &&
+        rs_file_get_le(&cursor[28], 4) == rs_crc32(0, cursor, 28) &&
+        rs_file_get_le(&cursor[4], 4) == scrub->archiveId &&
+        rs_file_get_le(&cursor[8], 8) == scrub->container.blocks) {
+        uint64_t next = rs_file_get_le(&cursor[16], 8);
+        scrub->cursor = next < scrub->container.blocks ? next : 0;
+        scrub->stats.passes = rs_file_get_le(&cursor[24], 4);
+    }
+
+    return 0;
+}
+
+static int save_cursor(const rs_scrub_t * scrub) {
+
+    const char * path = scrub->options.cursorPath;
+    if (path == NULL) {
+        return 0;
+    }
+
+    uint8_t cursor[RS_SCRUB_CURSOR_SIZE];
+    memcpy(cursor, RS_SCRUB_CURSOR_MAGIC, 4);
+    rs_file_put_le(&cursor[4], scrub->archiveId, 4);
+    rs_file_put_le(&cursor[8], scrub->container.blocks, 8);
+    rs_file_put_le(&cursor[16], scrub->cursor, 8);
+    rs_file_put_le(&cursor[24],
+                   __atomic_load_n(&scrub->stats.passes, __ATOMIC_RELAXED), 4);
+    rs_file_put_le(&cursor[28], rs_crc32(0, cursor, 28), 4);
+
+    // Write a temporary file and rename it over the old cursor, so a crash
+    // leaves either the old or the new cursor
+    size_t length = strlen(path);
+    char * temp = malloc(length + 5);
+    if (temp == NULL) {
+        return RS_ERR_NO_MEMORY;
+    }
+    memcpy(temp, path, length);
+    memcpy(&temp[length], ".tmp", 5);
+
+    int err = RS_ERR_IO;
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (rs_file_write_all(fd, cursor, sizeof(cursor)) == 0 &&
+            fsync(fd) == 0) {
+            err = 0;
+        }
+        if (close(fd) != 0) {
+            err = RS_ERR_IO;
+        }
+        if (err == 0 && rename(temp, path) != 0) {
+            err = RS_ERR_IO;
+        }
+        if (err) {
+            unlink(temp);
+        }
+    }
+    free(temp);
+
+    return err;
+}
+
+static void add_stats(rs_scrub_stats_t * total, const rs_scrub_stats_t * add) {
+
+    __atomic_fetch_add(&total->blocks, add->blocks, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total->bytes, add->bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total->codewords, add->codewords, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total->corrected, add->corrected, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total->symbols, add->symbols, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total->repairedBlocks, add->repairedBlocks,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total->failedBlocks, add->failedBlocks,
+                       __ATOMIC_RELAXED);
+}
+
+static void * scrub_main(void * arg) {
+
+    rs_scrub_t * scrub = arg;
+    scrub->result = rs_scrub_run(scrub);
+    __atomic_store_n(&scrub->finished, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
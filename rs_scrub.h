@@ -0,0 +1,131 @@
+//
+// Background scrubbing of containers. The scrubber walks the blocks of a
+// container checking the syndromes of every codeword; the common clean
+// block costs one pass over its bytes and no decoding. A block with
+// damaged codewords is decoded into a scratch copy, checked against the
+// index CRC and only then rewritten in place, so silent corruption is
+// repaired before a foreground read ever meets it.
+//
+// Scrubbing is kept out of the way of foreground work by a byte rate
+// limit, a nice increment and the idle I/O scheduling class for the
+// scrubbing thread, and by dropping the scrubbed pages from the page cache.
+// The position reached is saved to a cursor file at intervals, so a pass
+// interrupted by stopping (or by a crash) resumes where it left off.
+//
+// Cursor file layout (little endian):
+//
+//   0     4   magic "RSSC"
+//   4     4   CRC-32 of the container's index, identifying the archive
+//   8     8   number of blocks in the container
+//   16    8   next block to check
+//   24    4   completed passes
+//   28    4   CRC-32 of bytes 0..27
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_SCRUB_H
+#define RS_SCRUB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "rs_container.h"
+
+#define RS_SCRUB_CURSOR_MAGIC   "RSSC"
+#define RS_SCRUB_CURSOR_SIZE    (32)
+
+// Default bytes between cursor saves.
+#define RS_SCRUB_DEFAULT_CHECKPOINT     (64ULL << 20)
+
+typedef struct rs_scrub_options {
+    uint64_t bytesPerSecond;    // read rate limit, 0 for unlimited
+    int nice;                   // nice increment for the scrubbing thread
+    int idleIo;                 // use the idle I/O scheduling class
+    int dropCache;              // drop scrubbed pages from the page cache
+    const char * cursorPath;    // resume cursor file, NULL for none
+    uint64_t checkpoint;        // bytes between cursor saves
+    int verbose;                // report every damaged block
+    rs_codec_stats_t * codecStats;  // optional, counts the repairs
+} rs_scrub_options_t;
+
+typedef struct rs_scrub_stats {
+    uint64_t blocks;            // blocks checked
+    uint64_t bytes;             // bytes checked
+    uint64_t codewords;         // codewords checked
+    uint64_t corrected;         // codewords repaired
+    uint64_t symbols;           // symbols repaired
+    uint64_t repairedBlocks;    // blocks rewritten
+    uint64_t failedBlocks;      // blocks which could not be repaired
+    uint64_t passes;            // completed passes, from the cursor
+} rs_scrub_stats_t;
+
+typedef struct rs_scrub {
+    rs_container_t container;
+    int fd;
+    rs_scrub_options_t options;
+    uint32_t archiveId;         // CRC-32 of the index
+
+    uint64_t cursor;            // next block
+    int stop;                   // set by rs_scrub_stop()
+    int result;
+    int running;                // a background thread is active
+    int finished;               // the background pass has returned
+    pthread_t thread;
+
+    rs_scrub_stats_t stats;     // updated with relaxed atomics
+} rs_scrub_t;
+
+// Fill in the default options: unlimited rate, nice 10, idle I/O, cache
+// dropping on and no cursor file.
+void rs_scrub_options_default(rs_scrub_options_t * options);
+
+// Open a container for scrubbing and load the cursor, if any. A cursor
+// belonging to another archive is ignored.
+//
+// @param   fd: the container, opened read/write.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_scrub_open(rs_scrub_t * scrub, int fd,
+                  const rs_scrub_options_t * options);
+
+// Run one pass on the calling thread, from the cursor to the end of the
+// container; the cursor then wraps to the first block. The thread's
+// priorities are changed as the options ask.
+//
+// @return  0 if every block was clean or repaired, RS_ERR_UNCORRECTABLE if
+//          any block could not be, otherwise another negative RS_ERR_ code.
+//          A stopped pass returns the result so far.
+int rs_scrub_run(rs_scrub_t * scrub);
+
+// Run one pass on a background thread.
+//
+// @return  0 if the thread started, otherwise a negative RS_ERR_ code.
+int rs_scrub_start(rs_scrub_t * scrub);
+
+// Ask a running pass to stop after the current block. The cursor is saved.
+// Safe to call from any thread or a signal handler.
+void rs_scrub_stop(rs_scrub_t * scrub);
+
+// Check, without waiting, whether a background pass has finished.
+int rs_scrub_finished(const rs_scrub_t * scrub);
+
+// Wait for a background pass to finish.
+//
+// @return  the result of the pass, as for rs_scrub_run().
+int rs_scrub_wait(rs_scrub_t * scrub);
+
+// Take a snapshot of the progress, which may be done while a pass runs.
+void rs_scrub_get_stats(const rs_scrub_t * scrub, rs_scrub_stats_t * stats);
+
+// Wait for any background pass and unmap the container.
+void rs_scrub_close(rs_scrub_t * scrub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_SCRUB_H
@@ -0,0 +1,251 @@
+//
+// Segmentation of payloads of any length into a sequence of codewords.
+//
+// @author Jarrod Bennett
+//
+
+#include <string.h>
+
+#include "rs_pipeline.h"
+#include "rs_segment.h"
+#include "rs_trace.h"
+
+// Codewords per pipeline batch. Payloads of a single batch are coded on
+// the calling thread.
+#define BATCH_CODEWORDS         (1024)
+
+typedef struct segment_job {
+    const rs_codec_t * codec;
+    int k;
+    const uint8_t * in;
+    uint8_t * out;
+    size_t length;              // payload symbols
+    uint64_t codewords;
+    rs_file_stats_t stats;
+} segment_job_t;
+
+// Code the codewords of one batch, storing each decoding result in
+// results (if decoding).
+static void encode_codewords(const segment_job_t * job, uint64_t first,
+                             uint64_t last);
+static void decode_codewords(const segment_job_t * job, uint64_t first,
+                             uint64_t last, int * results);
+
+static int encode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length);
+static int decode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length);
+static int finish_encode(void * ctx, uint64_t batch, const uint8_t * slot,
+                         size_t length);
+static int finish_decode(void * ctx, uint64_t batch, const uint8_t * slot,
+                         size_t length);
+
+uint64_t rs_segment_count(int k, size_t length) {
+
+    if (k < 1) {
+        return 0;
+    }
+    return ((uint64_t) length + (uint64_t) k - 1) / (uint64_t) k;
+}
+
+size_t rs_segment_encoded_length(const rs_codec_t * codec, int k,
+                                 size_t length) {
+
+    return length + (size_t) rs_segment_count(k, length) *
+                    (size_t) codec->nparity;
+}
+
+int rs_segment_encode(const rs_codec_t * codec, int k, const uint8_t * payload,
+                      size_t length, uint8_t * out, int threads) {
+
+    if (k < 1 || k + codec->nparity > codec->nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    segment_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.codec = codec;
+    job.k = k;
+    job.in = payload;
+    job.out = out;
+    job.length = length;
+    job.codewords = rs_segment_count(k, length);
+
+    uint64_t batches = (job.codewords + BATCH_CODEWORDS - 1) /
+                       BATCH_CODEWORDS;
+    if (batches <= 1 || rs_pipeline_threads(threads, batches) == 1) {
+        encode_codewords(&job, 0, job.codewords);
+        return 0;
+    }
+
+    // Workers write straight into out, the slots only sequence them
+    int err = rs_pipeline_run(batches, threads, 1, encode_batch,
+                              finish_encode, &job);
+    return err == -1 ? RS_ERR_NO_MEMORY : err;
+}
+
+int rs_segment_decode(const rs_codec_t * codec, int k,
+                      const uint8_t * encoded, size_t length,
+                      uint8_t * payload, int threads,
+                      rs_file_stats_t * stats) {
+
+    if (k < 1 || k + codec->nparity > codec->nn) {
+        return RS_ERR_INVALID_ARGS;
+    }
+
+    segment_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.codec = codec;
+    job.k = k;
+    job.in = encoded;
+    job.out = payload;
+    job.length = length;
+    job.codewords = rs_segment_count(k, length);
+
+    uint64_t batches = (job.codewords + BATCH_CODEWORDS - 1) /
+                       BATCH_CODEWORDS;
+    int err = 0;
+    if (batches <= 1 || rs_pipeline_threads(threads, batches) == 1) {
+        int results[BATCH_CODEWORDS];
+        for (uint64_t batch = 0; batch < batches; batch++) {
+            size_t unused;
+            decode_batch(&job, 0, batch, (uint8_t *) results, &unused);
+            finish_decode(&job, batch, (const uint8_t *) results, 0);
+        }
+    } else {
+        // Results come back through the slots so the statistics are
+        // gathered in codeword order
+        err = rs_pipeline_run(batches, threads,
+                              BATCH_CODEWORDS * sizeof(int), decode_batch,
+                              finish_decode, &job);
+        if (err == -1) {
+            err = RS_ERR_NO_MEMORY;
+        }
+    }
+
+    if (stats != NULL) {
+        *stats = job.stats;
+    }
+    if (err == 0 && job.stats.failed > 0) {
+        err = RS_ERR_UNCORRECTABLE;
+    }
+    return err;
+}
+
+static void encode_codewords(const segment_job_t * job, uint64_t first,
+                             uint64_t last) {
+
+    int np = job->codec->nparity;
+    int k = job->k;
+    const uint8_t * in = job->in + first * (uint64_t) k;
+    uint8_t * out = job->out + first * (uint64_t) (k + np);
+
+    // Whole codewords go to the encoder as one batch, so a batch kernel can
+    // run several of them at once
+    uint64_t whole = job->length / (uint64_t) k;
+    uint64_t end = last < whole ? last : whole;
+    if (end > first) {
+        int count = (int) (end - first);
+        for (int c = 0; c < count; c++) {
+            memcpy(&out[(size_t) c * (size_t) (k + np)], &in[(size_t) c * k],
+                   (size_t) k);
+        }
+        rs_codec_encode_batch(job->codec, in, k, (size_t) k, &out[k],
+                              (size_t) (k + np), count);
+        in += (size_t) count * (size_t) k;
+        out += (size_t) count * (size_t) (k + np);
+    }
+
+    // The final codeword may be short
+    if (last > whole) {
+        int length = (int) (job->length - whole * (uint64_t) k);
+        memcpy(out, in, (size_t) length);
+        rs_codec_encode(job->codec, in, length, &out[length]);
+    }
+}
+
+static void decode_codewords(const segment_job_t * job, uint64_t first,
+                             uint64_t last, int * results) {
+
+    int np = job->codec->nparity;
+    const uint8_t * in = job->in + first * (uint64_t) (job->k + np);
+    uint8_t * out = job->out + first * (uint64_t) job->k;
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+
+    for (uint64_t cw = first; cw < last; cw++) {
+        int k = job->k;
+        if (cw * (uint64_t) k + (uint64_t) k > job->length) {
+            k = (int) (job->length - cw * (uint64_t) k);
+        }
+
+        memcpy(codeword, in, (size_t) (k + np));
+        results[cw - first] = rs_codec_decode(job->codec, codeword, k + np,
+                                              NULL, 0, NULL);
+        memcpy(out, codeword, (size_t) k);
+
+        in += k + np;
+        out += k;
+    }
+}
+
+static int encode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    (void) slot;
+    const segment_job_t * job = ctx;
+    uint64_t first = batch * BATCH_CODEWORDS;
+    uint64_t last = first + BATCH_CODEWORDS;
+    if (last > job->codewords) {
+        last = job->codewords;
+    }
+
+    uint64_t start = rs_trace_begin();
+    encode_codewords(job, first, last);
+    rs_trace_end("encode", start, batch);
+    *length = 0;
+    return 0;
+}
+
+static int decode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    const segment_job_t * job = ctx;
+    uint64_t first = batch * BATCH_CODEWORDS;
+    uint64_t last = first + BATCH_CODEWORDS;
+    if (last > job->codewords) {
+        last = job->codewords;
+    }
+
+    uint64_t start = rs_trace_begin();
+    decode_codewords(job, first, last, (int *) slot);
+    rs_trace_end("decode", start, batch);
+    *length = 0;
+    return 0;
+}
+
+static int finish_encode(void * ctx, uint64_t batch, const uint8_t * slot,
+                         size_t length) {
+
+    (void) ctx;
+    (void) batch;
+    (void) slot;
+    (void) length;
+    return 0;
+}
+
+static int finish_decode(void * ctx, uint64_t batch, const uint8_t * slot,
+                         size_t length) {
+
+    (void) length;
+    segment_job_t * job = ctx;
+    uint64_t first = batch * BATCH_CODEWORDS;
+    uint64_t count = job->codewords - first;
+    if (count > BATCH_CODEWORDS) {
+        count = BATCH_CODEWORDS;
+    }
+
+    rs_file_stats_add(&job->stats, (const int *) slot, first, count, 0);
+    return 0;
+}
@@ -0,0 +1,67 @@
+//
+// Segmentation of payloads of any length into a sequence of codewords.
+// The payload is cut into k symbol messages, each followed by its parity,
+// and the final codeword is shortened to the symbols remaining rather than
+// padded, so the encoded form of an L symbol payload is
+// L + ceil(L / k) * nparity symbols.
+//
+// Long payloads are split into batches of codewords which are coded in
+// parallel on the rs_pipeline worker threads, writing straight into the
+// caller's buffer; short payloads are coded on the calling thread.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_SEGMENT_H
+#define RS_SEGMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_codec.h"
+#include "rs_file.h"
+
+// Number of codewords a payload is segmented into.
+//
+// @param   k: message symbols per full codeword.
+// @param   length: payload symbols.
+uint64_t rs_segment_count(int k, size_t length);
+
+// Length of the encoded form of a payload.
+size_t rs_segment_encoded_length(const rs_codec_t * codec, int k,
+                                 size_t length);
+
+// Encode a payload as a sequence of codewords.
+//
+// @param   codec: the code, used for every codeword.
+// @param   k: message symbols per full codeword, k + nparity <= 2^m - 1.
+// @param   payload: length symbols.
+// @param   out: receives rs_segment_encoded_length() symbols.
+// @param   threads: worker threads, 0 for one per CPU.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_segment_encode(const rs_codec_t * codec, int k, const uint8_t * payload,
+                      size_t length, uint8_t * out, int threads);
+
+// Decode a sequence of codewords back to the payload.
+//
+// @param   encoded: rs_segment_encoded_length() symbols.
+// @param   length: payload symbols.
+// @param   payload: receives length symbols. Codewords which cannot be
+//                   corrected are copied out as received.
+// @param   stats: optional, receives the decoding statistics.
+// @return  0 if every codeword decoded, RS_ERR_UNCORRECTABLE if any failed,
+//          otherwise another negative RS_ERR_ code.
+int rs_segment_decode(const rs_codec_t * codec, int k,
+                      const uint8_t * encoded, size_t length,
+                      uint8_t * payload, int threads,
+                      rs_file_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_SEGMENT_H
@@ -0,0 +1,548 @@
+//
+// Erasure coding of a file across k + nparity shard files.
+//
+// @author Jarrod Bennett
+//
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rs_pipeline.h"
+#include "rs_shard.h"
+#include "rs_trace.h"
+
+// Codewords per batch, i.e. bytes per shard per I/O. Must be a multiple of
+// RS_IO_ALIGNMENT.
+#define SHARD_BATCH             (16384)
+
+// Symbol size of shard files.
+#define SHARD_SYMBOL_SIZE       (8)
+
+typedef struct shard_job {
+    rs_codec_t codec;
+    int k;
+    int n;                      // shards, k + nparity
+    int poly;                   // decode: the code read from the headers
+    int fcr;
+    int prim;
+    int verbose;
+
+    const uint8_t * input;      // encode: the mapped input file
+    uint64_t length;            // bytes of original data
+    uint64_t codewords;
+
+    int fds[RS_SHARD_MAX];      // by shard index, -1 if erased
+    int erasures[RS_SHARD_MAX]; // erased shard indices
+    int nerasures;
+
+    int nslots;
+    uint8_t ** slots;           // pipeline slots, RS_IO_ALIGNMENT aligned
+    uint8_t ** stages;          // decode: per worker shard read buffers
+    rs_io_t * ios;              // encode: one for the writer; decode: per
+                                // worker
+    int nios;
+
+    int outFd;
+    rs_file_stats_t stats;
+} shard_job_t;
+
+static int encode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length);
+static int write_shards(void * ctx, uint64_t batch, const uint8_t * slot,
+                        size_t length);
+static int decode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length);
+static int write_decoded(void * ctx, uint64_t batch, const uint8_t * slot,
+                         size_t length);
+
+// After a failed batch read, read each shard's chunk again directly to find
+// the ones that fail, zeroing their chunks and adding them to erasures.
+// Returns the new number of erasures.
+static int reread_shards(const shard_job_t * job, uint8_t * stage,
+                         size_t chunk, uint64_t offset, uint64_t batch,
+                         int * erasures, int nerasures);
+
+// Read the headers of the given shards and pick out the usable ones.
+static int identify_shards(shard_job_t * job, const int * shardFds,
+                           int count);
+
+// Allocate pipeline slots and I/O contexts, registering buffers with them.
+static int job_setup(shard_job_t * job, int threads, size_t slotSize,
+                     int decoding, const rs_file_options_t * options);
+static void job_teardown(shard_job_t * job);
+
+static uint64_t batch_count(uint64_t codewords);
+static size_t chunk_length(uint64_t count);
+
+int rs_shard_encode(int inFd, const int * shardFds,
+                    const rs_file_options_t * options) {
+
+    shard_job_t job;
+    memset(&job, 0, sizeof(job));
+
+    int err = rs_codec_init_generator(&job.codec, SHARD_SYMBOL_SIZE,
+                                      options->nparity, options->poly,
+                                      options->fcr, options->prim);
+    if (err) {
+        return err;
+    }
+    rs_codec_set_stats(&job.codec, options->codecStats);
+    job.k = options->k;
+    job.n = options->k + options->nparity;
+    if (options->k < 1 || job.n > job.codec.nn) {
+        rs_codec_free(&job.codec);
+        return RS_ERR_INVALID_ARGS;
+    }
+    for (int j = 0; j < job.n; j++) {
+        job.fds[j] = shardFds[j];
+    }
+
+    err = rs_file_map(inFd, &job.input, &job.length);
+    if (err) {
+        rs_codec_free(&job.codec);
+        return err;
+    }
+    job.codewords = (job.length + (uint64_t) job.k - 1) / (uint64_t) job.k;
+
+    uint64_t batches = batch_count(job.codewords);
+    int threads = rs_pipeline_threads(options->threads, batches);
+
+    err = job_setup(&job, threads, (size_t) job.n * SHARD_BATCH, 0,
+                    options);
+
+    // Headers first, through the same queue as the data
+    if (!err) {
+        uint8_t * headers = job.slots[0];
+        for (int j = 0; j < job.n; j++) {
+            uint8_t * block = headers + (size_t) j * RS_SHARD_DATA_OFFSET;
+            rs_file_header_t header = {SHARD_SYMBOL_SIZE, job.k,
+                                       options->nparity, j, job.length,
+                                       job.codec.field->poly, job.codec.fcr,
+                                       job.codec.prim};
+
+            memset(block, 0, RS_SHARD_DATA_OFFSET);
+            rs_file_header_pack(&header, block);
+            rs_io_write(&job.ios[0], job.fds[j], block, RS_SHARD_DATA_OFFSET,
+                        0, 0);
+        }
+        err = rs_io_wait(&job.ios[0]);
+    }
+
+    if (!err) {
+        err = rs_pipeline_run_slots(batches, job.slots, job.nslots,
+                                    encode_batch, write_shards, &job);
+        if (err == -1) {
+            err = RS_ERR_NO_MEMORY;
+        }
+    }
+
+    job_teardown(&job);
+    if (job.input != NULL) {
+        munmap((void *) job.input, job.length);
+    }
+    rs_codec_free(&job.codec);
+
+    return err;
+}
+
+int rs_shard_decode(const int * shardFds, int count, int outFd,
+                    const rs_file_options_t * options,
+                    rs_file_stats_t * stats) {
+
+    shard_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.outFd = outFd;
+    job.verbose = options->verbose;
+
+    int err = identify_shards(&job, shardFds, count);
+    if (!err && job.nerasures > job.n - job.k) {
+        err = RS_ERR_UNCORRECTABLE;
+    }
+    if (!err) {
+        err = rs_codec_init_generator(&job.codec, SHARD_SYMBOL_SIZE,
+                                      job.n - job.k, job.poly, job.fcr,
+                                      job.prim);
+    }
+    if (err) {
+        if (stats != NULL) {
+            memset(stats, 0, sizeof(*stats));
+        }
+        return err;
+    }
+    rs_codec_set_stats(&job.codec, options->codecStats);
+
+    uint64_t batches = batch_count(job.codewords);
+    int threads = rs_pipeline_threads(options->threads, batches);
+    size_t slotSize = SHARD_BATCH * (sizeof(int) + (size_t) job.k);
+
+    err = job_setup(&job, threads, slotSize, 1, options);
+    if (!err) {
+        err = rs_pipeline_run_slots(batches, job.slots, job.nslots,
+                                    decode_batch, write_decoded, &job);
+        if (err == -1) {
+            err = RS_ERR_NO_MEMORY;
+        }
+    }
+    if (!err && job.stats.failed > 0) {
+        err = RS_ERR_UNCORRECTABLE;
+    }
+
+    job_teardown(&job);
+    rs_codec_free(&job.codec);
+    if (stats != NULL) {
+        *stats = job.stats;
+    }
+
+    return err;
+}
+
+static int encode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length) {
+
+    (void) worker;
+    shard_job_t * job = ctx;
+    int k = job->k;
+    uint64_t first = batch * SHARD_BATCH;
+    uint64_t count = job->codewords - first;
+    if (count > SHARD_BATCH) {
+        count = SHARD_BATCH;
+    }
+
+    uint64_t start = rs_trace_begin();
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+
+    for (uint64_t c = 0; c < count; c++) {
+        uint64_t offset = (first + c) * (uint64_t) k;
+        int take = k;
+        if (offset + (uint64_t) k > job->length) {
+            take = (int) (job->length - offset);
+        }
+
+        memcpy(codeword, &job->input[offset], (size_t) take);
+        memset(&codeword[take], 0, (size_t) (k - take));
+        rs_codec_encode(&job->codec, codeword, k, &codeword[k]);
+
+        // Transpose into the per-shard chunks of the slot
+        for (int j = 0; j < job->n; j++) {
+            slot[(size_t) j * SHARD_BATCH + c] = codeword[j];
+        }
+    }
+
+    size_t chunk = chunk_length(count);
+    for (int j = 0; j < job->n; j++) {
+        memset(&slot[(size_t) j * SHARD_BATCH + count], 0,
+               chunk - (size_t) count);
+    }
+    rs_trace_end("encode", start, batch);
+
+    *length = chunk;
+    return 0;
+}
+
+static int write_shards(void * ctx, uint64_t batch, const uint8_t * slot,
+                        size_t length) {
+
+    shard_job_t * job = ctx;
+    rs_io_t * io = &job->ios[0];
+    uint64_t offset = RS_SHARD_DATA_OFFSET + batch * SHARD_BATCH;
+    int bufferIndex = (int) (batch % (uint64_t) job->nslots);
+    uint64_t start = rs_trace_begin();
+
+    for (int j = 0; j < job->n; j++) {
+        rs_io_write(io, job->fds[j], &slot[(size_t) j * SHARD_BATCH], length,
+                    offset, bufferIndex);
+    }
+
+    // The slot is handed back to the workers on return, so the writes from
+    // it must be complete. Workers keep encoding the next batches meanwhile.
+    int err = rs_io_wait(io);
+    rs_trace_end("write", start, batch);
+
+    return err;
+}
+
+static int decode_batch(void * ctx, int worker, uint64_t batch,
+                        uint8_t * slot, size_t * length) {
+
+    shard_job_t * job = ctx;
+    rs_io_t * io = &job->ios[worker];
+    uint8_t * stage = job->stages[worker];
+    int k = job->k;
+
+    uint64_t first = batch * SHARD_BATCH;
+    uint64_t count = job->codewords - first;
+    if (count > SHARD_BATCH) {
+        count = SHARD_BATCH;
+    }
+
+    size_t chunk = chunk_length(count);
+    uint64_t offset = RS_SHARD_DATA_OFFSET + first;
+    uint64_t start = rs_trace_begin();
+    for (int j = 0; j < job->n; j++) {
+        if (job->fds[j] >= 0) {
+            rs_io_read(io, job->fds[j], &stage[(size_t) j * SHARD_BATCH],
+                       chunk, offset, 0);
+        }
+    }
+
+    // A shard that fails to read is erased for this batch, like a missing
+    // one, rather than failing the whole decode
+    int erasures[RS_SHARD_MAX];
+    int nerasures = job->nerasures;
+    memcpy(erasures, job->erasures, (size_t) nerasures * sizeof(int));
+    if (rs_io_wait(io) != 0) {
+        nerasures = reread_shards(job, stage, chunk, offset, batch, erasures,
+                                  nerasures);
+    }
+    rs_trace_end("read", start, batch);
+
+    start = rs_trace_begin();
+    int * results = (int *) slot;
+    uint8_t * out = slot + SHARD_BATCH * sizeof(int);
+    uint8_t codeword[RS_FIELD_MAX_SIZE];
+
+    for (uint64_t c = 0; c < count; c++) {
+        for (int j = 0; j < job->n; j++) {
+            codeword[j] = job->fds[j] >= 0
+                          ? stage[(size_t) j * SHARD_BATCH + c] : 0;
+        }
+
+        results[c] = nerasures <= job->n - k
+                     ? rs_codec_decode(&job->codec, codeword, job->n,
+                                       erasures, nerasures, NULL)
+                     : RS_ERR_UNCORRECTABLE;
+
+        uint64_t dataOffset = (first + c) * (uint64_t) k;
+        int take = k;
+        if (dataOffset + (uint64_t) k > job->length) {
+            take = (int) (job->length - dataOffset);
+        }
+        memcpy(out, codeword, (size_t) take);
+        out += take;
+    }
+    rs_trace_end("decode", start, batch);
+
+    *length = (size_t) (out - slot);
+    return 0;
+}
+
+static int write_decoded(void * ctx, uint64_t batch, const uint8_t * slot,
+                         size_t length) {
+
+    shard_job_t * job = ctx;
+    size_t resultsSize = SHARD_BATCH * sizeof(int);
+    uint64_t first = batch * SHARD_BATCH;
+    uint64_t count = job->codewords - first;
+    if (count > SHARD_BATCH) {
+        count = SHARD_BATCH;
+    }
+
+    rs_file_stats_add(&job->stats, (const int *) slot, first, count,
+                      job->verbose);
+
+    uint64_t start = rs_trace_begin();
+    int err = rs_file_write_all(job->outFd, slot + resultsSize,
+                                length - resultsSize);
+    rs_trace_end("write", start, batch);
+
+    return err;
+}
+
+static int reread_shards(const shard_job_t * job, uint8_t * stage,
+                         size_t chunk, uint64_t offset, uint64_t batch,
+                         int * erasures, int nerasures) {
+
+    for (int j = 0; j < job->n; j++) {
+        uint8_t * data = &stage[(size_t) j * SHARD_BATCH];
+        if (job->fds[j] < 0 ||
+            pread(job->fds[j], data, chunk, (off_t) offset) ==
+            (ssize_t) chunk) {
+            continue;
+        }
+        memset(data, 0, chunk);
+        erasures[nerasures++] = j;
+        if (job->verbose) {
+            fprintf(stderr, "shard %d: read failed in batch %llu, erased\n",
+                    j, (unsigned long long) batch);
+        }
+    }
+
+    return nerasures;
+}
+
+static int identify_shards(shard_job_t * job, const int * shardFds,
+                           int count) {
+
+    uint8_t * block;
+    if (posix_memalign((void **) &block, RS_IO_ALIGNMENT,
+                       RS_SHARD_DATA_OFFSET)) {
+        return RS_ERR_NO_MEMORY;
+    }
+
+    for (int j = 0; j < RS_SHARD_MAX; j++) {
+        job->fds[j] = -1;
+    }
+
+    rs_file_header_t reference;
+    memset(&reference, 0, sizeof(reference));
+    reference.shard = -1;
+    int found = 0;
+
+    for (int i = 0; i < count; i++) {
+        int fd = shardFds[i];
+        rs_file_header_t header;
+        struct stat st;
+
+        if (fd < 0 ||
+            pread(fd, block, RS_SHARD_DATA_OFFSET, 0) !=
+            RS_SHARD_DATA_OFFSET ||
+            rs_file_header_unpack(block, &header) || header.shard < 0 ||
+            header.m != SHARD_SYMBOL_SIZE || fstat(fd, &st) != 0) {
+            continue;
+        }
+
+        if (!found) {
+            reference = header;
+            found = 1;
+        } else if (header.k != reference.k ||
+                   header.nparity != reference.nparity ||
+                   header.length != reference.length ||
+                   header.poly != reference.poly ||
+                   header.fcr != reference.fcr ||
+                   header.prim != reference.prim) {
+            continue;
+        }
+
+        uint64_t codewords = (header.length + (uint64_t) header.k - 1) /
+                             (uint64_t) header.k;
+        uint64_t need = RS_SHARD_DATA_OFFSET + chunk_length(codewords);
+        if ((uint64_t) st.st_size < need || job->fds[header.shard] >= 0) {
+            continue;
+        }
+        job->fds[header.shard] = fd;
+    }
+    free(block);
+
+    if (!found) {
+        return RS_ERR_FORMAT;
+    }
+
+    job->k = reference.k;
+    job->n = reference.k + reference.nparity;
+    job->length = reference.length;
+    job->poly = reference.poly;
+    job->fcr = reference.fcr;
+    job->prim = reference.prim;
+    job->codewords = (job->length + (uint64_t) job->k - 1) /
+                     (uint64_t) job->k;
+
+    job->nerasures = 0;
+    for (int j = 0; j < job->n; j++) {
+        if (job->fds[j] < 0) {
+            job->erasures[job->nerasures++] = j;
+        }
+    }
+
+    return 0;
+}
+
+static int job_setup(shard_job_t * job, int threads, size_t slotSize,
+                     int decoding, const rs_file_options_t * options) {
+
+    // The first slot doubles as the header staging area when encoding
+    size_t headerSize = (size_t) job->n * RS_SHARD_DATA_OFFSET;
+    if (slotSize < headerSize) {
+        slotSize = headerSize;
+    }
+
+    int nios = decoding ? threads : 1;
+    job->nslots = 2 * threads;
+    job->slots = calloc((size_t) job->nslots, sizeof(uint8_t *));
+    job->ios = calloc((size_t) nios, sizeof(rs_io_t));
+    job->stages = calloc((size_t) nios, sizeof(uint8_t *));
+    struct iovec * buffers = calloc((size_t) job->nslots,
+                                    sizeof(struct iovec));
+    if (job->slots == NULL || job->ios == NULL || job->stages == NULL ||
+        buffers == NULL) {
+        free(buffers);
+        return RS_ERR_NO_MEMORY;
+    }
+
+    for (int i = 0; i < job->nslots; i++) {
+        if (posix_memalign((void **) &job->slots[i], RS_IO_ALIGNMENT,
+                           slotSize)) {
+            job->slots[i] = NULL;
+            free(buffers);
+            return RS_ERR_NO_MEMORY;
+        }
+        buffers[i].iov_base = job->slots[i];
+        buffers[i].iov_len = slotSize;
+    }
+
+    for (int i = 0; i < nios; i++) {
+        int err = rs_io_init(&job->ios[i], options->depth, options->ioFlags);
+        if (err) {
+            free(buffers);
+            return err;
+        }
+        job->nios = i + 1;
+    }
+
+    if (!decoding) {
+        // The writer writes straight out of the slots
+        rs_io_register_buffers(&job->ios[0], buffers, job->nslots);
+    } else {
+        // Each worker reads into its own staging buffer
+        size_t stageSize = (size_t) job->n * SHARD_BATCH;
+        for (int i = 0; i < nios; i++) {
+            if (posix_memalign((void **) &job->stages[i], RS_IO_ALIGNMENT,
+                               stageSize)) {
+                job->stages[i] = NULL;
+                free(buffers);
+                return RS_ERR_NO_MEMORY;
+            }
+            struct iovec stage = {job->stages[i], stageSize};
+            rs_io_register_buffers(&job->ios[i], &stage, 1);
+        }
+    }
+    free(buffers);
+
+    return 0;
+}
+
+static void job_teardown(shard_job_t * job) {
+
+    for (int i = 0; i < job->nios; i++) {
+        rs_io_free(&job->ios[i]);
+    }
+    if (job->stages != NULL) {
+        for (int i = 0; i < job->nios; i++) {
+            free(job->stages[i]);
+        }
+    }
+    if (job->slots != NULL) {
+        for (int i = 0; i < job->nslots; i++) {
+            free(job->slots[i]);
+        }
+    }
+    free(job->ios);
+    free(job->stages);
+    free(job->slots);
+}
+
+static uint64_t batch_count(uint64_t codewords) {
+
+    return (codewords + SHARD_BATCH - 1) / SHARD_BATCH;
+}
+
+static size_t chunk_length(uint64_t count) {
+
+    return (size_t) ((count + RS_IO_ALIGNMENT - 1) / RS_IO_ALIGNMENT *
+                     RS_IO_ALIGNMENT);
+}
@@ -0,0 +1,73 @@
+//
+// Erasure coding of a file across k + nparity shard files. Shard j holds
+// symbol j of every codeword, so losing up to nparity whole shards (a dead
+// disk, a missing object) is repaired by decoding with those shards as
+// erasures. Unlike rs_file the final codeword is zero padded to k symbols,
+// since every shard must hold a symbol of every codeword.
+//
+// Shard file layout:
+//
+//   offset  size                  contents
+//   0       RS_SHARD_DATA_OFFSET  rs_file header with the shard index set,
+//                                 zero padded
+//   4096    codewords             symbol j of each codeword, zero padded
+//                                 to a multiple of RS_IO_ALIGNMENT
+//
+// All shard I/O goes through rs_io: the writes (or reads) of one batch to
+// every shard are submitted to io_uring together, from aligned buffers that
+// are registered with the ring, and files may be opened with O_DIRECT since
+// every offset and length is a multiple of RS_IO_ALIGNMENT. Coding runs on
+// the rs_pipeline worker threads while the previous batch's I/O is in
+// flight.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_SHARD_H
+#define RS_SHARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rs_file.h"
+#include "rs_io.h"
+
+// Offset of the symbol data in each shard file.
+#define RS_SHARD_DATA_OFFSET    (RS_IO_ALIGNMENT)
+
+// Maximum number of shards, one per symbol of an 8-bit codeword.
+#define RS_SHARD_MAX            (255)
+
+// Split a file into k + nparity shards.
+//
+// @param   inFd: the (mappable) input file.
+// @param   shardFds: options->k + options->nparity writable descriptors.
+// @param   options: code, thread and I/O settings.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_shard_encode(int inFd, const int * shardFds,
+                    const rs_file_options_t * options);
+
+// Reassemble a file from its shards. Shards are identified by their
+// headers, not their position in shardFds. Shards which are missing (-1),
+// unreadable or inconsistent are treated as erasures, as is a shard for
+// any batch of codewords in which a read of it fails. A batch left with
+// fewer than k readable shards fails as uncorrectable, and the rest of the
+// file is still decoded.
+//
+// @param   shardFds: count readable descriptors, -1 for any missing.
+// @param   count: number of entries in shardFds.
+// @param   outFd: receives the reassembled file; may be a pipe.
+// @param   stats: optional, receives the decoding statistics.
+// @return  0 if every codeword decoded, RS_ERR_UNCORRECTABLE if any failed
+//          (or too many shards are missing), otherwise another negative
+//          RS_ERR_ code.
+int rs_shard_decode(const int * shardFds, int count, int outFd,
+                    const rs_file_options_t * options,
+                    rs_file_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_SHARD_H
@@ -0,0 +1,765 @@
+//
+// rs_sim: Monte Carlo frame and symbol error rates of a Reed-Solomon code
+// sent over M-FSK, M = 2^m, with non-coherent detection.
+//
+// usage: rs_sim [-m bits] [-k data] [-p parity] [-c channel] [-r ratio]
+//               [-C weak:trials] [-G] [-e start:stop:step] [-E errors]
+//               [-N frames] [-j threads] [-s seed]
+//        rs_sim -B [-m bits] [-k data] [-p parity] [-g p:r:good:bad]
+//               [-N codewords] [-s seed]
+//
+// The defaults simulate the RS(14, 10) code over GF(16) of main.c on a
+// 16-FSK link. Each frame is a random message which is encoded, sent over
+// the channel symbol by symbol, demodulated and decoded. The channel is
+// AWGN, fast (per symbol) Rayleigh fading or block (per frame) Rayleigh
+// fading. The demodulator makes a hard decision on the strongest tone and,
+// with -r, erases symbols whose strongest tone is less than ratio dB above
+// the runner up, keeping at most p of the least reliable. With -C the
+// decoder instead makes soft decisions, by rs_codec_decode_chase() over
+// the given number of least reliable symbols, taking that ratio in dB as
+// each symbol's reliability, and with -G likewise by
+// rs_codec_decode_gmd().
+//
+// Every worker thread has its own random number generator, seeded from the
+// seed and its index, and works in chunks of frames. Each Eb/N0 point stops
+// once E frame errors (or N frames) have been seen, and the sweep stops at
+// the first point without any frame errors. One line is printed per point:
+//
+//   EbN0_dB EsN0_dB frames frame_errors FER SER raw_SER erasures
+//
+// where SER counts message symbols still wrong after decoding, raw_SER the
+// codeword symbols wrong out of the demodulator and erasures is the mean
+// per frame.
+//
+// Rather than drawing a noise sample for all M tones, the energy of the
+// strongest of the M - 1 noise only tones (and, when needed, of the next
+// strongest) is drawn directly from its order statistic, so a symbol costs
+// a handful of random numbers whatever M is.
+//
+// With -B the decoder is benchmarked instead: batches of codewords are
+// corrupted with exactly 0, 1, .. t + 1 symbol errors (t = p / 2), then
+// with errors from a Gilbert-Elliott burst channel, and the time taken to
+// decode them is reported in ns per codeword. The burst channel moves from
+// its good to its bad state with probability p and back with probability
+// r before each symbol, and corrupts the symbol with probability good or
+// bad according to its state. Its state runs on from codeword to codeword,
+// so a fade can span several of them.
+//
+// @author Jarrod Bennett
+//
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rs_codec.h"
+#include "rs_pipeline.h"
+
+// Frames simulated by a thread between updates of the shared counters.
+#define CHUNK_FRAMES            (256)
+
+// Codewords corrupted ahead of each timed run of the decoder.
+#define BENCH_BATCH             (4096)
+
+// Default codewords decoded per benchmark row.
+#define BENCH_DEFAULT_CODEWORDS (1000000)
+
+#define CHANNEL_AWGN            (0)
+#define CHANNEL_RAYLEIGH        (1)     // fast fading, per symbol
+#define CHANNEL_BLOCK           (2)     // block fading, per frame
+
+typedef struct sim {
+    const rs_codec_t * codec;
+    int k;
+    int n;
+    int channel;
+    double ratio;           // erasure threshold, linear, 0 for hard only
+    int weak;               // Chase decoding symbols, 0 for off
+    int trials;             // and patterns
+    int gmd;                // GMD decoding
+    double es;              // symbol energy, the noise density being 1
+    uint64_t seed;
+    uint64_t maxErrors;
+    uint64_t maxFrames;
+
+    // Shared totals, updated atomically once per chunk
+    uint64_t frames;
+    uint64_t frameErrors;
+    uint64_t symbolErrors;
+    uint64_t rawErrors;
+    uint64_t erasures;
+} sim_t;
+
+typedef struct worker {
+    sim_t * sim;
+    int index;
+} worker_t;
+
+// xoshiro256** state.
+typedef struct rng {
+    uint64_t s[4];
+} rng_t;
+
+// Gilbert-Elliott burst channel.
+typedef struct burst {
+    double enter;           // P(good -> bad) per symbol
+    double leave;           // P(bad -> good) per symbol
+    double good;            // symbol error probability in the good state
+    double bad;             // symbol error probability in the bad state
+    int state;              // 1 while in the bad state
+} burst_t;
+
+// A demodulated symbol.
+typedef struct symbol {
+    uint8_t value;
+    double ratio;           // strongest over next strongest tone energy
+} symbol_t;
+
+static void * worker_main(void * arg);
+static void run_frames(sim_t * sim, rng_t * rng, int frames,
+                       uint64_t * counts);
+static void demodulate(const sim_t * sim, rng_t * rng, uint8_t sent,
+                       double amplitude, symbol_t * symbol);
+static int pick_erasures(const sim_t * sim, const symbol_t * symbols,
+                         int * erasures);
+static int run_bench(const rs_codec_t * codec, int k, burst_t * burst,
+                     uint64_t codewords, uint64_t seed);
+static double bench_decode(const rs_codec_t * codec, uint8_t * batch,
+                           int count, int n, uint64_t * failures);
+static int corrupt_fixed(const rs_codec_t * codec, rng_t * rng,
+                         uint8_t * codeword, int n, int errors);
+static int corrupt_burst(const rs_codec_t * codec, rng_t * rng,
+                         burst_t * burst, uint8_t * codeword, int n);
+static void rng_seed(rng_t * rng, uint64_t seed);
+static uint64_t rng_next(rng_t * rng);
+
+static void usage(void) {
+
+    fprintf(stderr,
+            "usage: rs_sim [-m bits] [-k data] [-p parity] [-c channel] "
+            "[-r ratio]\n"
+            "              [-C weak:trials] [-G] [-e start:stop:step] "
+            "[-E errors] [-N frames]\n"
+            "              [-j threads] [-s seed]\n"
+            "       rs_sim -B [-m bits] [-k data] [-p parity] "
+            "[-g p:r:good:bad]\n"
+            "              [-N codewords] [-s seed]\n"
+            "  -m  bits per symbol, M-FSK with M = 2^bits (default 4)\n"
+            "  -k  data symbols per codeword (default 10)\n"
+            "  -p  parity symbols per codeword (default 4)\n"
+            "  -c  awgn, rayleigh (per symbol) or block (per frame)\n"
+            "  -r  erase symbols less than ratio dB above the runner up\n"
+            "  -C  Chase decode erasing patterns of the weak least "
+            "reliable symbols\n"
+            "  -G  GMD decode erasing 2, 4, ... of the least reliable "
+            "symbols\n"
+            "  -e  Eb/N0 sweep in dB (default 0:12:1)\n"
+            "  -E  frame errors to stop each point at (default 200)\n"
+            "  -N  frames to stop each point at (default 100000000)\n"
+            "  -j  worker threads (default one per CPU)\n"
+            "  -s  random seed (default 1)\n"
+            "  -B  benchmark the decoder rather than simulate the link\n"
+            "  -g  Gilbert-Elliott burst channel for -B "
+            "(default 0.01:0.1:0.001:0.5)\n");
+}
+
+// Parse count numbers separated by colons.
+static int parse_list(const char * text, double * values, int count) {
+
+    char * end;
+    for (int i = 0; i < count; i++) {
+        values[i] = strtod(text, &end);
+        if (end == text || *end != (i < count - 1 ? ':' : '\0')) {
+            return -1;
+        }
+        text = end + 1;
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+
+    int m = 4;
+    int k = 10;
+    int nparity = 4;
+    int channel = CHANNEL_AWGN;
+    double ratio = 0;
+    double chase[2] = {0, 0};
+    int gmd = 0;
+    double sweep[3] = {0, 12, 1};
+    uint64_t maxErrors = 200;
+    uint64_t maxFrames = 0;
+    int threads = 0;
+    uint64_t seed = 1;
+    int bench = 0;
+    double model[4] = {0.01, 0.1, 0.001, 0.5};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:k:p:c:r:C:Ge:E:N:j:s:Bg:h")) != -1) {
+        switch (opt) {
+            case 'm':
+                m = atoi(optarg);
+                break;
+            case 'k':
+                k = atoi(optarg);
+                break;
+            case 'p':
+                nparity = atoi(optarg);
+                break;
+            case 'c':
+                if (strcmp(optarg, "awgn") == 0) {
+                    channel = CHANNEL_AWGN;
+                } else if (strcmp(optarg, "rayleigh") == 0) {
+                    channel = CHANNEL_RAYLEIGH;
+                } else if (strcmp(optarg, "block") == 0) {
+                    channel = CHANNEL_BLOCK;
+                } else {
+                    usage();
+                    return 2;
+                }
+                break;
+            case 'r':
+                ratio = pow(10, atof(optarg) / 10);
+                break;
+            case 'C':
+                if (parse_list(optarg, chase, 2) || chase[0] < 1 ||
+                    chase[1] < 1) {
+                    usage();
+                    return 2;
+                }
+                break;
+            case 'G':
+                gmd = 1;
+                break;
+            case 'e':
+                if (parse_list(optarg, sweep, 3) || sweep[2] <= 0) {
+                    usage();
+                    return 2;
+                }
+                break;
+            case 'E':
+                maxErrors = strtoull(optarg, NULL, 10);
+                break;
+            case 'N':
+                maxFrames = strtoull(optarg, NULL, 10);
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'B':
+                bench = 1;
+                break;
+            case 'g':
+                if (parse_list(optarg, model, 4)) {
+                    usage();
+                    return 2;
+                }
+                break;
+            default:
+                usage();
+                return 2;
+        }
+    }
+    if (argc != optind || maxErrors == 0 ||
+        (ratio > 0) + (chase[0] > 0) + gmd > 1) {
+        usage();
+        return 2;
+    }
+
+    rs_codec_t codec;
+    if (k <= 0 || rs_codec_init(&codec, m, nparity) != 0 ||
+        k + nparity > codec.nn) {
+        fprintf(stderr, "rs_sim: invalid code\n");
+        return 2;
+    }
+    int weak = (int) chase[0];
+    int trials = (int) chase[1];
+    if (weak > 0 && (weak > nparity || weak > RS_CODEC_MAX_CHASE ||
+                     trials > 1 << weak)) {
+        fprintf(stderr, "rs_sim: invalid Chase decoding\n");
+        return 2;
+    }
+
+    if (bench) {
+        burst_t burst = {model[0], model[1], model[2], model[3], 0};
+        int status = run_bench(&codec, k, &burst, maxFrames > 0 ? maxFrames :
+                               BENCH_DEFAULT_CODEWORDS, seed);
+        rs_codec_free(&codec);
+        return status;
+    }
+
+    if (threads <= 0) {
+        threads = rs_pipeline_cpu_count();
+    }
+    if (maxFrames == 0) {
+        maxFrames = 100000000;
+    }
+
+    static const char * const channels[] = {"awgn", "rayleigh", "block"};
+    int n = k + nparity;
+    printf("# RS(%d, %d) over GF(%d), %d-FSK, %s, ", n, k, 1 << m, 1 << m,
+           channels[channel]);
+    if (ratio > 0) {
+        printf("erasures below %.2f dB\n", 10 * log10(ratio));
+    } else if (weak > 0) {
+        printf("Chase decoding, %d weakest symbols, %d trials\n", weak,
+               trials);
+    } else if (gmd) {
+        printf("GMD decoding\n");
+    } else {
+        printf("hard decisions\n");
+    }
+    printf("# EbN0_dB EsN0_dB frames frame_errors FER SER raw_SER "
+           "erasures\n");
+    fflush(stdout);
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    uint64_t totalFrames = 0;
+
+    pthread_t * tids = malloc((size_t) threads * sizeof(pthread_t));
+    worker_t * workers = malloc((size_t) threads * sizeof(worker_t));
+    if (tids == NULL || workers == NULL) {
+        fprintf(stderr, "rs_sim: out of memory\n");
+        return 1;
+    }
+
+    int status = 0;
+    for (int point = 0; status == 0; point++) {
+        double ebN0 = sweep[0] + point * sweep[2];
+        if (ebN0 > sweep[1] + sweep[2] * 1e-9) {
+            break;
+        }
+
+        // Es/N0 = Eb/N0 * information bits per channel symbol
+        double esN0 = ebN0 + 10 * log10((double) m * k / n);
+
+        sim_t sim;
+        memset(&sim, 0, sizeof(sim));
+        sim.codec = &codec;
+        sim.k = k;
+        sim.n = n;
+        sim.channel = channel;
+        sim.ratio = ratio;
+        sim.weak = weak;
+        sim.trials = trials;
+        sim.gmd = gmd;
+        sim.es = pow(10, esN0 / 10);
+        sim.seed = seed + (uint64_t) point * 0x9e3779b97f4a7c15ULL;
+        sim.maxErrors = maxErrors;
+        sim.maxFrames = maxFrames;
+
+        int started = 0;
+        for (; started < threads; started++) {
+            workers[started].sim = &sim;
+            workers[started].index = started;
+            if (pthread_create(&tids[started], NULL, worker_main,
+                               &workers[started])) {
+                break;
+            }
+        }
+        if (started == 0) {
+            fprintf(stderr, "rs_sim: cannot start threads\n");
+            status = 1;
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(tids[i], NULL);
+        }
+        if (status != 0) {
+            break;
+        }
+
+        double frames = (double) sim.frames;
+        printf("%7.2f %7.2f %12llu %8llu %.4e %.4e %.4e %.3f\n", ebN0, esN0,
+               (unsigned long long) sim.frames,
+               (unsigned long long) sim.frameErrors,
+               sim.frameErrors / frames, sim.symbolErrors / (frames * k),
+               sim.rawErrors / (frames * n), sim.erasures / frames);
+        fflush(stdout);
+
+        totalFrames += sim.frames;
+        if (sim.frameErrors == 0) {
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double) (end.tv_sec - begin.tv_sec) +
+                     (double) (end.tv_nsec - begin.tv_nsec) * 1e-9;
+    printf("# %llu frames in %.1f s on %d threads, %.1f Mframes/min\n",
+           (unsigned long long) totalFrames, seconds, threads,
+           seconds > 0 ? (double) totalFrames / seconds * 60e-6 : 0);
+
+    free(workers);
+    free(tids);
+    rs_codec_free(&codec);
+
+    return status;
+}
+
+static void * worker_main(void * arg) {
+
+    worker_t * worker = arg;
+    sim_t * sim = worker->sim;
+
+    rng_t rng;
+    rng_seed(&rng, sim->seed ^ ((uint64_t) worker->index << 32));
+
+    for (;;) {
+        if (__atomic_load_n(&sim->frameErrors, __ATOMIC_RELAXED) >=
+                sim->maxErrors) {
+            break;
+        }
+
+        // Claim a chunk of the frame budget
+        uint64_t first = __atomic_fetch_add(&sim->frames, CHUNK_FRAMES,
+                                            __ATOMIC_RELAXED);
+        if (first >= sim->maxFrames) {
+            __atomic_fetch_sub(&sim->frames, CHUNK_FRAMES, __ATOMIC_RELAXED);
+            break;
+        }
+        int frames = CHUNK_FRAMES;
+        if (sim->maxFrames - first < CHUNK_FRAMES) {
+            frames = (int) (sim->maxFrames - first);
+            __atomic_fetch_sub(&sim->frames, (uint64_t) (CHUNK_FRAMES - frames),
+                               __ATOMIC_RELAXED);
+        }
+
+        uint64_t counts[4] = {0};
+        run_frames(sim, &rng, frames, counts);
+
+        __atomic_fetch_add(&sim->frameErrors, counts[0], __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sim->symbolErrors, counts[1], __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sim->rawErrors, counts[2], __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sim->erasures, counts[3], __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+// Simulate frames, adding frame errors, decoded symbol errors, channel
+// symbol errors and erasures to counts.
+static void run_frames(sim_t * sim, rng_t * rng, int frames,
+                       uint64_t * counts) {
+
+    const rs_codec_t * codec = sim->codec;
+    int k = sim->k;
+    int n = sim->n;
+    uint8_t mask = (uint8_t) codec->nn;
+
+    uint8_t sent[RS_FIELD_MAX_SIZE];
+    uint8_t received[RS_FIELD_MAX_SIZE];
+    symbol_t symbols[RS_FIELD_MAX_SIZE];
+    int erasures[RS_CODEC_MAX_PARITY];
+    float reliability[RS_FIELD_MAX_SIZE];
+
+    for (int f = 0; f < frames; f++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < k; i++) {
+            if ((i & 7) == 0) {
+                bits = rng_next(rng);
+            }
+            sent[i] = (uint8_t) bits & mask;
+            bits >>= 8;
+        }
+        rs_codec_encode(codec, sent, k, &sent[k]);
+
+        double amplitude = 1;
+        if (sim->channel == CHANNEL_BLOCK) {
+            // |h| of a unit power complex Gaussian gain
+            double u = ((rng_next(rng) >> 11) + 1) * 0x1.0p-53;
+            amplitude = sqrt(-log(u));
+        }
+
+        int raw = 0;
+        for (int i = 0; i < n; i++) {
+            demodulate(sim, rng, sent[i], amplitude, &symbols[i]);
+            received[i] = symbols[i].value;
+            raw += received[i] != sent[i];
+        }
+        int nerasures = sim->ratio > 0 ? pick_erasures(sim, symbols,
+                                                       erasures) : 0;
+
+        int errors = 0;
+        if (raw > 0) {
+            if (sim->weak > 0 || sim->gmd) {
+                for (int i = 0; i < n; i++) {
+                    reliability[i] = (float) (10 * log10(symbols[i].ratio));
+                }
+                if (sim->gmd) {
+                    rs_codec_decode_gmd(codec, received, n, reliability,
+                                        NULL);
+                } else {
+                    rs_codec_decode_chase(codec, received, n, reliability,
+                                          sim->weak, sim->trials, NULL);
+                }
+            } else {
+                rs_codec_decode(codec, received, n, erasures, nerasures,
+                                NULL);
+            }
+            for (int i = 0; i < k; i++) {
+                errors += received[i] != sent[i];
+            }
+        }
+
+        counts[0] += errors > 0;
+        counts[1] += (uint64_t) errors;
+        counts[2] += (uint64_t) raw;
+        counts[3] += (uint64_t) nerasures;
+    }
+}
+
+// Demodulate one symbol. The noise density is 1, so each noise only tone
+// has an exponentially distributed energy of mean 1, and the signal tone
+// holds amplitude * sqrt(Es) plus complex Gaussian noise.
+static void demodulate(const sim_t * sim, rng_t * rng, uint8_t sent,
+                       double amplitude, symbol_t * symbol) {
+
+    int tones = sim->codec->nn + 1;
+    double u = ((rng_next(rng) >> 11) + 1) * 0x1.0p-53;
+    double v = ((rng_next(rng) >> 11) + 1) * 0x1.0p-53;
+
+    double signal;
+    if (sim->channel == CHANNEL_RAYLEIGH) {
+        // Faded signal plus noise is complex Gaussian of power Es + 1
+        signal = -(sim->es + 1) * log(u);
+    } else {
+        // Box-Muller, each component of variance 1/2
+        double r = sqrt(-log(u));
+        double re = amplitude * sqrt(sim->es) + r * cos(2 * M_PI * v);
+        double im = r * sin(2 * M_PI * v);
+        signal = re * re + im * im;
+    }
+
+    // Strongest of the tones - 1 noise tones: its CDF is (1 - e^-x)^(M-1)
+    u = ((rng_next(rng) >> 11) + 1) * 0x1.0p-53;
+    double noise = -log(-expm1(log(u) / (tones - 1)));
+
+    if (signal >= noise) {
+        symbol->value = sent;
+        symbol->ratio = signal / noise;
+        return;
+    }
+
+    // A noise tone won, equally likely to be any of the others
+    uint64_t x = rng_next(rng);
+    int offset = 1 + (int) ((x >> 32) * (uint64_t) (tones - 1) >> 32);
+    symbol->value = (uint8_t) ((sent + offset) & (tones - 1));
+
+    double second = signal;
+    if ((sim->ratio > 0 || sim->weak > 0 || sim->gmd) && tones > 2) {
+        // The rest are exponential below the strongest, so the next
+        // strongest has CDF ((1 - e^-y) / (1 - e^-noise))^(M-2)
+        u = ((x & 0xffffffffu) + 1) * 0x1.0p-32;
+        double next = -log1p(expm1(-noise) * exp(log(u) / (tones - 2)));
+        if (next > second) {
+            second = next;
+        }
+    }
+    symbol->ratio = noise / second;
+}
+
+// Collect the symbols below the erasure threshold, keeping the nparity
+// least reliable.
+static int pick_erasures(const sim_t * sim, const symbol_t * symbols,
+                         int * erasures) {
+
+    int nparity = sim->codec->nparity;
+    int count = 0;
+    for (int i = 0; i < sim->n; i++) {
+        double ratio = symbols[i].ratio;
+        if (ratio >= sim->ratio) {
+            continue;
+        }
+        if (count == nparity) {
+            if (ratio >= symbols[erasures[count - 1]].ratio) {
+                continue;
+            }
+            count--;
+        }
+
+        // Insert in order of increasing ratio
+        int j = count++;
+        for (; j > 0 && symbols[erasures[j - 1]].ratio > ratio; j--) {
+            erasures[j] = erasures[j - 1];
+        }
+        erasures[j] = i;
+    }
+    return count;
+}
+
+// Time the decoder on batches of codewords with each fixed number of errors
+// and then with burst errors, printing ns per codeword.
+static int run_bench(const rs_codec_t * codec, int k, burst_t * burst,
+                     uint64_t codewords, uint64_t seed) {
+
+    int n = k + codec->nparity;
+    int t = codec->nparity / 2;
+
+    uint8_t * clean = malloc((size_t) n);
+    uint8_t * batch = malloc((size_t) BENCH_BATCH * (size_t) n);
+    if (clean == NULL || batch == NULL) {
+        free(clean);
+        free(batch);
+        fprintf(stderr, "rs_sim: out of memory\n");
+        return 1;
+    }
+
+    rng_t rng;
+    rng_seed(&rng, seed);
+    for (int i = 0; i < k; i++) {
+        clean[i] = (uint8_t) (rng_next(&rng) >> 56) & (uint8_t) codec->nn;
+    }
+    rs_codec_encode(codec, clean, k, &clean[k]);
+
+    printf("# RS(%d, %d) over GF(%d) decoder, t = %d, %s kernel\n", n, k,
+           codec->nn + 1, t, rs_codec_kernel_name(codec->kernel));
+    printf("# errors codewords ns/codeword uncorrectable\n");
+
+    // Rows for 0 .. t + 1 errors, then the burst channel
+    for (int errors = 0; errors <= t + 2; errors++) {
+        double ns = 0;
+        uint64_t failures = 0;
+        uint64_t symbols = 0;
+        uint64_t worst = 0;
+        for (uint64_t done = 0; done < codewords; ) {
+            int count = BENCH_BATCH;
+            if (codewords - done < BENCH_BATCH) {
+                count = (int) (codewords - done);
+            }
+            for (int c = 0; c < count; c++) {
+                uint8_t * codeword = &batch[(size_t) c * (size_t) n];
+                memcpy(codeword, clean, (size_t) n);
+                int e = errors <= t + 1 ?
+                        corrupt_fixed(codec, &rng, codeword, n, errors) :
+                        corrupt_burst(codec, &rng, burst, codeword, n);
+                symbols += (uint64_t) e;
+                if ((uint64_t) e > worst) {
+                    worst = (uint64_t) e;
+                }
+            }
+            ns += bench_decode(codec, batch, count, n, &failures);
+            done += (uint64_t) count;
+        }
+
+        if (errors <= t + 1) {
+            printf("%8d", errors);
+        } else {
+            printf("# burst p %g r %g good %g bad %g: %.3f errors per "
+                   "codeword, at most %llu\n", burst->enter, burst->leave,
+                   burst->good, burst->bad, (double) symbols / codewords,
+                   (unsigned long long) worst);
+            printf("   burst");
+        }
+        printf(" %12llu %11.1f %.4e\n", (unsigned long long) codewords,
+               ns / codewords, (double) failures / codewords);
+        fflush(stdout);
+    }
+
+    free(batch);
+    free(clean);
+
+    return 0;
+}
+
+// Decode a batch of codewords, returning the time taken in ns.
+static double bench_decode(const rs_codec_t * codec, uint8_t * batch,
+                           int count, int n, uint64_t * failures) {
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (int c = 0; c < count; c++) {
+        int result = rs_codec_decode(codec, &batch[(size_t) c * (size_t) n],
+                                     n, NULL, 0, NULL);
+        *failures += result < 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double) (end.tv_sec - begin.tv_sec) * 1e9 +
+           (double) (end.tv_nsec - begin.tv_nsec);
+}
+
+// Corrupt exactly errors distinct symbols of a codeword.
+static int corrupt_fixed(const rs_codec_t * codec, rng_t * rng,
+                         uint8_t * codeword, int n, int errors) {
+
+    int order[RS_FIELD_MAX_SIZE];
+    for (int i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (int i = 0; i < errors; i++) {
+        uint64_t x = rng_next(rng);
+        int j = i + (int) ((x >> 32) * (uint64_t) (n - i) >> 32);
+        int position = order[j];
+        order[j] = order[i];
+        order[i] = position;
+
+        int value = 1 + (int) ((x & 0xffffffffu) * (uint64_t) codec->nn >> 32);
+        codeword[position] ^= (uint8_t) value;
+    }
+    return errors;
+}
+
+// Corrupt a codeword with the burst channel, returning the number of
+// symbols in error.
+static int corrupt_burst(const rs_codec_t * codec, rng_t * rng,
+                         burst_t * burst, uint8_t * codeword, int n) {
+
+    int errors = 0;
+    for (int i = 0; i < n; i++) {
+        double u = (rng_next(rng) >> 11) * 0x1.0p-53;
+        if (u < (burst->state ? burst->leave : burst->enter)) {
+            burst->state = !burst->state;
+        }
+
+        uint64_t x = rng_next(rng);
+        u = (x >> 11) * 0x1.0p-53;
+        if (u < (burst->state ? burst->bad : burst->good)) {
+            int value = 1 + (int) ((x & 0x7ff) * (uint64_t) codec->nn >> 11);
+            codeword[i] ^= (uint8_t) value;
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static uint64_t splitmix64(uint64_t * x) {
+
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(rng_t * rng, uint64_t seed) {
+
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+static uint64_t rng_next(rng_t * rng) {
+
+    uint64_t * s = rng->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
@@ -0,0 +1,86 @@
+//
+// Codec statistics.
+//
+// @author Jarrod Bennett
+//
+
+#include <string.h>
+
+#include "rs_codec.h"
+#include "rs_stats.h"
+
+static void snapshot_histogram(const rs_stats_histogram_t * histogram,
+                               rs_stats_histogram_t * snapshot);
+
+void rs_stats_reset(rs_codec_stats_t * stats) {
+
+    uint64_t * words = (uint64_t *) stats;
+    for (size_t i = 0; i < sizeof(*stats) / sizeof(uint64_t); i++) {
+        __atomic_store_n(&words[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+void rs_stats_snapshot(const rs_codec_stats_t * stats,
+                       rs_codec_stats_t * snapshot) {
+
+    snapshot->encoded = __atomic_load_n(&stats->encoded, __ATOMIC_RELAXED);
+    snapshot->decoded = __atomic_load_n(&stats->decoded, __ATOMIC_RELAXED);
+    snapshot->corrected = __atomic_load_n(&stats->corrected,
+                                          __ATOMIC_RELAXED);
+    snapshot->symbols = __atomic_load_n(&stats->symbols, __ATOMIC_RELAXED);
+    snapshot->failures = __atomic_load_n(&stats->failures, __ATOMIC_RELAXED);
+    snapshot->erasures = __atomic_load_n(&stats->erasures, __ATOMIC_RELAXED);
+    snapshot_histogram(&stats->encodeCycles, &snapshot->encodeCycles);
+    snapshot_histogram(&stats->decodeCycles, &snapshot->decodeCycles);
+    for (int b = 0; b < RS_STATS_CORRECTION_BUCKETS; b++) {
+        snapshot->corrections[b] = __atomic_load_n(&stats->corrections[b],
+                                                   __ATOMIC_RELAXED);
+    }
+}
+
+void rs_stats_record(rs_stats_histogram_t * histogram, uint64_t cycles) {
+
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sum, cycles, __ATOMIC_RELAXED);
+    int bucket = rs_stats_bucket(cycles, RS_STATS_BUCKETS);
+    __atomic_fetch_add(&histogram->buckets[bucket], 1, __ATOMIC_RELAXED);
+}
+
+void rs_stats_decoded(rs_codec_stats_t * stats, int result, int nerasures,
+                      uint64_t cycles) {
+
+    if (result < 0 && result != RS_ERR_UNCORRECTABLE) {
+        // Bad arguments, nothing was decoded
+        return;
+    }
+
+    __atomic_fetch_add(&stats->decoded, 1, __ATOMIC_RELAXED);
+    if (nerasures > 0) {
+        __atomic_fetch_add(&stats->erasures, (uint64_t) nerasures,
+                           __ATOMIC_RELAXED);
+    }
+    if (result >= 0) {
+        int bucket = rs_stats_bucket((uint64_t) result,
+                                     RS_STATS_CORRECTION_BUCKETS);
+        __atomic_fetch_add(&stats->corrections[bucket], 1, __ATOMIC_RELAXED);
+    }
+    if (result > 0) {
+        __atomic_fetch_add(&stats->corrected, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->symbols, (uint64_t) result,
+                           __ATOMIC_RELAXED);
+    } else if (result == RS_ERR_UNCORRECTABLE) {
+        __atomic_fetch_add(&stats->failures, 1, __ATOMIC_RELAXED);
+    }
+    rs_stats_record(&stats->decodeCycles, cycles);
+}
+
+static void snapshot_histogram(const rs_stats_histogram_t * histogram,
+                               rs_stats_histogram_t * snapshot) {
+
+    snapshot->count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+    snapshot->sum = __atomic_load_n(&histogram->sum, __ATOMIC_RELAXED);
+    for (int b = 0; b < RS_STATS_BUCKETS; b++) {
+        snapshot->buckets[b] = __atomic_load_n(&histogram->buckets[b],
+                                               __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Codec statistics: counters of the work done by a codec context and
+// histograms of the time taken per call. A statistics block is attached to
+// a codec with rs_codec_set_stats() and may be shared by any number of
+// contexts and threads; all updates are relaxed atomics.
+//
+// Latencies are measured in timestamp counter cycles (nanoseconds where
+// there is no rdtsc) and counted in log2 buckets: bucket b holds calls
+// which took [2^(b-1), 2^b) cycles, bucket 0 those which took none.
+//
+// Statistics are built in unless the library is configured with
+// -DRS_CODEC_STATS=OFF, in which case the hooks in the codec compile to
+// nothing and rs_codec_set_stats() fails.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_STATS_H
+#define RS_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Number of log2 latency buckets.
+#define RS_STATS_BUCKETS        (40)
+
+// Number of log2 buckets of symbols corrected per codeword, enough for
+// RS_CODEC_MAX_PARITY.
+#define RS_STATS_CORRECTION_BUCKETS     (8)
+
+typedef struct rs_stats_histogram {
+    uint64_t count;
+    uint64_t sum;               // total cycles
+    uint64_t buckets[RS_STATS_BUCKETS];
+} rs_stats_histogram_t;
+
+typedef struct rs_codec_stats {
+    uint64_t encoded;           // codewords encoded
+    uint64_t decoded;           // codewords decoded
+    uint64_t corrected;         // codewords needing correction
+    uint64_t symbols;           // symbols corrected
+    uint64_t failures;          // uncorrectable codewords
+    uint64_t erasures;          // erasures given to the decoder
+    rs_stats_histogram_t encodeCycles;
+    rs_stats_histogram_t decodeCycles;
+
+    // Symbols corrected per successfully decoded codeword, bucketed as the
+    // latencies are
+    uint64_t corrections[RS_STATS_CORRECTION_BUCKETS];
+} rs_codec_stats_t;
+
+// Read the timestamp counter.
+static inline uint64_t rs_stats_cycles(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint64_t) __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+// Log2 bucket of a value, out of count buckets.
+static inline int rs_stats_bucket(uint64_t value, int count) {
+
+    int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    return bucket < count ? bucket : count - 1;
+}
+
+// Zero a statistics block. Not atomic with respect to concurrent updates.
+void rs_stats_reset(rs_codec_stats_t * stats);
+
+// Copy a statistics block which may be being updated.
+void rs_stats_snapshot(const rs_codec_stats_t * stats,
+                       rs_codec_stats_t * snapshot);
+
+// Record one call taking cycles in a histogram.
+void rs_stats_record(rs_stats_histogram_t * histogram, uint64_t cycles);
+
+// Record the result of decoding one codeword. Calls rejected for bad
+// arguments are not counted.
+//
+// @param   result: the rs_codec_decode() result.
+void rs_stats_decoded(rs_codec_stats_t * stats, int result, int nerasures,
+                      uint64_t cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_STATS_H
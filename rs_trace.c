@@ -0,0 +1,260 @@
+//
+// Chrome trace-event JSON tracing.
+//
+// @author Jarrod Bennett
+//
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rs_codec.h"
+#include "rs_file.h"
+#include "rs_trace.h"
+
+// Bytes of JSON gathered before each write.
+#define WRITE_CHUNK             (1 << 16)
+
+typedef struct trace_event {
+    const char * name;
+    uint64_t start;
+    uint64_t end;
+    uint64_t arg;
+} trace_event_t;
+
+typedef struct trace_buffer {
+    struct trace_buffer * next;
+    int tid;
+    size_t capacity;
+    size_t count;               // published with release stores
+    trace_event_t events[];
+} trace_buffer_t;
+
+int rs_traceEnabled = 0;
+
+static trace_buffer_t * buffers;        // every thread's, pushed atomically
+static unsigned generation;
+static size_t capacity = RS_TRACE_DEFAULT_EVENTS;
+static uint64_t dropped;
+
+// Timestamp counter and clock at the start of the trace, to convert cycles
+// to microseconds.
+static uint64_t startCycles;
+static uint64_t startNs;
+
+static __thread trace_buffer_t * threadBuffer;
+static __thread unsigned threadGeneration;
+
+// Find or register the calling thread's buffer for the current trace.
+static trace_buffer_t * thread_buffer(void);
+
+static uint64_t monotonic_ns(void);
+
+// Append formatted JSON, flushing to fd when the chunk fills.
+static int emit(int fd, char * chunk, size_t * used, const char * format,
+                ...) __attribute__((format(printf, 4, 5)));
+
+void rs_trace_end(const char * name, uint64_t start, uint64_t arg) {
+
+    if (start == 0) {
+        return;
+    }
+    uint64_t end = rs_stats_cycles();
+
+    trace_buffer_t * buffer = thread_buffer();
+    if (buffer == NULL) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    size_t count = buffer->count;
+    if (count == buffer->capacity) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    trace_event_t * event = &buffer->events[count];
+    event->name = name;
+    event->start = start;
+    event->end = end;
+    event->arg = arg;
+    __atomic_store_n(&buffer->count, count + 1, __ATOMIC_RELEASE);
+}
+
+int rs_trace_start(size_t eventsPerThread) {
+
+    rs_trace_stop();
+    rs_trace_free();
+
+    capacity = eventsPerThread > 0 ? eventsPerThread
+                                   : RS_TRACE_DEFAULT_EVENTS;
+    startNs = monotonic_ns();
+    startCycles = rs_stats_cycles();
+
+    __atomic_store_n(&rs_traceEnabled, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void rs_trace_stop(void) {
+
+    __atomic_store_n(&rs_traceEnabled, 0, __ATOMIC_RELEASE);
+}
+
+uint64_t rs_trace_dropped(void) {
+
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+void rs_trace_free(void) {
+
+    trace_buffer_t * buffer = __atomic_exchange_n(&buffers, NULL,
+                                                  __ATOMIC_ACQ_REL);
+    while (buffer != NULL) {
+        trace_buffer_t * next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+
+    // Threads still holding a buffer see the new generation and register
+    // afresh
+    __atomic_fetch_add(&generation, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&dropped, 0, __ATOMIC_RELAXED);
+}
+
+int rs_trace_write(int fd) {
+
+    // Cycles to microseconds, from the clock over the trace so far
+    uint64_t cycles = rs_stats_cycles() - startCycles;
+    uint64_t ns = monotonic_ns() - startNs;
+    double usPerCycle = cycles > 0 ? (double) ns / (double) cycles / 1e3
+                                   : 1e-3;
+
+    char * chunk = malloc(WRITE_CHUNK);
+    if (chunk == NULL) {
+        return RS_ERR_NO_MEMORY;
+    }
+    size_t used = 0;
+    int pid = (int) getpid();
+
+    int err = emit(fd, chunk, &used, "{\"displayTimeUnit\":\"ns\","
+                                     "\"traceEvents\":[\n");
+    const char * sep = "";
+
+    trace_buffer_t * buffer = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE);
+    for (; buffer != NULL && !err; buffer = buffer->next) {
+        err = emit(fd, chunk, &used,
+                   "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                   "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                   sep, pid, buffer->tid, buffer->tid);
+        sep = ",\n";
+
+        size_t count = __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+        for (size_t i = 0; i < count && !err; i++) {
+            const trace_event_t * event = &buffer->events[i];
+            double ts = (double) (event->start - startCycles) * usPerCycle;
+            double dur = (double) (event->end - event->start) * usPerCycle;
+            err = emit(fd, chunk, &used,
+                       ",\n{\"name\":\"%s\",\"cat\":\"rs\",\"ph\":\"X\","
+                       "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+                       "\"args\":{\"batch\":%llu}}",
+                       event->name, ts, dur, pid, buffer->tid,
+                       (unsigned long long) event->arg);
+        }
+    }
+
+    if (!err) {
+        err = emit(fd, chunk, &used, "\n]}\n");
+    }
+    if (!err && used > 0) {
+        err = rs_file_write_all(fd, (const uint8_t *) chunk, used);
+    }
+    free(chunk);
+
+    return err;
+}
+
+int rs_trace_write_file(const char * path) {
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return RS_ERR_IO;
+    }
+    int err = rs_trace_write(fd);
+    if (close(fd) != 0 && !err) {
+        err = RS_ERR_IO;
+    }
+    return err;
+}
+
+static trace_buffer_t * thread_buffer(void) {
+
+    unsigned current = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+    // A buffer of an earlier trace has been freed, so only look at it if
+    // the generation matches
+    if (threadBuffer != NULL && threadGeneration == current) {
+        return threadBuffer;
+    }
+
+    trace_buffer_t * buffer = malloc(sizeof(trace_buffer_t) +
+                                     capacity * sizeof(trace_event_t));
+    if (buffer == NULL) {
+        return NULL;
+    }
+    buffer->tid = (int) syscall(SYS_gettid);
+    buffer->capacity = capacity;
+    buffer->count = 0;
+
+    buffer->next = __atomic_load_n(&buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&buffers, &buffer->next, buffer, 1,
+                                        __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) {
+    }
+
+    threadBuffer = buffer;
+    threadGeneration = current;
+    return buffer;
+}
+
+static uint64_t monotonic_ns(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int emit(int fd, char * chunk, size_t * used, const char * format,
+                ...) {
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(chunk + *used, WRITE_CHUNK - *used, format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return RS_ERR_IO;
+    }
+    if ((size_t) length >= WRITE_CHUNK - *used) {
+        // Flush and try again into the empty chunk
+        int err = rs_file_write_all(fd, (const uint8_t *) chunk, *used);
+        *used = 0;
+        if (err) {
+            return err;
+        }
+        va_start(args, format);
+        length = vsnprintf(chunk, WRITE_CHUNK, format, args);
+        va_end(args);
+        if (length < 0 || length >= WRITE_CHUNK) {
+            return RS_ERR_IO;
+        }
+    }
+    *used += (size_t) length;
+
+    return 0;
+}
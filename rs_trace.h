@@ -0,0 +1,84 @@
+//
+// Lightweight tracing of the coding pipelines as Chrome trace-event JSON,
+// which can be loaded into Perfetto (ui.perfetto.dev) or chrome://tracing.
+//
+// Each thread records into its own buffer, so recording takes no locks and
+// costs two timestamp counter reads and a store per stage; a thread's
+// buffer is registered on its first event with a single atomic push.
+// Events beyond a buffer's capacity are counted and dropped.
+//
+// Stages are recorded as complete ("X") events, e.g.
+//
+//   uint64_t start = rs_trace_begin();
+//   ... encode a batch ...
+//   rs_trace_end("encode", start, batch);
+//
+// Tracing is off until rs_trace_start() and then costs only a flag test.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_TRACE_H
+#define RS_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rs_stats.h"
+
+// Default events per thread buffer.
+#define RS_TRACE_DEFAULT_EVENTS     (1 << 16)
+
+// Non-zero while tracing. Read with rs_trace_begin().
+extern int rs_traceEnabled;
+
+// Start a stage, returning its start timestamp (0 if not tracing).
+static inline uint64_t rs_trace_begin(void) {
+
+    if (__builtin_expect(__atomic_load_n(&rs_traceEnabled,
+                                         __ATOMIC_RELAXED) == 0, 1)) {
+        return 0;
+    }
+    return rs_stats_cycles();
+}
+
+// Record a stage which started at start.
+//
+// @param   name: the stage name, a string which must outlive the trace.
+// @param   start: from rs_trace_begin(); nothing is recorded if 0.
+// @param   arg: recorded as the event's "batch" argument.
+void rs_trace_end(const char * name, uint64_t start, uint64_t arg);
+
+// Start tracing, discarding any previous trace.
+//
+// @param   eventsPerThread: buffer capacity of each thread, 0 for the
+//                           default.
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_trace_start(size_t eventsPerThread);
+
+// Stop tracing. The events recorded so far are kept for writing.
+void rs_trace_stop(void);
+
+// Write the trace as JSON. Tracing should be stopped first.
+//
+// @return  0 on success, otherwise a negative RS_ERR_ code.
+int rs_trace_write(int fd);
+
+// Write the trace to a file.
+int rs_trace_write_file(const char * path);
+
+// Number of events dropped because a thread's buffer was full.
+uint64_t rs_trace_dropped(void);
+
+// Free all of the buffers. No thread may be recording.
+void rs_trace_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RS_TRACE_H
@@ -0,0 +1,444 @@
+//
+// rsdec: repair and restore a file protected by rsenc.
+//
+// usage: rsdec [-j threads] [-v] input output
+//        rsdec -c [-j threads] [-v] [-r offset:length] input output
+//        rsdec -s [-j threads] [-v] [-q depth] [-d] [-P] prefix output
+//        rsdec -S [-v] [-b rate] [-n nice] [-C cursor] container
+//
+// Any mode also takes -M metrics to write the codec statistics to the given
+// file in OpenMetrics text format, at the end of the run and, while
+// scrubbing, every few seconds. The decoding modes take -T trace to write
+// the time spent in each stage of each batch as Chrome trace-event JSON.
+//
+// With -c the input is an indexed container written by rsenc -c, and -r
+// extracts just the given byte range, decoding only the codewords holding
+// it.
+// With -s the file is reassembled from the shard files prefix.NNN written
+// by rsenc -s; any missing or damaged shards are treated as erasures.
+// With -S the container is scrubbed in place: damaged blocks are repaired
+// in the file, at most rate bytes per second (with a K, M or G suffix) are
+// read, and with -C the position is saved so an interrupted scrub resumes.
+//
+// A summary of the corrections made is printed to stderr. The exit status
+// is 0 if every codeword was decoded, 3 if some codewords could not be
+// corrected (their data is written out as received) and 1 on other errors.
+//
+// @author Jarrod Bennett
+//
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rs_codec.h"
+#include "rs_container.h"
+#include "rs_file.h"
+#include "rs_metrics.h"
+#include "rs_scrub.h"
+#include "rs_shard.h"
+#include "rs_trace.h"
+
+static void usage(void) {
+
+    fprintf(stderr,
+            "usage: rsdec [-j threads] [-v] input output\n"
+            "       rsdec -c [-j threads] [-v] [-r offset:length] "
+            "input output\n"
+            "       rsdec -s [-j threads] [-v] [-q depth] [-d] [-P] "
+            "prefix output\n"
+            "       rsdec -S [-v] [-b rate] [-n nice] [-C cursor] container\n"
+            "  -j  worker threads (default one per CPU)\n"
+            "  -v  report every corrected codeword\n"
+            "  -c  decode an indexed container\n"
+            "  -r  extract only a byte range of a container\n"
+            "  -s  reassemble from shard files prefix.NNN\n"
+            "  -q  shard I/O queue depth (default %d)\n"
+            "  -d  open shard files with O_DIRECT where supported\n"
+            "  -P  use pread/pwrite rather than io_uring\n"
+            "  -S  scrub a container in place\n"
+            "  -b  scrub rate limit in bytes/s, K, M or G suffix allowed\n"
+            "  -n  scrub nice increment (default 10)\n"
+            "  -C  scrub resume cursor file\n"
+            "  -M  write codec statistics as OpenMetrics text to a file\n"
+            "  -T  write a Chrome trace-event JSON trace to a file\n"
+            "  output may be - for stdout\n", RS_IO_DEFAULT_DEPTH);
+}
+
+// Open whichever of the shard files prefix.000 onwards exist.
+static int open_shards(const char * prefix, int direct, int * fds) {
+
+    char path[4096];
+    int found = 0;
+
+    for (int j = 0; j < RS_SHARD_MAX; j++) {
+        snprintf(path, sizeof(path), "%s.%03d", prefix, j);
+
+        fds[j] = direct ? open(path, O_RDONLY | O_DIRECT) : -1;
+        if (fds[j] < 0) {
+            fds[j] = open(path, O_RDONLY);
+        }
+        found += fds[j] >= 0;
+    }
+
+    return found;
+}
+
+// Decode a byte range of a container to outFd.
+static int extract_range(int inFd, int outFd, uint64_t offset,
+                         uint64_t length, rs_codec_stats_t * codecStats,
+                         rs_file_stats_t * stats) {
+
+    memset(stats, 0, sizeof(*stats));
+
+    rs_container_t container;
+    int err = rs_container_open(&container, inFd);
+    if (err) {
+        return err;
+    }
+
+    // Checked before the buffer is sized from it
+    if (offset > container.length || length > container.length - offset) {
+        fprintf(stderr, "invalid range: %llu bytes at %llu, the data has "
+                        "%llu\n", (unsigned long long) length,
+                (unsigned long long) offset,
+                (unsigned long long) container.length);
+        rs_container_close(&container);
+        return RS_ERR_INVALID_ARGS;
+    }
+    if (!container.indexed) {
+        fprintf(stderr, "warning: container index damaged, decoding blocks "
+                        "without CRC checks\n");
+    }
+    rs_codec_set_stats(&container.codec, codecStats);
+
+    uint8_t * buffer = malloc(length > 0 ? (size_t) length : 1);
+    if (buffer == NULL) {
+        rs_container_close(&container);
+        return RS_ERR_NO_MEMORY;
+    }
+
+    err = rs_container_read(&container, offset, buffer, (size_t) length,
+                            stats);
+    if (err == 0 || err == RS_ERR_UNCORRECTABLE) {
+        int writeErr = rs_file_write_all(outFd, buffer, (size_t) length);
+        if (writeErr) {
+            err = writeErr;
+        }
+    }
+
+    free(buffer);
+    rs_container_close(&container);
+
+    return err;
+}
+
+// Parse a byte rate with an optional K, M or G suffix.
+static int parse_rate(const char * text, uint64_t * rate) {
+
+    char * end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) {
+        return -1;
+    }
+    switch (*end) {
+        case 'G':
+            value <<= 10;
+            // fall through
+        case 'M':
+            value <<= 10;
+            // fall through
+        case 'K':
+            value <<= 10;
+            end++;
+            break;
+        default:
+            break;
+    }
+    if (*end != '\0') {
+        return -1;
+    }
+    *rate = value;
+    return 0;
+}
+
+// The scrubber interrupted by SIGINT or SIGTERM.
+static rs_scrub_t * activeScrub;
+
+static void stop_scrub(int sig) {
+
+    (void) sig;
+    rs_scrub_stop(activeScrub);
+}
+
+// Seconds between metrics updates while scrubbing.
+#define METRICS_INTERVAL        (10)
+
+static int scrub_container(const char * path,
+                           const rs_scrub_options_t * options,
+                           const char * metricsPath) {
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+
+    rs_scrub_t scrub;
+    int err = rs_scrub_open(&scrub, fd, options);
+    if (err) {
+        fprintf(stderr, "Error opening %s, code = %d\n", path, err);
+        close(fd);
+        return 1;
+    }
+    if (!scrub.container.indexed) {
+        fprintf(stderr, "warning: %s: index damaged, repairing blocks "
+                        "without CRC checks\n", path);
+    }
+
+    activeScrub = &scrub;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_scrub;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (metricsPath == NULL) {
+        err = rs_scrub_run(&scrub);
+    } else {
+        // Scrub in the background and refresh the metrics as it goes
+        err = rs_scrub_start(&scrub);
+        for (int tick = 1; err == 0 && !rs_scrub_finished(&scrub); tick++) {
+            sleep(1);
+            if (tick % METRICS_INTERVAL == 0) {
+                rs_metrics_write_file(options->codecStats, NULL,
+                                      metricsPath);
+            }
+        }
+        if (err == 0) {
+            err = rs_scrub_wait(&scrub);
+        }
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    rs_scrub_stats_t stats;
+    rs_scrub_get_stats(&scrub, &stats);
+    rs_scrub_close(&scrub);
+    close(fd);
+
+    if (err && err != RS_ERR_UNCORRECTABLE) {
+        fprintf(stderr, "Error scrubbing %s, code = %d\n", path, err);
+        return 1;
+    }
+
+    fprintf(stderr, "%llu blocks (%llu codewords) checked, %llu repaired "
+                    "(%llu codewords, %llu symbols), %llu uncorrectable\n",
+            (unsigned long long) stats.blocks,
+            (unsigned long long) stats.codewords,
+            (unsigned long long) stats.repairedBlocks,
+            (unsigned long long) stats.corrected,
+            (unsigned long long) stats.symbols,
+            (unsigned long long) stats.failedBlocks);
+
+    return err ? 3 : 0;
+}
+
+int main(int argc, char ** argv) {
+
+    rs_file_options_t options;
+    rs_file_options_default(&options);
+
+    int shards = 0;
+    int direct = 0;
+    int container = 0;
+    int range = 0;
+    unsigned long long rangeOffset = 0;
+    unsigned long long rangeLength = 0;
+
+    int scrub = 0;
+    rs_scrub_options_t scrubOptions;
+    rs_scrub_options_default(&scrubOptions);
+
+    const char * metricsPath = NULL;
+    const char * tracePath = NULL;
+    rs_codec_stats_t codecStats;
+    rs_stats_reset(&codecStats);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:vcr:sq:dPSb:n:C:M:T:h")) != -1) {
+        switch (opt) {
+            case 'j':
+                options.threads = atoi(optarg);
+                break;
+            case 'v':
+                options.verbose = 1;
+                scrubOptions.verbose = 1;
+                break;
+            case 'c':
+                container = 1;
+                break;
+            case 'r':
+                if (sscanf(optarg, "%llu:%llu", &rangeOffset,
+                           &rangeLength) != 2) {
+                    usage();
+                    return 2;
+                }
+                range = 1;
+                break;
+            case 's':
+                shards = 1;
+                break;
+            case 'q':
+                options.depth = atoi(optarg);
+                break;
+            case 'd':
+                direct = 1;
+                break;
+            case 'P':
+                options.ioFlags |= RS_IO_SYNC;
+                break;
+            case 'S':
+                scrub = 1;
+                break;
+            case 'b':
+                if (parse_rate(optarg, &scrubOptions.bytesPerSecond)) {
+                    usage();
+                    return 2;
+                }
+                break;
+            case 'n':
+                scrubOptions.nice = atoi(optarg);
+                break;
+            case 'C':
+                scrubOptions.cursorPath = optarg;
+                break;
+            case 'M':
+                metricsPath = optarg;
+                options.codecStats = &codecStats;
+                scrubOptions.codecStats = &codecStats;
+                break;
+            case 'T':
+                tracePath = optarg;
+                break;
+            default:
+                usage();
+                return 2;
+        }
+    }
+    if (scrub) {
+        if (argc - optind != 1 || shards || container || range) {
+            usage();
+            return 2;
+        }
+        int status = scrub_container(argv[optind], &scrubOptions,
+                                     metricsPath);
+        if (metricsPath != NULL &&
+            rs_metrics_write_file(&codecStats, NULL, metricsPath) != 0) {
+            perror(metricsPath);
+            status = 1;
+        }
+        return status;
+    }
+    if (argc - optind != 2 || (shards && container) ||
+        (range && !container)) {
+        usage();
+        return 2;
+    }
+
+    const char * inPath = argv[optind];
+    const char * outPath = argv[optind + 1];
+
+    int inFd = -1;
+    int fds[RS_SHARD_MAX];
+    if (shards) {
+        if (open_shards(inPath, direct, fds) == 0) {
+            fprintf(stderr, "%s: no shard files found\n", inPath);
+            return 1;
+        }
+    } else {
+        inFd = open(inPath, O_RDONLY);
+        if (inFd < 0) {
+            perror(inPath);
+            return 1;
+        }
+    }
+
+    int outFd = STDOUT_FILENO;
+    if (strcmp(outPath, "-") != 0) {
+        outFd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (outFd < 0) {
+            perror(outPath);
+            return 1;
+        }
+    }
+
+    if (tracePath != NULL) {
+        rs_trace_start(0);
+    }
+
+    rs_file_stats_t stats;
+    int err;
+    if (shards) {
+        err = rs_shard_decode(fds, RS_SHARD_MAX, outFd, &options, &stats);
+        for (int j = 0; j < RS_SHARD_MAX; j++) {
+            if (fds[j] >= 0) {
+                close(fds[j]);
+            }
+        }
+    } else if (range) {
+        err = extract_range(inFd, outFd, rangeOffset, rangeLength,
+                            options.codecStats, &stats);
+        close(inFd);
+    } else if (container) {
+        err = rs_container_decode(inFd, outFd, &options, &stats);
+        close(inFd);
+    } else {
+        err = rs_file_decode(inFd, outFd, &options, &stats);
+        close(inFd);
+    }
+
+    if (outFd != STDOUT_FILENO && close(outFd) != 0 && !err) {
+        perror(outPath);
+        err = RS_ERR_IO;
+    }
+
+    if (metricsPath != NULL &&
+        rs_metrics_write_file(&codecStats, NULL, metricsPath) != 0) {
+        perror(metricsPath);
+        if (!err) {
+            err = RS_ERR_IO;
+        }
+    }
+
+    if (tracePath != NULL) {
+        rs_trace_stop();
+        if (rs_trace_write_file(tracePath) != 0) {
+            perror(tracePath);
+            if (!err) {
+                err = RS_ERR_IO;
+            }
+        }
+        rs_trace_free();
+    }
+
+    if (err && err != RS_ERR_UNCORRECTABLE) {
+        fprintf(stderr, "Error decoding %s, code = %d\n", inPath, err);
+        return 1;
+    }
+
+    fprintf(stderr, "%llu codewords, %llu corrected (%llu symbols), "
+                    "%llu uncorrectable\n",
+            (unsigned long long) stats.codewords,
+            (unsigned long long) stats.corrected,
+            (unsigned long long) stats.symbols,
+            (unsigned long long) stats.failed);
+
+    return err ? 3 : 0;
+}
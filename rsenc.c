@@ -0,0 +1,285 @@
+//
+// rsenc: FEC protect a file with a Reed-Solomon code.
+//
+// usage: rsenc [-k data] [-p parity] [-j threads] [-M metrics] input output
+//        rsenc -c [-k data] [-p parity] [-j threads] [-i depth] input output
+//        rsenc -s [-k data] [-p parity] [-j threads] [-q depth] [-d] [-P]
+//              input prefix
+//
+// The output can be repaired and restored with rsdec. With -c the output is
+// an indexed container (see rs_container.h) which supports random access.
+// With -s the input is instead erasure coded across k + p shard files named
+// prefix.000, prefix.001 and so on, written through io_uring where
+// available.
+//
+// Any mode takes -g, -f and -r to use another field polynomial, first root
+// or root step than the MATLAB rsenc() defaults, e.g. -g 0x187 -f 112 -r 11
+// for the CCSDS code. They are recorded in the output, so rsdec needs no options.
+//
+// With -M the codec statistics are written to the given file in OpenMetrics
+// text format when encoding finishes, e.g. for a textfile collector. With -T
+// the time spent in each stage of each batch is written to the given file
+// as Chrome trace-event JSON, for viewing in Perfetto.
+//
+// @author Jarrod Bennett
+//
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rs_container.h"
+#include "rs_file.h"
+#include "rs_metrics.h"
+#include "rs_shard.h"
+#include "rs_trace.h"
+
+static void usage(void) {
+
+    fprintf(stderr,
+            "usage: rsenc [-k data] [-p parity] [-j threads] [-M metrics] "
+            "input output\n"
+            "       rsenc -c [-k data] [-p parity] [-j threads] [-i depth] "
+            "input output\n"
+            "       rsenc -s [-k data] [-p parity] [-j threads] [-q depth] "
+            "[-d] [-P] input prefix\n"
+            "  -k  data symbols per codeword (default %d)\n"
+            "  -p  parity symbols per codeword (default %d)\n"
+            "  -g  primitive polynomial of the field, e.g. 0x187 "
+            "(default %#x)\n"
+            "  -f  first consecutive root of the generator (default %d)\n"
+            "  -r  root step of the generator (default %d)\n"
+            "  -j  worker threads (default one per CPU)\n"
+            "  -c  write an indexed container\n"
+            "  -i  container interleave depth (default %d)\n"
+            "  -s  write k + p shard files prefix.NNN\n"
+            "  -q  shard I/O queue depth (default %d)\n"
+            "  -d  open shard files with O_DIRECT where supported\n"
+            "  -P  use pread/pwrite rather than io_uring\n"
+            "  -M  write codec statistics as OpenMetrics text to a file\n"
+            "  -T  write a Chrome trace-event JSON trace to a file\n"
+            "  output may be - for stdout\n",
+            RS_FILE_DEFAULT_K, RS_FILE_DEFAULT_PARITY,
+            rs_field_default_poly(8), RS_CODEC_DEFAULT_FCR,
+            RS_CODEC_DEFAULT_PRIM, RS_CONTAINER_DEFAULT_DEPTH, RS_IO_DEFAULT_DEPTH);
+}
+
+// Create the shard files prefix.000 onwards. With direct set, O_DIRECT is
+// used unless the file system rejects it.
+static int open_shards(const char * prefix, int count, int direct,
+                       int * fds) {
+
+    char path[4096];
+    for (int j = 0; j < count; j++) {
+        snprintf(path, sizeof(path), "%s.%03d", prefix, j);
+
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+        fds[j] = direct ? open(path, flags | O_DIRECT, 0644) : -1;
+        if (fds[j] < 0) {
+            fds[j] = open(path, flags, 0644);
+        }
+        if (fds[j] < 0) {
+            perror(path);
+            while (j-- > 0) {
+                close(fds[j]);
+            }
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int encode_shards(const char * inPath, const char * prefix,
+                         int direct, const rs_file_options_t * options) {
+
+    int count = options->k + options->nparity;
+    if (options->k < 1 || options->nparity < 1 || count > RS_SHARD_MAX) {
+        fprintf(stderr, "k + p must be at most %d\n", RS_SHARD_MAX);
+        return 1;
+    }
+
+    int inFd = open(inPath, O_RDONLY);
+    if (inFd < 0) {
+        perror(inPath);
+        return 1;
+    }
+
+    int fds[RS_SHARD_MAX];
+    if (open_shards(prefix, count, direct, fds)) {
+        close(inFd);
+        return 1;
+    }
+
+    int err = rs_shard_encode(inFd, fds, options);
+    if (err) {
+        fprintf(stderr, "Error encoding %s, code = %d\n", inPath, err);
+    }
+
+    close(inFd);
+    for (int j = 0; j < count; j++) {
+        if (close(fds[j]) != 0 && !err) {
+            perror(prefix);
+            err = 1;
+        }
+    }
+
+    return err ? 1 : 0;
+}
+
+// Encode to a file or stdout.
+static int encode_file(const char * inPath, const char * outPath,
+                       int container, int interleave,
+                       const rs_file_options_t * options) {
+
+    int inFd = open(inPath, O_RDONLY);
+    if (inFd < 0) {
+        perror(inPath);
+        return 1;
+    }
+
+    int outFd = STDOUT_FILENO;
+    if (strcmp(outPath, "-") != 0) {
+        outFd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (outFd < 0) {
+            perror(outPath);
+            close(inFd);
+            return 1;
+        }
+    }
+
+    int err;
+    if (container) {
+        rs_container_params_t params;
+        rs_container_params_default(&params);
+        params.k = options->k;
+        params.nparity = options->nparity;
+        params.poly = options->poly;
+        params.fcr = options->fcr;
+        params.prim = options->prim;
+        params.depth = interleave;
+        params.codecStats = options->codecStats;
+        err = rs_container_write(inFd, outFd, &params, options->threads);
+    } else {
+        err = rs_file_encode(inFd, outFd, options);
+    }
+    if (err) {
+        fprintf(stderr, "Error encoding %s, code = %d\n", inPath, err);
+    }
+
+    close(inFd);
+    if (outFd != STDOUT_FILENO && close(outFd) != 0 && !err) {
+        perror(outPath);
+        err = 1;
+    }
+
+    return err ? 1 : 0;
+}
+
+int main(int argc, char ** argv) {
+
+    rs_file_options_t options;
+    rs_file_options_default(&options);
+
+    const char * metricsPath = NULL;
+    const char * tracePath = NULL;
+    rs_codec_stats_t codecStats;
+    rs_stats_reset(&codecStats);
+
+    int shards = 0;
+    int direct = 0;
+    int container = 0;
+    int interleave = RS_CONTAINER_DEFAULT_DEPTH;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:p:g:f:r:j:ci:sq:dPM:T:h")) != -1) {
+        switch (opt) {
+            case 'k':
+                options.k = atoi(optarg);
+                break;
+            case 'p':
+                options.nparity = atoi(optarg);
+                break;
+            case 'g':
+                options.poly = (int) strtol(optarg, NULL, 0);
+                break;
+            case 'f':
+                options.fcr = atoi(optarg);
+                break;
+            case 'r':
+                options.prim = atoi(optarg);
+                break;
+            case 'j':
+                options.threads = atoi(optarg);
+                break;
+            case 'c':
+                container = 1;
+                break;
+            case 'i':
+                interleave = atoi(optarg);
+                break;
+            case 's':
+                shards = 1;
+                break;
+            case 'q':
+                options.depth = atoi(optarg);
+                break;
+            case 'd':
+                direct = 1;
+                break;
+            case 'P':
+                options.ioFlags |= RS_IO_SYNC;
+                break;
+            case 'M':
+                metricsPath = optarg;
+                options.codecStats = &codecStats;
+                break;
+            case 'T':
+                tracePath = optarg;
+                break;
+            default:
+                usage();
+                return 2;
+        }
+    }
+    if (argc - optind != 2 || (shards && container)) {
+        usage();
+        return 2;
+    }
+
+    const char * inPath = argv[optind];
+    const char * outPath = argv[optind + 1];
+
+    if (tracePath != NULL) {
+        rs_trace_start(0);
+    }
+
+    int status;
+    if (shards) {
+        status = encode_shards(inPath, outPath, direct, &options);
+    } else {
+        status = encode_file(inPath, outPath, container, interleave,
+                             &options);
+    }
+
+    if (metricsPath != NULL &&
+        rs_metrics_write_file(&codecStats, NULL, metricsPath) != 0) {
+        perror(metricsPath);
+        status = 1;
+    }
+
+    if (tracePath != NULL) {
+        rs_trace_stop();
+        if (rs_trace_write_file(tracePath) != 0) {
+            perror(tracePath);
+            status = 1;
+        }
+        rs_trace_free();
+    }
+
+    return status;
+}
@@ -0,0 +1,66 @@
+#
+# Command line round trips: rsenc then rsdec of a file, plain, as a
+# container (whole and by range) and as shards with some deleted.
+#
+# Run by ctest as cmake -DRSENC=... -DRSDEC=... -DWORK=... -P cli.cmake.
+#
+# @author Jarrod Bennett
+#
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+string(RANDOM LENGTH 100000 data)
+file(WRITE ${WORK}/input "${data}")
+
+# Run a command, failing the test unless it succeeds.
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result
+                    ERROR_VARIABLE error)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${ARGN} failed (${result}): ${error}")
+    endif ()
+endfunction()
+
+# Fail the test unless two files are identical.
+function(same expected actual)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+                    ${expected} ${actual} RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${actual} differs from ${expected}")
+    endif ()
+endfunction()
+
+run(${RSENC} -k 200 -p 20 -j 2 ${WORK}/input ${WORK}/plain.rs)
+run(${RSDEC} -j 2 ${WORK}/plain.rs ${WORK}/plain.out)
+same(${WORK}/input ${WORK}/plain.out)
+
+run(${RSENC} -c -i 8 ${WORK}/input ${WORK}/container.rsc)
+run(${RSDEC} -c ${WORK}/container.rsc ${WORK}/container.out)
+same(${WORK}/input ${WORK}/container.out)
+
+string(SUBSTRING "${data}" 12345 40000 range)
+file(WRITE ${WORK}/range "${range}")
+run(${RSDEC} -c -r 12345:40000 ${WORK}/container.rsc ${WORK}/range.out)
+same(${WORK}/range ${WORK}/range.out)
+
+# A range past the end, or so long it wraps, is refused before any decoding
+foreach (bad 99000:2000 1:18446744073709551615)
+    execute_process(COMMAND ${RSDEC} -c -r ${bad} ${WORK}/container.rsc
+                    ${WORK}/range.out
+                    RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+    if (result EQUAL 0 OR NOT error MATCHES "invalid range")
+        message(FATAL_ERROR "rsdec -r ${bad} was not refused: ${error}")
+    endif ()
+endforeach ()
+
+run(${RSENC} -s -k 5 -p 3 -P ${WORK}/input ${WORK}/shard)
+file(REMOVE ${WORK}/shard.001 ${WORK}/shard.004 ${WORK}/shard.007)
+run(${RSDEC} -s -P ${WORK}/shard ${WORK}/shard.out)
+same(${WORK}/input ${WORK}/shard.out)
+
+file(REMOVE ${WORK}/shard.000)
+execute_process(COMMAND ${RSDEC} -s -P ${WORK}/shard ${WORK}/shard.out
+                RESULT_VARIABLE result OUTPUT_QUIET ERROR_QUIET)
+if (result EQUAL 0)
+    message(FATAL_ERROR "rsdec -s succeeded with four of eight shards gone")
+endif ()
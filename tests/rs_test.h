@@ -0,0 +1,92 @@
+//
+// Minimal helpers shared by the tests: a check macro which counts failures
+// rather than stopping at the first, and a seeded random number generator
+// so that every run sees the same cases.
+//
+// Each test is its own executable whose exit status is the ctest result.
+//
+// @author Jarrod Bennett
+//
+
+#ifndef RS_TEST_H
+#define RS_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rs_codec.h"
+
+static int testFailures;
+
+#define CHECK(cond) \
+        do { \
+            if (!(cond)) { \
+                fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, \
+                        __LINE__, #cond); \
+                testFailures++; \
+            } \
+        } while (0)
+
+// Report and return the exit status of a test.
+static inline int test_result(const char * name) {
+
+    if (testFailures > 0) {
+        fprintf(stderr, "%s: %d checks failed\n", name, testFailures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+// xorshift64*, never seeded with zero.
+static inline uint64_t test_random(uint64_t * state) {
+
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+// Uniform in 0..bound-1.
+static inline int test_below(uint64_t * state, int bound) {
+
+    return (int) ((test_random(state) >> 32) % (uint64_t) bound);
+}
+
+// Fill a buffer with random symbols of up to mask.
+static inline void test_fill(uint64_t * state, uint8_t * buffer, int length,
+                             int mask) {
+
+    for (int i = 0; i < length; i++) {
+        buffer[i] = (uint8_t) (test_random(state) & (uint64_t) mask);
+    }
+}
+
+// Pick count distinct indices of 0..n-1, in a random order.
+static inline void test_positions(uint64_t * state, int n, int * positions,
+                                  int count) {
+
+    int all[RS_FIELD_MAX_SIZE];
+    for (int i = 0; i < n; i++) {
+        all[i] = i;
+    }
+    for (int i = 0; i < count; i++) {
+        int j = i + test_below(state, n - i);
+        int t = all[i];
+        all[i] = all[j];
+        all[j] = t;
+        positions[i] = all[i];
+    }
+}
+
+// Whether n symbols are a codeword, i.e. have all-zero syndromes.
+static inline int test_is_codeword(const rs_codec_t * codec,
+                                   const uint8_t * codeword, int n) {
+
+    return rs_codec_syndromes(codec, codeword, n, NULL) == 0;
+}
+
+#endif //RS_TEST_H
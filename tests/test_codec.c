@@ -0,0 +1,391 @@
+//
+// Hard decision codec tests: the MATLAB rsenc() vector, errors and erasures
+// within the code's capability for every kernel, words beyond it, which
+// must be rejected or decoded to a codeword, never "corrected" to a word
+// that is not one, scatter-gather coding, frame layouts and segmentation.
+//
+// @author Jarrod Bennett
+//
+
+#include <stdlib.h>
+
+#include "rs_test.h"
+#include "rs_segment.h"
+
+// Codes tried: m, nparity, fcr, prim. Odd and even parity counts, and
+// CCSDS's roots.
+static const int codes[][4] = {
+    {4, 4, 1, 1},
+    {4, 5, 1, 1},
+    {5, 6, 1, 1},
+    {6, 7, 1, 1},
+    {8, 16, 1, 1},
+    {8, 32, 112, 11},
+};
+
+#define CODES                   ((int) (sizeof(codes) / sizeof(codes[0])))
+
+// The example of main.c, checked against MATLAB rsenc().
+static void test_matlab(void) {
+
+    static const uint8_t msg[10] = {0x2, 0x5, 0x6, 0x6, 0x0, 0xb, 0xf, 0xc,
+                                    0x1, 0xb};
+    static const uint8_t expected[4] = {0x6, 0x6, 0x8, 0x4};
+
+    rs_codec_t codec;
+    CHECK(rs_codec_init(&codec, 4, 4) == 0);
+    for (int kernel = 0; kernel < RS_KERNEL_COUNT; kernel++) {
+        if (!rs_codec_kernel_supported(&codec, kernel)) {
+            continue;
+        }
+        CHECK(rs_codec_set_kernel(&codec, kernel) == 0);
+        uint8_t parity[4];
+        CHECK(rs_codec_encode(&codec, msg, 10, parity) == 0);
+        CHECK(memcmp(parity, expected, sizeof(expected)) == 0);
+    }
+    rs_codec_free(&codec);
+}
+
+// Every kernel agrees with the scalar one, singly and in batches, and
+// decodes every mix of errors and erasures with 2 * errors + erasures
+// <= nparity.
+static void test_within(uint64_t * rng) {
+
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init_generator(&codec, codes[c][0], codes[c][1], 0,
+                                      codes[c][2], codes[c][3]) == 0);
+        int np = codec.nparity;
+
+        for (int kernel = 0; kernel < RS_KERNEL_COUNT; kernel++) {
+            if (!rs_codec_kernel_supported(&codec, kernel)) {
+                continue;
+            }
+            for (int trial = 0; trial < 400; trial++) {
+                int n = np + 1 + test_below(rng, codec.nn - np);
+                int k = n - np;
+                uint8_t sent[RS_FIELD_MAX_SIZE];
+                uint8_t received[RS_FIELD_MAX_SIZE];
+                uint8_t parity[RS_CODEC_MAX_PARITY];
+                test_fill(rng, sent, k, codec.nn);
+
+                CHECK(rs_codec_set_kernel(&codec, RS_KERNEL_SCALAR) == 0);
+                CHECK(rs_codec_encode(&codec, sent, k, &sent[k]) == 0);
+                CHECK(rs_codec_set_kernel(&codec, kernel) == 0);
+                CHECK(rs_codec_encode(&codec, sent, k, parity) == 0);
+                CHECK(memcmp(parity, &sent[k], (size_t) np) == 0);
+
+                int nerasures = test_below(rng, np + 1);
+                int nerrors = (np - nerasures) / 2;
+                int positions[RS_FIELD_MAX_SIZE];
+                test_positions(rng, n, positions, nerasures + nerrors);
+
+                memcpy(received, sent, (size_t) n);
+                for (int i = 0; i < nerasures + nerrors; i++) {
+                    // Erased symbols may or may not be wrong, errors are
+                    uint8_t flip = (uint8_t) test_random(rng) & codec.nn;
+                    if (i >= nerasures && flip == 0) {
+                        flip = 1;
+                    }
+                    received[positions[i]] ^= flip;
+                }
+
+                int result = rs_codec_decode(&codec, received, n, positions,
+                                             nerasures, NULL);
+                CHECK(result >= nerrors && result <= nerasures + nerrors);
+                CHECK(memcmp(received, sent, (size_t) n) == 0);
+            }
+
+            // Batches of contiguous codewords match single encodes
+            enum { COUNT = 9 };
+            uint8_t batch[COUNT * RS_FIELD_MAX_SIZE];
+            int k = codec.nn - np < 20 ? codec.nn - np : 20;
+            int stride = k + np;
+            test_fill(rng, batch, COUNT * stride, codec.nn);
+            CHECK(rs_codec_encode_batch(&codec, batch, k, (size_t) stride,
+                                        &batch[k], (size_t) stride,
+                                        COUNT) == 0);
+            for (int i = 0; i < COUNT; i++) {
+                CHECK(test_is_codeword(&codec, &batch[i * stride], stride));
+            }
+        }
+        rs_codec_free(&codec);
+    }
+}
+
+// Words with more errors than the code can correct come back as
+// RS_ERR_UNCORRECTABLE, untouched, or as a codeword (a miscorrection,
+// which no decoder can avoid), but never as anything else.
+static void test_beyond(uint64_t * rng) {
+
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init_generator(&codec, codes[c][0], codes[c][1], 0,
+                                      codes[c][2], codes[c][3]) == 0);
+        int np = codec.nparity;
+        int rejected = 0;
+
+        for (int trial = 0; trial < 4000; trial++) {
+            int n = np + 1 + test_below(rng, codec.nn - np);
+            int k = n - np;
+            uint8_t sent[RS_FIELD_MAX_SIZE];
+            uint8_t received[RS_FIELD_MAX_SIZE];
+            test_fill(rng, sent, k, codec.nn);
+            CHECK(rs_codec_encode(&codec, sent, k, &sent[k]) == 0);
+
+            // t + 1 or more errors, with some erasures
+            int nerasures = test_below(rng, np);
+            int nerrors = (np - nerasures) / 2 + 1 + test_below(rng, 2);
+            if (nerasures + nerrors > n) {
+                continue;
+            }
+            int positions[RS_FIELD_MAX_SIZE];
+            test_positions(rng, n, positions, nerasures + nerrors);
+            memcpy(received, sent, (size_t) n);
+            for (int i = 0; i < nerasures + nerrors; i++) {
+                received[positions[i]] ^= (uint8_t) (1 + test_below(rng,
+                                                                 codec.nn));
+            }
+            uint8_t before[RS_FIELD_MAX_SIZE];
+            memcpy(before, received, (size_t) n);
+
+            int result = rs_codec_decode(&codec, received, n, positions,
+                                         nerasures, NULL);
+            if (result == RS_ERR_UNCORRECTABLE) {
+                CHECK(memcmp(received, before, (size_t) n) == 0);
+                rejected++;
+            } else {
+                CHECK(result >= 0);
+                CHECK(test_is_codeword(&codec, received, n));
+            }
+        }
+        CHECK(rejected > 0);
+        rs_codec_free(&codec);
+    }
+}
+
+// Cut length symbols at base into up to max segments at random places,
+// some of them empty.
+//
+// @return  the number of segments.
+static int split(uint64_t * rng, uint8_t * base, int length,
+                 struct iovec * iov, int max) {
+
+    int count = 1 + test_below(rng, max);
+    int at = 0;
+    for (int i = 0; i < count; i++) {
+        int size = i + 1 == count ? length - at :
+                   test_below(rng, length - at + 1);
+        iov[i].iov_base = &base[at];
+        iov[i].iov_len = (size_t) size;
+        at += size;
+    }
+    return count;
+}
+
+// Scatter-gather encoding and decoding match the contiguous functions
+// however the message, parity and codeword are split.
+static void test_iovec(uint64_t * rng) {
+
+    enum { SEGMENTS = 6 };
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init_generator(&codec, codes[c][0], codes[c][1], 0,
+                                      codes[c][2], codes[c][3]) == 0);
+        int np = codec.nparity;
+
+        for (int trial = 0; trial < 500; trial++) {
+            int n = np + 1 + test_below(rng, codec.nn - np);
+            int k = n - np;
+            uint8_t sent[RS_FIELD_MAX_SIZE];
+            uint8_t word[RS_FIELD_MAX_SIZE];
+            test_fill(rng, sent, k, codec.nn);
+            CHECK(rs_codec_encode(&codec, sent, k, &sent[k]) == 0);
+
+            struct iovec msg[SEGMENTS];
+            struct iovec parity[SEGMENTS];
+            memcpy(word, sent, (size_t) k);
+            memset(&word[k], 0, (size_t) np);
+            int msgCount = split(rng, word, k, msg, SEGMENTS);
+            int parityCount = split(rng, &word[k], np, parity, SEGMENTS);
+            CHECK(rs_codec_encodev(&codec, msg, msgCount, parity,
+                                   parityCount) == 0);
+            CHECK(memcmp(word, sent, (size_t) n) == 0);
+
+            int nerasures = test_below(rng, np + 1);
+            int nerrors = (np - nerasures) / 2;
+            int positions[RS_FIELD_MAX_SIZE];
+            test_positions(rng, n, positions, nerasures + nerrors);
+            for (int i = 0; i < nerasures + nerrors; i++) {
+                word[positions[i]] ^= (uint8_t) (1 + test_below(rng,
+                                                                codec.nn));
+            }
+            struct iovec codeword[SEGMENTS];
+            int count = split(rng, word, n, codeword, SEGMENTS);
+            CHECK(rs_codec_decodev(&codec, codeword, count, positions,
+                                   nerasures, NULL) == nerasures + nerrors);
+            CHECK(memcmp(word, sent, (size_t) n) == 0);
+        }
+
+        // The parity segments must total nparity
+        uint8_t word[RS_FIELD_MAX_SIZE] = {0};
+        struct iovec msg = {word, 1};
+        struct iovec parity = {&word[1], (size_t) np - 1};
+        CHECK(rs_codec_encodev(&codec, &msg, 1, &parity, 1) ==
+              RS_ERR_INVALID_ARGS);
+        rs_codec_free(&codec);
+    }
+}
+
+// Gather a frame's codeword, message then parity, as the layout lays it
+// out (see rs_codec_set_layout()).
+static void frame_codeword(const rs_codec_t * codec, const uint8_t * frame,
+                           int n, uint8_t * codeword) {
+
+    int np = codec->nparity;
+    int k = n - np;
+    switch (codec->layout) {
+        case RS_LAYOUT_PREFIX:
+            memcpy(codeword, &frame[np], (size_t) k);
+            memcpy(&codeword[k], frame, (size_t) np);
+            break;
+        case RS_LAYOUT_SPLIT: {
+            int header = codec->layoutHeader;
+            int lead = codec->layoutLead;
+            memcpy(&codeword[k], frame, (size_t) lead);
+            memcpy(codeword, &frame[lead], (size_t) header);
+            memcpy(&codeword[k + lead], &frame[lead + header],
+                   (size_t) (np - lead));
+            memcpy(&codeword[header], &frame[np + header],
+                   (size_t) (k - header));
+            break;
+        }
+        default:
+            memcpy(codeword, frame, (size_t) n);
+            break;
+    }
+}
+
+// Frames of each layout hold a codeword with its symbols where the layout
+// puts them, and decode in place with errors and erasures indexed by
+// frame position.
+static void test_layout(uint64_t * rng) {
+
+    rs_codec_t codec;
+    CHECK(rs_codec_init(&codec, 8, 16) == 0);
+    int np = codec.nparity;
+    CHECK(rs_codec_set_layout(&codec, RS_LAYOUT_SPLIT, 4, np + 1) ==
+          RS_ERR_INVALID_ARGS);
+
+    for (int trial = 0; trial < 1000; trial++) {
+        int layout = test_below(rng, 3);
+        int header = test_below(rng, 20);
+        int lead = test_below(rng, np + 1);
+        CHECK(rs_codec_set_layout(&codec, layout, header, lead) == 0);
+
+        int n = np + header + 1 + test_below(rng, codec.nn - np - header);
+        int k = n - np;
+        uint8_t frame[RS_FIELD_MAX_SIZE];
+        uint8_t sent[RS_FIELD_MAX_SIZE];
+        uint8_t codeword[RS_FIELD_MAX_SIZE];
+        test_fill(rng, frame, n, codec.nn);
+        frame_codeword(&codec, frame, n, sent);
+        CHECK(rs_codec_encode_frame(&codec, frame, n) == 0);
+
+        // The message is left where it was and the parity is the code's
+        frame_codeword(&codec, frame, n, codeword);
+        CHECK(memcmp(codeword, sent, (size_t) k) == 0);
+        CHECK(rs_codec_encode(&codec, sent, k, &sent[k]) == 0);
+        CHECK(memcmp(codeword, sent, (size_t) n) == 0);
+
+        uint8_t encoded[RS_FIELD_MAX_SIZE];
+        memcpy(encoded, frame, (size_t) n);
+        int nerasures = test_below(rng, np + 1);
+        int nerrors = (np - nerasures) / 2;
+        int positions[RS_FIELD_MAX_SIZE];
+        test_positions(rng, n, positions, nerasures + nerrors);
+        for (int i = 0; i < nerasures + nerrors; i++) {
+            frame[positions[i]] ^= (uint8_t) (1 + test_below(rng, codec.nn));
+        }
+        int corrected[RS_CODEC_MAX_PARITY];
+        CHECK(rs_codec_decode_frame(&codec, frame, n, positions, nerasures,
+                                    corrected) == nerasures + nerrors);
+        CHECK(memcmp(frame, encoded, (size_t) n) == 0);
+        for (int i = 0; i < nerasures + nerrors; i++) {
+            int found = 0;
+            for (int j = 0; j < nerasures + nerrors; j++) {
+                found |= corrected[i] == positions[j];
+            }
+            CHECK(found);
+        }
+    }
+    rs_codec_free(&codec);
+}
+
+// Payloads of any length segment into full codewords and a shortened last
+// one, and decode with up to t errors in each, in parallel or not.
+static void test_segment(uint64_t * rng) {
+
+    enum { K = 200 };
+    static const size_t lengths[] = {1, K, K + 1, 50 * K + 17, 1000003};
+    rs_codec_t codec;
+    CHECK(rs_codec_init(&codec, 8, 32) == 0);
+    int np = codec.nparity;
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t length = lengths[l];
+        uint64_t count = rs_segment_count(K, length);
+        size_t encodedLength = rs_segment_encoded_length(&codec, K, length);
+        CHECK(count == (length + K - 1) / K);
+        CHECK(encodedLength == length + count * (size_t) np);
+
+        uint8_t * payload = malloc(length);
+        uint8_t * encoded = malloc(encodedLength);
+        uint8_t * decoded = malloc(length);
+        test_fill(rng, payload, (int) length, 0xff);
+        CHECK(rs_segment_encode(&codec, K, payload, length, encoded, 4) == 0);
+
+        uint64_t damaged = 0;
+        for (uint64_t c = 0; c < count; c++) {
+            uint8_t * word = &encoded[c * (K + (size_t) np)];
+            int k = c + 1 < count ? K : (int) (length - c * K);
+            CHECK(memcmp(word, &payload[c * K], (size_t) k) == 0);
+            CHECK(test_is_codeword(&codec, word, k + np));
+
+            int nerrors = test_below(rng, np / 2 + 1);
+            int positions[RS_FIELD_MAX_SIZE];
+            test_positions(rng, k + np, positions, nerrors);
+            for (int i = 0; i < nerrors; i++) {
+                word[positions[i]] ^= (uint8_t) (1 + test_below(rng, 0xfe));
+            }
+            damaged += (uint64_t) nerrors;
+        }
+
+        rs_file_stats_t stats;
+        CHECK(rs_segment_decode(&codec, K, encoded, length, decoded, 4,
+                                &stats) == 0);
+        CHECK(memcmp(decoded, payload, length) == 0);
+        CHECK(stats.codewords == count);
+        CHECK(stats.symbols == damaged);
+        CHECK(stats.failed == 0);
+
+        free(decoded);
+        free(encoded);
+        free(payload);
+    }
+    rs_codec_free(&codec);
+}
+
+int main(void) {
+
+    uint64_t rng = 0x5eed5eedULL;
+
+    test_matlab();
+    test_within(&rng);
+    test_beyond(&rng);
+    test_iovec(&rng);
+    test_layout(&rng);
+    test_segment(&rng);
+
+    return test_result("test_codec");
+}
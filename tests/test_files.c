@@ -0,0 +1,394 @@
+//
+// File format tests: protected files, containers (whole, by range, with a
+// damaged index, through the lazy reader and repaired by the scrubber) and
+// shards (with shards missing) round trip through damage within the code's
+// capability.
+//
+// @author Jarrod Bennett
+//
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rs_test.h"
+#include "rs_container.h"
+#include "rs_file.h"
+#include "rs_lazy.h"
+#include "rs_scrub.h"
+#include "rs_shard.h"
+
+// An anonymous temporary file, removed when closed.
+static int temp_fd(void) {
+
+    char path[] = "/tmp/rs_testXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    unlink(path);
+    return fd;
+}
+
+// A temporary file of length random bytes, the same bytes left in data.
+static int make_input(uint64_t * rng, uint8_t * data, size_t length) {
+
+    test_fill(rng, data, (int) length, 0xff);
+    int fd = temp_fd();
+    CHECK(rs_file_write_all(fd, data, length) == 0);
+    return fd;
+}
+
+// Whether a file holds exactly length bytes, the same as data.
+static int file_equals(int fd, const uint8_t * data, size_t length) {
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size != length) {
+        return 0;
+    }
+    uint8_t * contents = malloc(length + 1);
+    int equal = pread(fd, contents, length, 0) == (ssize_t) length &&
+                memcmp(contents, data, length) == 0;
+    free(contents);
+    return equal;
+}
+
+// Flip a byte of a file.
+static void damage(int fd, uint64_t offset) {
+
+    uint8_t byte;
+    CHECK(pread(fd, &byte, 1, (off_t) offset) == 1);
+    byte ^= 0xa5;
+    CHECK(pwrite(fd, &byte, 1, (off_t) offset) == 1);
+}
+
+// Protected files decode with up to t errors in every codeword, the final
+// one shortened.
+static void test_file(uint64_t * rng) {
+
+    static const size_t lengths[] = {1, 223, 224, 100000};
+    rs_file_options_t options;
+    rs_file_options_default(&options);
+    options.threads = 2;
+    int n = options.k + options.nparity;
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t length = lengths[l];
+        uint8_t * data = malloc(length);
+        int inFd = make_input(rng, data, length);
+        int fecFd = temp_fd();
+        int outFd = temp_fd();
+        CHECK(rs_file_encode(inFd, fecFd, &options) == 0);
+
+        uint64_t codewords = (length + (size_t) options.k - 1) /
+                             (size_t) options.k;
+        uint64_t damaged = 0;
+        for (uint64_t c = 0; c < codewords; c++) {
+            int last = c + 1 == codewords;
+            int symbols = last ? (int) (length - c * (size_t) options.k) +
+                                 options.nparity : n;
+            int nerrors = test_below(rng, options.nparity / 2 + 1);
+            int positions[RS_FIELD_MAX_SIZE];
+            test_positions(rng, symbols, positions, nerrors);
+            for (int i = 0; i < nerrors; i++) {
+                damage(fecFd, RS_FILE_HEADER_SIZE + c * (uint64_t) n +
+                              (uint64_t) positions[i]);
+            }
+            damaged += (uint64_t) nerrors;
+        }
+
+        rs_file_stats_t stats;
+        CHECK(rs_file_decode(fecFd, outFd, &options, &stats) == 0);
+        CHECK(stats.codewords == codewords);
+        CHECK(stats.symbols == damaged);
+        CHECK(stats.failed == 0);
+        CHECK(file_equals(outFd, data, length));
+
+        close(inFd);
+        close(fecFd);
+        close(outFd);
+        free(data);
+    }
+}
+
+// Read all of a container's data back, by blocks and by random ranges.
+static void check_container(uint64_t * rng, int fd, const uint8_t * data,
+                            size_t length, int indexed) {
+
+    rs_container_t container;
+    CHECK(rs_container_open(&container, fd) == 0);
+    CHECK(container.indexed == indexed);
+    CHECK(container.length == length);
+
+    uint8_t * block = malloc(container.blockData);
+    for (uint64_t b = 0; b < container.blocks; b++) {
+        CHECK(rs_container_read_block(&container, b, block, NULL) == 0);
+        size_t offset = (size_t) b * container.blockData;
+        size_t size = length - offset < container.blockData ?
+                      length - offset : container.blockData;
+        CHECK(memcmp(block, &data[offset], size) == 0);
+    }
+    free(block);
+
+    uint8_t * range = malloc(length);
+    for (int trial = 0; trial < 50; trial++) {
+        size_t offset = (size_t) test_below(rng, (int) length);
+        size_t size = 1 + (size_t) test_below(rng, (int) (length - offset));
+        CHECK(rs_container_read(&container, offset, range, size, NULL) == 0);
+        CHECK(memcmp(range, &data[offset], size) == 0);
+    }
+    CHECK(rs_container_read(&container, length, range, 1, NULL) ==
+          RS_ERR_INVALID_ARGS);
+    free(range);
+
+    int outFd = temp_fd();
+    rs_file_options_t options;
+    rs_file_options_default(&options);
+    CHECK(rs_container_decode(fd, outFd, &options, NULL) == 0);
+    CHECK(file_equals(outFd, data, length));
+    close(outFd);
+    rs_container_close(&container);
+}
+
+// Damage every step'th block of a container with a burst its interleaving
+// can correct.
+//
+// @return  the number of blocks damaged.
+static uint64_t damage_blocks(uint64_t * rng, int fd,
+                              const rs_container_params_t * params,
+                              uint64_t step) {
+
+    uint8_t header[RS_CONTAINER_HEADER_SIZE];
+    CHECK(pread(fd, header, sizeof(header), 0) == (ssize_t) sizeof(header));
+    uint64_t blocks = rs_file_get_le(&header[24], 8);
+    uint64_t blockSize = (uint64_t) params->depth *
+                         (uint64_t) (params->k + params->nparity);
+
+    int burst = params->depth * params->nparity / 2;
+    uint64_t damaged = 0;
+    for (uint64_t b = 0; b < blocks; b += step) {
+        uint64_t start = (uint64_t) test_below(rng, (int) blockSize - burst);
+        for (int i = 0; i < burst; i++) {
+            damage(fd, RS_CONTAINER_HEADER_SIZE + b * blockSize + start +
+                       (uint64_t) i);
+        }
+        damaged++;
+    }
+    return damaged;
+}
+
+// Containers decode with a correctable burst in every block, and still do
+// once the index and then the footer are damaged.
+static void test_container(uint64_t * rng) {
+
+    enum { LENGTH = 200000 };
+    uint8_t * data = malloc(LENGTH);
+    int inFd = make_input(rng, data, LENGTH);
+    int fd = temp_fd();
+    rs_container_params_t params;
+    rs_container_params_default(&params);
+    CHECK(rs_container_write(inFd, fd, &params, 2) == 0);
+
+    uint8_t header[RS_CONTAINER_HEADER_SIZE];
+    CHECK(pread(fd, header, sizeof(header), 0) == (ssize_t) sizeof(header));
+    uint64_t blocks = rs_file_get_le(&header[24], 8);
+    uint64_t index = rs_file_get_le(&header[32], 8);
+    CHECK(blocks == (LENGTH + (uint64_t) (params.depth * params.k) - 1) /
+                    (uint64_t) (params.depth * params.k));
+
+    CHECK(damage_blocks(rng, fd, &params, 1) == blocks);
+    check_container(rng, fd, data, LENGTH, 1);
+
+    damage(fd, index + RS_CONTAINER_INDEX_ENTRY + 8);
+    check_container(rng, fd, data, LENGTH, 0);
+
+    damage(fd, index + blocks * RS_CONTAINER_INDEX_ENTRY + 8);
+    check_container(rng, fd, data, LENGTH, 0);
+
+    close(inFd);
+    close(fd);
+    free(data);
+}
+
+// Lazy reads verify each block on first access, patching the corrections
+// into a private mapping and leaving the file as it was.
+static void test_lazy(uint64_t * rng) {
+
+    enum { LENGTH = 100000 };
+    uint8_t * data = malloc(LENGTH);
+    int inFd = make_input(rng, data, LENGTH);
+    int fd = temp_fd();
+    rs_container_params_t params;
+    rs_container_params_default(&params);
+    CHECK(rs_container_write(inFd, fd, &params, 2) == 0);
+    uint64_t damaged = damage_blocks(rng, fd, &params, 2);
+
+    struct stat st;
+    CHECK(fstat(fd, &st) == 0);
+    uint8_t * before = malloc((size_t) st.st_size);
+    CHECK(pread(fd, before, (size_t) st.st_size, 0) == st.st_size);
+
+    rs_lazy_t lazy;
+    CHECK(rs_lazy_open(&lazy, fd) == 0);
+    rs_lazy_counters_t counters;
+    rs_lazy_get_counters(&lazy, &counters);
+    CHECK(counters.blocksVerified == 0);
+
+    uint8_t * range = malloc(LENGTH);
+    for (int trial = 0; trial < 50; trial++) {
+        size_t offset = (size_t) test_below(rng, LENGTH);
+        size_t size = 1 + (size_t) test_below(rng, (int) (LENGTH - offset));
+        CHECK(rs_lazy_read(&lazy, offset, range, size) == 0);
+        CHECK(memcmp(range, &data[offset], size) == 0);
+    }
+    CHECK(rs_lazy_read(&lazy, LENGTH - 1, range, 2) == RS_ERR_INVALID_ARGS);
+
+    // Every block, whether already verified or not, in place
+    uint64_t blocks = lazy.container.blocks;
+    size_t blockData = lazy.container.blockData;
+    for (uint64_t b = 0; b < blocks; b++) {
+        int err;
+        const uint8_t * block = rs_lazy_block(&lazy, b, &err);
+        CHECK(block != NULL && err == 0);
+        size_t offset = (size_t) b * blockData;
+        size_t size = LENGTH - offset < blockData ? LENGTH - offset :
+                      blockData;
+        CHECK(block != NULL && memcmp(block, &data[offset], size) == 0);
+    }
+    CHECK(rs_lazy_block(&lazy, blocks, NULL) == NULL);
+
+    rs_lazy_get_counters(&lazy, &counters);
+    CHECK(counters.blocksVerified == blocks);
+    CHECK(counters.blocksFailed == 0);
+    CHECK(counters.codewordsCorrected >= damaged);
+    rs_lazy_close(&lazy);
+
+    uint8_t * after = malloc((size_t) st.st_size);
+    CHECK(pread(fd, after, (size_t) st.st_size, 0) == st.st_size);
+    CHECK(memcmp(before, after, (size_t) st.st_size) == 0);
+
+    close(inFd);
+    close(fd);
+    free(after);
+    free(before);
+    free(range);
+    free(data);
+}
+
+// A scrub repairs the damaged blocks of a container in the file, leaving
+// it as written, and a rate limited scrub stops promptly when asked.
+static void test_scrub(uint64_t * rng) {
+
+    enum { LENGTH = 2000000 };
+    uint8_t * data = malloc(LENGTH);
+    int inFd = make_input(rng, data, LENGTH);
+    int fd = temp_fd();
+    rs_container_params_t params;
+    rs_container_params_default(&params);
+    CHECK(rs_container_write(inFd, fd, &params, 2) == 0);
+
+    struct stat st;
+    CHECK(fstat(fd, &st) == 0);
+    uint8_t * clean = malloc((size_t) st.st_size);
+    CHECK(pread(fd, clean, (size_t) st.st_size, 0) == st.st_size);
+    uint64_t damaged = damage_blocks(rng, fd, &params, 7);
+
+    rs_scrub_options_t options;
+    rs_scrub_options_default(&options);
+    options.nice = 0;
+    options.idleIo = 0;
+
+    rs_scrub_t scrub;
+    rs_scrub_stats_t stats;
+    CHECK(rs_scrub_open(&scrub, fd, &options) == 0);
+    CHECK(rs_scrub_run(&scrub) == 0);
+    rs_scrub_get_stats(&scrub, &stats);
+    CHECK(stats.blocks == scrub.container.blocks);
+    CHECK(stats.repairedBlocks == damaged);
+    CHECK(stats.failedBlocks == 0);
+    CHECK(stats.passes == 1);
+    rs_scrub_close(&scrub);
+    CHECK(file_equals(fd, clean, (size_t) st.st_size));
+
+    // At 1 KiB/s the first block alone is a few seconds' worth
+    options.bytesPerSecond = 1024;
+    CHECK(rs_scrub_open(&scrub, fd, &options) == 0);
+    struct timespec start, end;
+    CHECK(rs_scrub_start(&scrub) == 0);
+    struct timespec pause = {0, 200000000};
+    nanosleep(&pause, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rs_scrub_stop(&scrub);
+    CHECK(rs_scrub_wait(&scrub) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    CHECK(end.tv_sec - start.tv_sec < 1);
+    CHECK(scrub.cursor < scrub.container.blocks);
+    rs_scrub_close(&scrub);
+
+    close(inFd);
+    close(fd);
+    free(clean);
+    free(data);
+}
+
+// Shards reassemble in any order with up to nparity of them missing, and
+// fail as uncorrectable with more.
+static void test_shard(uint64_t * rng) {
+
+    enum { K = 6, NPARITY = 3, SHARDS = K + NPARITY, LENGTH = 150000 };
+    for (int sync = 0; sync < 2; sync++) {
+        rs_file_options_t options;
+        rs_file_options_default(&options);
+        options.k = K;
+        options.nparity = NPARITY;
+        options.threads = 2;
+        options.ioFlags = sync ? RS_IO_SYNC : 0;
+
+        uint8_t * data = malloc(LENGTH);
+        int inFd = make_input(rng, data, LENGTH);
+        int fds[SHARDS];
+        for (int j = 0; j < SHARDS; j++) {
+            fds[j] = temp_fd();
+        }
+        CHECK(rs_shard_encode(inFd, fds, &options) == 0);
+
+        for (int missing = 0; missing <= NPARITY + 1; missing++) {
+            int order[SHARDS];
+            test_positions(rng, SHARDS, order, SHARDS);
+            int given[SHARDS];
+            for (int j = 0; j < SHARDS; j++) {
+                given[j] = j < missing ? -1 : fds[order[j]];
+            }
+
+            int outFd = temp_fd();
+            rs_file_stats_t stats;
+            int result = rs_shard_decode(given, SHARDS, outFd, &options,
+                                         &stats);
+            if (missing <= NPARITY) {
+                CHECK(result == 0);
+                CHECK(file_equals(outFd, data, LENGTH));
+            } else {
+                CHECK(result == RS_ERR_UNCORRECTABLE);
+            }
+            close(outFd);
+        }
+
+        for (int j = 0; j < SHARDS; j++) {
+            close(fds[j]);
+        }
+        close(inFd);
+        free(data);
+    }
+}
+
+int main(void) {
+
+    uint64_t rng = 0xf11e5ULL;
+
+    test_file(&rng);
+    test_container(&rng);
+    test_lazy(&rng);
+    test_scrub(&rng);
+    test_shard(&rng);
+
+    return test_result("test_files");
+}
@@ -0,0 +1,147 @@
+//
+// Plan and dispatch tests: wisdom exported by one plan and imported again,
+// from text or a file, gives later plans the same kernel without
+// measuring, and a kernel forced with RS_CODEC_KERNEL overrides the CPU's
+// best, measurement and wisdom.
+//
+// @author Jarrod Bennett
+//
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rs_test.h"
+#include "rs_plan.h"
+
+// A measured plan's kernel survives an export, forget and import, as text
+// and as a file, and a planned codec encodes as a plain one does.
+static void test_wisdom(uint64_t * rng) {
+
+    rs_plan_params_t params;
+    rs_plan_params_default(&params);
+    params.batch = 16;
+
+    rs_plan_forget_wisdom();
+    CHECK(rs_plan_export_wisdom(NULL, 0) == strlen(RS_PLAN_WISDOM_HEADER));
+
+    rs_plan_t plan;
+    CHECK(rs_plan_create(&plan, &params, RS_PLAN_MEASURE) == 0);
+    CHECK(!plan.fromWisdom);
+    CHECK(plan.nanoseconds[RS_KERNEL_SCALAR] > 0);
+    int kernel = plan.codec.kernel;
+    CHECK(plan.nanoseconds[kernel] > 0);
+
+    // The plan encodes as any codec of the code does
+    enum { BATCH = 16 };
+    int n = params.k + params.nparity;
+    uint8_t batch[BATCH * RS_FIELD_MAX_SIZE];
+    test_fill(rng, batch, BATCH * n, 0xff);
+    CHECK(rs_plan_encode(&plan, batch, (size_t) n, &batch[params.k],
+                         (size_t) n, BATCH) == 0);
+    for (int i = 0; i < BATCH; i++) {
+        CHECK(test_is_codeword(&plan.codec, &batch[i * n], n));
+    }
+    rs_plan_destroy(&plan);
+
+    size_t length = rs_plan_export_wisdom(NULL, 0);
+    char * wisdom = malloc(length + 1);
+    CHECK(rs_plan_export_wisdom(wisdom, length + 1) == length);
+    CHECK(strncmp(wisdom, RS_PLAN_WISDOM_HEADER,
+                  strlen(RS_PLAN_WISDOM_HEADER)) == 0);
+    CHECK(strstr(wisdom, rs_codec_kernel_name(kernel)) != NULL);
+
+    rs_plan_forget_wisdom();
+    CHECK(rs_plan_import_wisdom(wisdom) == 0);
+    CHECK(rs_plan_create(&plan, &params, RS_PLAN_ESTIMATE) == 0);
+    CHECK(plan.fromWisdom);
+    CHECK(plan.codec.kernel == kernel);
+    rs_plan_destroy(&plan);
+
+    char path[] = "/tmp/rs_wisdomXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    CHECK(rs_plan_export_wisdom_file(path) == 0);
+    rs_plan_forget_wisdom();
+    CHECK(rs_plan_import_wisdom_file(path) == 0);
+    unlink(path);
+    CHECK(rs_plan_create(&plan, &params, RS_PLAN_ESTIMATE) == 0);
+    CHECK(plan.fromWisdom);
+    CHECK(plan.codec.kernel == kernel);
+    rs_plan_destroy(&plan);
+    free(wisdom);
+
+    // Wisdom overrides the guess, unless it names an unknown kernel
+    rs_plan_forget_wisdom();
+    CHECK(rs_plan_import_wisdom(RS_PLAN_WISDOM_HEADER
+                                "8 32 223 16 scalar\n"
+                                "8 32 100 16 avx9000\n") == 0);
+    CHECK(rs_plan_create(&plan, &params, RS_PLAN_ESTIMATE) == 0);
+    CHECK(plan.fromWisdom);
+    CHECK(plan.codec.kernel == RS_KERNEL_SCALAR);
+    rs_plan_destroy(&plan);
+    params.k = 100;
+    CHECK(rs_plan_create(&plan, &params, RS_PLAN_ESTIMATE) == 0);
+    CHECK(!plan.fromWisdom);
+    rs_plan_destroy(&plan);
+
+    CHECK(rs_plan_import_wisdom("not wisdom\n") == RS_ERR_FORMAT);
+    rs_plan_forget_wisdom();
+}
+
+// Without RS_CODEC_KERNEL (or with one naming no usable kernel), nothing
+// is forced and new contexts get the CPU's best kernel.
+static void test_default(void) {
+
+    CHECK(rs_codec_kernel_forced() == -1);
+    rs_codec_t codec;
+    CHECK(rs_codec_init(&codec, 8, 32) == 0);
+    CHECK(codec.kernel == rs_codec_default_kernel());
+    CHECK(rs_codec_kernel_supported(&codec, codec.kernel));
+    rs_codec_free(&codec);
+}
+
+// Run with RS_CODEC_KERNEL=scalar, every context and plan uses the scalar
+// kernel, whatever wisdom says and without measuring.
+static void test_forced(void) {
+
+    CHECK(rs_codec_kernel_forced() == RS_KERNEL_SCALAR);
+    CHECK(rs_codec_default_kernel() == RS_KERNEL_SCALAR);
+
+    rs_codec_t codec;
+    CHECK(rs_codec_init(&codec, 8, 32) == 0);
+    CHECK(codec.kernel == RS_KERNEL_SCALAR);
+    rs_codec_free(&codec);
+
+    rs_plan_params_t params;
+    rs_plan_params_default(&params);
+    CHECK(rs_plan_import_wisdom(RS_PLAN_WISDOM_HEADER
+                                "8 32 223 1 lanes\n") == 0);
+    for (int flags = RS_PLAN_ESTIMATE; flags <= RS_PLAN_MEASURE; flags++) {
+        rs_plan_t plan;
+        CHECK(rs_plan_create(&plan, &params, flags) == 0);
+        CHECK(plan.codec.kernel == RS_KERNEL_SCALAR);
+        CHECK(!plan.fromWisdom);
+        for (int kernel = 0; kernel < RS_KERNEL_COUNT; kernel++) {
+            CHECK(plan.nanoseconds[kernel] == 0);
+        }
+        rs_plan_destroy(&plan);
+    }
+    rs_plan_forget_wisdom();
+}
+
+int main(void) {
+
+    uint64_t rng = 0x91a45ULL;
+
+    // ctest runs this again with RS_CODEC_KERNEL set, see CMakeLists.txt
+    const char * forced = getenv(RS_CODEC_KERNEL_ENV);
+    if (forced != NULL && strcmp(forced, "scalar") == 0) {
+        test_forced();
+    } else {
+        test_default();
+        test_wisdom(&rng);
+    }
+
+    return test_result("test_plan");
+}
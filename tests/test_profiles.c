@@ -0,0 +1,262 @@
+//
+// Profile tests: the CCSDS dual basis against the standard's definition and
+// libfec's tables, CCSDS codeblocks against reference codewords, and DVB
+// transport stream packets against a reference encoder.
+//
+// @author Jarrod Bennett
+//
+
+#include "rs_test.h"
+#include "rs_ccsds.h"
+#include "rs_dvb.h"
+
+// The first 16 entries of libfec's Taltab (conventional to dual) and
+// Tal1tab (dual to conventional).
+static const uint8_t taltab[16] = {
+    0x00, 0x7b, 0xaf, 0xd4, 0x99, 0xe2, 0x36, 0x4d,
+    0xfa, 0x81, 0x55, 0x2e, 0x63, 0x18, 0xcc, 0xb7,
+};
+static const uint8_t tal1tab[16] = {
+    0x00, 0xcc, 0xac, 0x60, 0x79, 0xb5, 0xd5, 0x19,
+    0xf0, 0x3c, 0x5c, 0x90, 0x89, 0x45, 0x25, 0xe9,
+};
+
+// Dual basis parity of RS(255, 223) codewords whose data, in the dual
+// basis, is 0, 1, .. 222 (ramp) and, shortened to k = 100, 255, 254, .. 156
+// (shortRamp). Computed from CCSDS 131.0-B's definitions independently of
+// this library.
+static const uint8_t rampParity[32] = {
+    0x4f, 0xfb, 0x92, 0xdd, 0x55, 0x7e, 0xc6, 0x7f,
+    0x27, 0xfb, 0x89, 0x82, 0xcf, 0x58, 0xf8, 0xfd,
+    0x02, 0x8a, 0xd1, 0x17, 0xfc, 0xef, 0x6b, 0x27,
+    0x93, 0xd0, 0x41, 0x88, 0x26, 0x57, 0x86, 0x51,
+};
+static const uint8_t shortRampParity[32] = {
+    0x19, 0xef, 0x76, 0x28, 0x71, 0x18, 0x6d, 0x72,
+    0x90, 0xcb, 0x6b, 0x0d, 0x45, 0xdf, 0x60, 0x06,
+    0x12, 0x0e, 0x84, 0x0e, 0x39, 0x91, 0xc7, 0x3c,
+    0x49, 0xcb, 0x77, 0x27, 0x7a, 0x63, 0x6b, 0x10,
+};
+
+// Multiply in GF(256) with the primitive polynomial poly, bit by bit.
+static uint8_t field_mul(uint8_t a, uint8_t b, int poly) {
+
+    uint8_t product = 0;
+    while (b != 0) {
+        if (b & 1) {
+            product ^= a;
+        }
+        b >>= 1;
+        a = (uint8_t) ((a << 1) ^ (a & 0x80 ? poly & 0xff : 0));
+    }
+    return product;
+}
+
+// Multiply in the CCSDS field, x^8 + x^7 + x^2 + x + 1.
+static uint8_t ccsds_mul(uint8_t a, uint8_t b) {
+
+    return field_mul(a, b, RS_CCSDS_POLY);
+}
+
+// Trace of a field element, 0 or 1.
+static int ccsds_trace(uint8_t x) {
+
+    uint8_t trace = 0;
+    for (int i = 0; i < 8; i++) {
+        trace ^= x;
+        x = ccsds_mul(x, x);
+    }
+    return trace;
+}
+
+// The dual basis form of every symbol is, from the most significant bit
+// down, Tr(beta^i x) for beta = alpha^117, in both directions and on both
+// the vector and scalar conversion paths.
+static void test_ccsds_basis(void) {
+
+    uint8_t beta = 1;
+    for (int i = 0; i < 117; i++) {
+        beta = ccsds_mul(beta, 2);
+    }
+
+    uint8_t all[256];
+    uint8_t expected[256];
+    for (int x = 0; x < 256; x++) {
+        uint8_t power = 1;
+        uint8_t dual = 0;
+        for (int i = 0; i < 8; i++) {
+            dual |= (uint8_t) (ccsds_trace(ccsds_mul(power, (uint8_t) x)) <<
+                               (7 - i));
+            power = ccsds_mul(power, beta);
+        }
+        all[x] = (uint8_t) x;
+        expected[x] = dual;
+    }
+
+    rs_ccsds_to_dual(all, 256);
+    CHECK(memcmp(all, expected, sizeof(all)) == 0);
+    CHECK(memcmp(all, taltab, sizeof(taltab)) == 0);
+    rs_ccsds_from_dual(all, 256);
+    for (int x = 0; x < 256; x++) {
+        CHECK(all[x] == x);
+        uint8_t one = (uint8_t) x;
+        rs_ccsds_to_dual(&one, 1);
+        CHECK(one == expected[x]);
+        one = expected[x];
+        rs_ccsds_from_dual(&one, 1);
+        CHECK(one == x);
+    }
+    for (int x = 0; x < 16; x++) {
+        uint8_t one = (uint8_t) x;
+        rs_ccsds_from_dual(&one, 1);
+        CHECK(one == tal1tab[x]);
+    }
+}
+
+// Dual basis codeblocks of every depth match the reference parity in each
+// interleaved codeword, full length and shortened, and decode with E
+// errors in every codeword.
+static void test_ccsds_vectors(uint64_t * rng) {
+
+    for (int depth = 1; depth <= RS_CCSDS_MAX_DEPTH; depth++) {
+        rs_ccsds_t ccsds;
+        CHECK(rs_ccsds_init(&ccsds, 16, depth, RS_CCSDS_DUAL) == 0);
+
+        for (int shortened = 0; shortened < 2; shortened++) {
+            int k = shortened ? 100 : 223;
+            const uint8_t * parity = shortened ? shortRampParity : rampParity;
+            uint8_t block[RS_CCSDS_MAX_DEPTH * 255];
+            CHECK(rs_ccsds_block_length(&ccsds, k) ==
+                  (size_t) (depth * (k + 32)));
+            for (int i = 0; i < k; i++) {
+                for (int j = 0; j < depth; j++) {
+                    block[i * depth + j] = (uint8_t) (shortened ? 255 - i : i);
+                }
+            }
+            CHECK(rs_ccsds_encode(&ccsds, block, k) == 0);
+            for (int i = 0; i < 32; i++) {
+                for (int j = 0; j < depth; j++) {
+                    CHECK(block[(k + i) * depth + j] == parity[i]);
+                }
+            }
+
+            uint8_t sent[RS_CCSDS_MAX_DEPTH * 255];
+            int length = depth * (k + 32);
+            memcpy(sent, block, (size_t) length);
+            for (int j = 0; j < depth; j++) {
+                int positions[RS_FIELD_MAX_SIZE];
+                test_positions(rng, k + 32, positions, 16);
+                for (int i = 0; i < 16; i++) {
+                    block[positions[i] * depth + j] ^=
+                            (uint8_t) (1 + test_below(rng, 255));
+                }
+            }
+            int corrected[RS_CCSDS_MAX_DEPTH];
+            CHECK(rs_ccsds_decode(&ccsds, block, k, corrected) == 16 * depth);
+            for (int j = 0; j < depth; j++) {
+                CHECK(corrected[j] == 16);
+            }
+            CHECK(memcmp(block, sent, (size_t) length) == 0);
+        }
+        rs_ccsds_free(&ccsds);
+    }
+}
+
+// Parity of a DVB packet by long division by the generator, built from
+// its roots alpha^0 .. alpha^15 in the DVB field.
+static void dvb_reference(const uint8_t * packet, uint8_t * parity) {
+
+    uint8_t generator[RS_DVB_PARITY + 1] = {1};
+    uint8_t root = 1;
+    for (int i = 0; i < RS_DVB_PARITY; i++) {
+        for (int j = i + 1; j > 0; j--) {
+            generator[j] ^= field_mul(generator[j - 1], root, RS_DVB_POLY);
+        }
+        root = field_mul(root, 2, RS_DVB_POLY);
+    }
+
+    uint8_t remainder[RS_DVB_CODED] = {0};
+    memcpy(remainder, packet, RS_DVB_PACKET);
+    for (int i = 0; i < RS_DVB_PACKET; i++) {
+        uint8_t factor = remainder[i];
+        for (int j = 1; j <= RS_DVB_PARITY; j++) {
+            remainder[i + j] ^= field_mul(generator[j], factor, RS_DVB_POLY);
+        }
+    }
+    memcpy(parity, &remainder[RS_DVB_PACKET], RS_DVB_PARITY);
+}
+
+// Transport stream packets, more than one batch of them, encode to the
+// reference parity and decode with 8 bytes in error. A packet beyond that
+// is passed on as received with its transport error indicator set.
+static void test_dvb(uint64_t * rng) {
+
+    enum { COUNT = 150, BAD = 77 };
+    rs_dvb_t dvb;
+    CHECK(rs_dvb_init(&dvb) == 0);
+
+    static uint8_t packets[COUNT][RS_DVB_PACKET];
+    static uint8_t coded[COUNT][RS_DVB_CODED];
+    static uint8_t received[COUNT][RS_DVB_CODED];
+    static uint8_t decoded[COUNT][RS_DVB_PACKET];
+    for (int p = 0; p < COUNT; p++) {
+        test_fill(rng, packets[p], RS_DVB_PACKET, 0xff);
+        packets[p][0] = 0x47;
+        packets[p][1] &= (uint8_t) ~RS_DVB_TEI;
+    }
+    CHECK(rs_dvb_encode(&dvb, &packets[0][0], COUNT, &coded[0][0]) == 0);
+
+    for (int p = 0; p < COUNT; p++) {
+        uint8_t parity[RS_DVB_PARITY];
+        dvb_reference(packets[p], parity);
+        CHECK(memcmp(coded[p], packets[p], RS_DVB_PACKET) == 0);
+        CHECK(memcmp(&coded[p][RS_DVB_PACKET], parity, RS_DVB_PARITY) == 0);
+
+        // Every third packet clean, one far beyond repair
+        memcpy(received[p], coded[p], RS_DVB_CODED);
+        int nerrors = p == BAD ? 40 : p % 3 == 0 ? 0 : RS_DVB_PARITY / 2;
+        int positions[RS_DVB_CODED];
+        test_positions(rng, RS_DVB_CODED, positions, nerrors);
+        for (int i = 0; i < nerrors; i++) {
+            received[p][positions[i]] ^= (uint8_t) (1 + test_below(rng, 255));
+        }
+    }
+
+    int results[COUNT];
+    CHECK(rs_dvb_decode(&dvb, &received[0][0], COUNT, &decoded[0][0],
+                        results) == RS_ERR_UNCORRECTABLE);
+    for (int p = 0; p < COUNT; p++) {
+        if (p == BAD) {
+            CHECK(results[p] == RS_ERR_UNCORRECTABLE);
+            CHECK(decoded[p][1] & RS_DVB_TEI);
+            decoded[p][1] &= (uint8_t) ~RS_DVB_TEI;
+            received[p][1] &= (uint8_t) ~RS_DVB_TEI;
+            CHECK(memcmp(decoded[p], received[p], RS_DVB_PACKET) == 0);
+        } else {
+            CHECK(results[p] == (p % 3 == 0 ? 0 : RS_DVB_PARITY / 2));
+            CHECK(memcmp(decoded[p], packets[p], RS_DVB_PACKET) == 0);
+        }
+    }
+
+    // Without the bad packet, the total of the corrections comes back
+    memcpy(received[BAD], coded[BAD], RS_DVB_CODED);
+    int total = 0;
+    for (int p = 0; p < COUNT; p++) {
+        total += p % 3 == 0 || p == BAD ? 0 : RS_DVB_PARITY / 2;
+    }
+    CHECK(rs_dvb_decode(&dvb, &received[0][0], COUNT, &decoded[0][0],
+                        NULL) == total);
+    CHECK(memcmp(decoded, packets, sizeof(packets)) == 0);
+    rs_dvb_free(&dvb);
+}
+
+int main(void) {
+
+    uint64_t rng = 0xcc5d5ULL;
+
+    test_ccsds_basis();
+    test_ccsds_vectors(&rng);
+    test_dvb(&rng);
+
+    return test_result("test_profiles");
+}
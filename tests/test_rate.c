@@ -0,0 +1,200 @@
+//
+// Variable rate tests: punctured codes decode up to the parity they keep,
+// incremental redundancy decodes once enough parity has been received, and
+// a rate-adaptive context's mixed batches match single encodes.
+//
+// @author Jarrod Bennett
+//
+
+#include "rs_test.h"
+#include "rs_harq.h"
+#include "rs_rate.h"
+
+// Punctured words are the full codewords with the punctured parity left
+// out, and decode with errors and erasures up to the parity kept.
+static void test_puncture(uint64_t * rng) {
+
+    rs_codec_t codec;
+    CHECK(rs_codec_init(&codec, 8, 16) == 0);
+    int np = codec.nparity;
+
+    // No parity kept is refused
+    CHECK(rs_codec_set_puncture(&codec, (1ULL << np) - 1) ==
+          RS_ERR_INVALID_ARGS);
+
+    for (int trial = 0; trial < 2000; trial++) {
+        uint64_t mask = test_random(rng) & ((1ULL << np) - 1);
+        if (mask == (1ULL << np) - 1) {
+            continue;
+        }
+        CHECK(rs_codec_set_puncture(&codec, mask) == 0);
+        int kept = np - codec.npunctured;
+
+        int k = 1 + test_below(rng, codec.nn - np);
+        int n = k + kept;
+        uint8_t full[RS_FIELD_MAX_SIZE];
+        uint8_t sent[RS_FIELD_MAX_SIZE];
+        uint8_t received[RS_FIELD_MAX_SIZE];
+        test_fill(rng, full, k, codec.nn);
+        CHECK(rs_codec_encode(&codec, full, k, &full[k]) == 0);
+        memcpy(sent, full, (size_t) k);
+        CHECK(rs_codec_encode_punctured(&codec, sent, k, &sent[k]) == 0);
+
+        int j = k;
+        for (int i = 0; i < np; i++) {
+            if (!(mask >> i & 1)) {
+                CHECK(sent[j++] == full[k + i]);
+            }
+        }
+
+        int nerasures = test_below(rng, kept + 1);
+        int nerrors = (kept - nerasures) / 2;
+        if (nerasures + nerrors > n) {
+            continue;
+        }
+        int positions[RS_FIELD_MAX_SIZE];
+        test_positions(rng, n, positions, nerasures + nerrors);
+        memcpy(received, sent, (size_t) n);
+        for (int i = 0; i < nerasures + nerrors; i++) {
+            received[positions[i]] ^= (uint8_t) (1 + test_below(rng,
+                                                             codec.nn));
+        }
+
+        int result = rs_codec_decode_punctured(&codec, received, n, positions,
+                                               nerasures, NULL);
+        CHECK(result == nerasures + nerrors);
+        CHECK(memcmp(received, sent, (size_t) n) == 0);
+    }
+    rs_codec_free(&codec);
+}
+
+// Each retransmission's parity is the next of the mother code's, and a
+// frame with e errors among the symbols received decodes once 2 * e
+// parity symbols have arrived.
+static void test_harq(uint64_t * rng) {
+
+    enum { NPARITY = 32, FIRST = 8, STEP = 6 };
+    rs_harq_t harq;
+    CHECK(rs_harq_init(&harq, 8, NPARITY, FIRST, STEP) == 0);
+
+    for (int trial = 0; trial < 500; trial++) {
+        int k = 1 + test_below(rng, harq.codec.nn - NPARITY);
+        int n = k + NPARITY;
+        uint8_t sent[RS_FIELD_MAX_SIZE];
+        uint8_t received[RS_FIELD_MAX_SIZE];
+        test_fill(rng, sent, k, harq.codec.nn);
+        CHECK(rs_codec_encode(&harq.codec, sent, k, &sent[k]) == 0);
+
+        // Errors anywhere in the mother codeword, only some of which are
+        // in the parity sent by the time the frame decodes
+        int nerrors = test_below(rng, NPARITY / 2 + 1);
+        int positions[RS_FIELD_MAX_SIZE];
+        test_positions(rng, n, positions, nerrors);
+        memcpy(received, sent, (size_t) n);
+        for (int i = 0; i < nerrors; i++) {
+            received[positions[i]] ^= (uint8_t) (1 + test_below(rng,
+                                                             harq.codec.nn));
+        }
+
+        rs_harq_tx_t tx;
+        rs_harq_rx_t rx;
+        CHECK(rs_harq_encode(&harq, sent, k, &tx) == 0);
+        CHECK(rs_harq_rx_init(&harq, &rx, received, k) == 0);
+
+        int decoded = 0;
+        uint8_t parity[RS_CODEC_MAX_PARITY];
+        int count;
+        while ((count = rs_harq_next(&harq, &tx, parity)) > 0) {
+            CHECK(count == (rx.received == 0 ? FIRST :
+                            (NPARITY - rx.received < STEP ?
+                             NPARITY - rx.received : STEP)));
+            CHECK(memcmp(parity, &sent[k + rx.received], (size_t) count) == 0);
+            CHECK(rs_harq_rx_add(&harq, &rx, &received[k + rx.received],
+                                 count) == 0);
+
+            int errors = 0;
+            for (int i = 0; i < nerrors; i++) {
+                errors += positions[i] < k + rx.received;
+            }
+            uint8_t msg[RS_FIELD_MAX_SIZE];
+            int result = rs_harq_decode(&harq, &rx, NULL, 0, msg);
+            if (2 * errors <= rx.received) {
+                CHECK(result == errors);
+                CHECK(memcmp(msg, sent, (size_t) k) == 0);
+                decoded = 1;
+                break;
+            }
+        }
+        CHECK(decoded);
+    }
+
+    // The mother code exhausted, there is nothing more to send or add
+    rs_harq_tx_t tx;
+    rs_harq_rx_t rx;
+    uint8_t msg[10] = {0};
+    uint8_t parity[RS_CODEC_MAX_PARITY];
+    CHECK(rs_harq_encode(&harq, msg, 10, &tx) == 0);
+    CHECK(rs_harq_rx_init(&harq, &rx, msg, 10) == 0);
+    int count;
+    while ((count = rs_harq_next(&harq, &tx, parity)) > 0) {
+        CHECK(rs_harq_rx_add(&harq, &rx, parity, count) == 0);
+    }
+    CHECK(rx.received == NPARITY);
+    CHECK(rs_harq_rx_add(&harq, &rx, parity, 1) == RS_ERR_INVALID_ARGS);
+    rs_harq_free(&harq);
+}
+
+// Mixed rate batches in any order match encodes with each rate's codec,
+// and each rate decodes up to its own capability.
+static void test_rate(uint64_t * rng) {
+
+    static const int nparity[] = {16, 4, 32, 8};
+    rs_rate_t rate;
+    CHECK(rs_rate_init(&rate, 8, nparity, 4) == 0);
+    CHECK(rs_rate_codec(&rate, 6) == NULL);
+
+    enum { FRAMES = 40 };
+    uint8_t msgs[FRAMES][RS_FIELD_MAX_SIZE];
+    uint8_t parity[FRAMES][RS_CODEC_MAX_PARITY];
+    rs_rate_frame_t frames[FRAMES];
+    for (int i = 0; i < FRAMES; i++) {
+        frames[i].nparity = nparity[test_below(rng, 4)];
+        frames[i].k = 1 + test_below(rng, 255 - frames[i].nparity);
+        test_fill(rng, msgs[i], frames[i].k, 0xff);
+        frames[i].msg = msgs[i];
+        frames[i].parity = parity[i];
+    }
+    CHECK(rs_rate_encode_batch(&rate, frames, FRAMES) == 0);
+
+    for (int i = 0; i < FRAMES; i++) {
+        int k = frames[i].k;
+        int np = frames[i].nparity;
+        uint8_t word[RS_FIELD_MAX_SIZE];
+        memcpy(word, msgs[i], (size_t) k);
+        CHECK(rs_codec_encode(rs_rate_codec(&rate, np), word, k,
+                              &word[k]) == 0);
+        CHECK(memcmp(&word[k], parity[i], (size_t) np) == 0);
+
+        int nerrors = np / 2;
+        int positions[RS_FIELD_MAX_SIZE];
+        test_positions(rng, k + np, positions, nerrors);
+        for (int j = 0; j < nerrors; j++) {
+            word[positions[j]] ^= (uint8_t) (1 + test_below(rng, 255));
+        }
+        CHECK(rs_rate_decode(&rate, word, k + np, np, NULL, 0, NULL) ==
+              nerrors);
+        CHECK(memcmp(word, msgs[i], (size_t) k) == 0);
+    }
+    rs_rate_free(&rate);
+}
+
+int main(void) {
+
+    uint64_t rng = 0x7a7e5ULL;
+
+    test_puncture(&rng);
+    test_harq(&rng);
+    test_rate(&rng);
+
+    return test_result("test_rate");
+}
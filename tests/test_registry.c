@@ -0,0 +1,94 @@
+//
+// Registry tests: contexts of the same code share one set of tables, and
+// of the tables no context uses, only the most recently released are kept.
+//
+// @author Jarrod Bennett
+//
+
+#include "rs_test.h"
+#include "rs_registry.h"
+
+// Two contexts and a direct acquire of one code hold a single set of
+// tables, kept once they are all released.
+static void test_sharing(uint64_t * rng) {
+
+    rs_registry_trim();
+    int count;
+    size_t bytes;
+    rs_registry_usage(&count, &bytes);
+    CHECK(count == 0 && bytes == 0);
+
+    rs_codec_t first;
+    rs_codec_t second;
+    CHECK(rs_codec_init(&first, 8, 32) == 0);
+    CHECK(rs_codec_init(&second, 8, 32) == 0);
+    CHECK(first.tables == second.tables);
+    const rs_tables_t * tables;
+    CHECK(rs_registry_acquire(8, 32, 0, RS_CODEC_DEFAULT_FCR,
+                              RS_CODEC_DEFAULT_PRIM, &tables) == 0);
+    CHECK((const void *) tables == first.tables);
+    rs_registry_usage(&count, &bytes);
+    CHECK(count == 1 && bytes == tables->size);
+
+    // Freeing one context leaves the other's tables in place
+    rs_codec_free(&first);
+    rs_registry_release(tables);
+    uint8_t word[RS_FIELD_MAX_SIZE];
+    test_fill(rng, word, 223, 0xff);
+    CHECK(rs_codec_encode(&second, word, 223, &word[223]) == 0);
+    CHECK(test_is_codeword(&second, word, 255));
+    rs_codec_free(&second);
+
+    rs_registry_usage(&count, NULL);
+    CHECK(count == 1);
+    rs_registry_trim();
+    rs_registry_usage(&count, &bytes);
+    CHECK(count == 0 && bytes == 0);
+}
+
+// Releasing more distinct codes than are kept evicts the one idle the
+// longest, which is rebuilt on its next use.
+static void test_eviction(void) {
+
+    const rs_tables_t * first;
+    CHECK(rs_registry_acquire(8, 32, 0, RS_CODEC_DEFAULT_FCR,
+                              RS_CODEC_DEFAULT_PRIM, &first) == 0);
+    rs_registry_release(first);
+
+    for (int i = 0; i < RS_REGISTRY_IDLE_MAX; i++) {
+        const rs_tables_t * other;
+        CHECK(rs_registry_acquire(8, 2 + 2 * i, 0, RS_CODEC_DEFAULT_FCR,
+                                  RS_CODEC_DEFAULT_PRIM, &other) == 0);
+        rs_registry_release(other);
+    }
+    int count;
+    rs_registry_usage(&count, NULL);
+    CHECK(count == RS_REGISTRY_IDLE_MAX);
+
+    // The first code was evicted, so acquiring it adds a table
+    const rs_tables_t * again;
+    CHECK(rs_registry_acquire(8, 32, 0, RS_CODEC_DEFAULT_FCR,
+                              RS_CODEC_DEFAULT_PRIM, &again) == 0);
+    rs_registry_usage(&count, NULL);
+    CHECK(count == RS_REGISTRY_IDLE_MAX + 1);
+    CHECK(again->nparity == 32 && again->refs == 1);
+
+    // Codes in use are never evicted, only trimmed once released
+    rs_registry_trim();
+    rs_registry_usage(&count, NULL);
+    CHECK(count == 1);
+    rs_registry_release(again);
+    rs_registry_trim();
+    rs_registry_usage(&count, NULL);
+    CHECK(count == 0);
+}
+
+int main(void) {
+
+    uint64_t rng = 0x7e915ULL;
+
+    test_sharing(&rng);
+    test_eviction();
+
+    return test_result("test_registry");
+}
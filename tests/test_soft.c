@@ -0,0 +1,212 @@
+//
+// Soft decision decoder tests: Chase decoding corrects what its patterns
+// cover and GMD decoding what its erasure stages cover, however many
+// errors that is, and neither ever returns a word that is not a codeword.
+//
+// @author Jarrod Bennett
+//
+
+#include "rs_test.h"
+
+// Reliabilities of the symbols the tests make weak and of the rest.
+#define WEAK                    (0.5f)
+#define STRONG                  (20.0f)
+
+// Codes tried: m, nparity.
+static const int codes[][2] = {
+    {4, 4},
+    {4, 5},
+    {6, 7},
+    {8, 16},
+};
+
+#define CODES                   ((int) (sizeof(codes) / sizeof(codes[0])))
+
+// Send a random codeword of n symbols with errors at the first nweak of
+// positions, marked least reliable, and at the next nstrong, marked as
+// reliable as the rest.
+static void make_word(uint64_t * rng, const rs_codec_t * codec, int n,
+                      int nweak, int nstrong, uint8_t * sent,
+                      uint8_t * received, float * reliability) {
+
+    int k = n - codec->nparity;
+    test_fill(rng, sent, k, codec->nn);
+    rs_codec_encode(codec, sent, k, &sent[k]);
+    memcpy(received, sent, (size_t) n);
+
+    int positions[RS_FIELD_MAX_SIZE];
+    test_positions(rng, n, positions, nweak + nstrong);
+    for (int i = 0; i < n; i++) {
+        reliability[i] = STRONG + (float) test_below(rng, 100) / 100;
+    }
+    for (int i = 0; i < nweak + nstrong; i++) {
+        received[positions[i]] ^= (uint8_t) (1 + test_below(rng, codec->nn));
+        if (i < nweak) {
+            reliability[positions[i]] = WEAK * (float) i / (float) nweak;
+        }
+    }
+}
+
+// With every pattern of nweak symbols tried, errors on all the weak
+// symbols and e others are corrected whenever 2 * e + nweak <= nparity,
+// beyond the hard decision limit once nweak > 1.
+static void test_chase_within(uint64_t * rng) {
+
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init(&codec, codes[c][0], codes[c][1]) == 0);
+        int np = codec.nparity;
+
+        for (int trial = 0; trial < 1000; trial++) {
+            int n = np + 1 + test_below(rng, codec.nn - np);
+            int limit = np < 6 ? np : 6;
+            int nweak = 1 + test_below(rng, limit < n ? limit : n - 1);
+            int nstrong = (np - nweak) / 2;
+            if (nweak + nstrong > n) {
+                continue;
+            }
+
+            uint8_t sent[RS_FIELD_MAX_SIZE];
+            uint8_t received[RS_FIELD_MAX_SIZE];
+            float reliability[RS_FIELD_MAX_SIZE];
+            make_word(rng, &codec, n, nweak, nstrong, sent, received,
+                      reliability);
+
+            int positions[RS_CODEC_MAX_PARITY];
+            int result = rs_codec_decode_chase(&codec, received, n,
+                                               reliability, nweak,
+                                               1 << nweak, positions);
+            CHECK(result == nweak + nstrong);
+            CHECK(memcmp(received, sent, (size_t) n) == 0);
+        }
+        rs_codec_free(&codec);
+    }
+}
+
+// Whatever the errors and reliabilities, the result is a codeword or
+// RS_ERR_UNCORRECTABLE with the word untouched.
+static void test_chase_valid(uint64_t * rng) {
+
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init(&codec, codes[c][0], codes[c][1]) == 0);
+        int np = codec.nparity;
+
+        for (int trial = 0; trial < 4000; trial++) {
+            int n = np + 1 + test_below(rng, codec.nn - np);
+            int nerrors = np / 2 + 1 + test_below(rng, np);
+            if (nerrors > n) {
+                continue;
+            }
+            int nweak = test_below(rng, nerrors + 1);
+
+            uint8_t sent[RS_FIELD_MAX_SIZE];
+            uint8_t received[RS_FIELD_MAX_SIZE];
+            float reliability[RS_FIELD_MAX_SIZE];
+            make_word(rng, &codec, n, nweak, nerrors - nweak, sent, received,
+                      reliability);
+            uint8_t before[RS_FIELD_MAX_SIZE];
+            memcpy(before, received, (size_t) n);
+
+            int chase = np < RS_CODEC_MAX_CHASE ? np : RS_CODEC_MAX_CHASE;
+            int weak = 1 + test_below(rng, chase < 6 ? chase : 6);
+            int result = rs_codec_decode_chase(&codec, received, n,
+                                               reliability, weak, 1 << weak,
+                                               NULL);
+            if (result == RS_ERR_UNCORRECTABLE) {
+                CHECK(memcmp(received, before, (size_t) n) == 0);
+            } else {
+                CHECK(result >= 0);
+                CHECK(test_is_codeword(&codec, received, n));
+            }
+        }
+        rs_codec_free(&codec);
+    }
+}
+
+// Errors on the e least reliable symbols and f others are corrected
+// whenever e rounded up to even plus 2 * f is at most nparity, for odd
+// and even nparity, up to nparity - 1 or nparity errors.
+static void test_gmd_within(uint64_t * rng) {
+
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init(&codec, codes[c][0], codes[c][1]) == 0);
+        int np = codec.nparity;
+        int beyond = 0;
+
+        for (int trial = 0; trial < 1000; trial++) {
+            int n = np + 1 + test_below(rng, codec.nn - np);
+            int nweak = test_below(rng, np + 1);
+            int erased = (nweak + 1) / 2 * 2;
+            int nstrong = (np - erased) / 2;
+            if (erased > np || nweak + nstrong > n) {
+                continue;
+            }
+            beyond += 2 * (nweak + nstrong) > np;
+
+            uint8_t sent[RS_FIELD_MAX_SIZE];
+            uint8_t received[RS_FIELD_MAX_SIZE];
+            float reliability[RS_FIELD_MAX_SIZE];
+            make_word(rng, &codec, n, nweak, nstrong, sent, received,
+                      reliability);
+
+            int positions[RS_CODEC_MAX_PARITY];
+            int result = rs_codec_decode_gmd(&codec, received, n,
+                                             reliability, positions);
+            CHECK(result == nweak + nstrong);
+            CHECK(memcmp(received, sent, (size_t) n) == 0);
+        }
+        CHECK(beyond > 0);
+        rs_codec_free(&codec);
+    }
+}
+
+// As for Chase, only codewords or RS_ERR_UNCORRECTABLE come back.
+static void test_gmd_valid(uint64_t * rng) {
+
+    for (int c = 0; c < CODES; c++) {
+        rs_codec_t codec;
+        CHECK(rs_codec_init(&codec, codes[c][0], codes[c][1]) == 0);
+        int np = codec.nparity;
+
+        for (int trial = 0; trial < 4000; trial++) {
+            int n = np + 1 + test_below(rng, codec.nn - np);
+            int nerrors = np / 2 + 1 + test_below(rng, np);
+            if (nerrors > n) {
+                continue;
+            }
+            int nweak = test_below(rng, nerrors + 1);
+
+            uint8_t sent[RS_FIELD_MAX_SIZE];
+            uint8_t received[RS_FIELD_MAX_SIZE];
+            float reliability[RS_FIELD_MAX_SIZE];
+            make_word(rng, &codec, n, nweak, nerrors - nweak, sent, received,
+                      reliability);
+            uint8_t before[RS_FIELD_MAX_SIZE];
+            memcpy(before, received, (size_t) n);
+
+            int result = rs_codec_decode_gmd(&codec, received, n,
+                                             reliability, NULL);
+            if (result == RS_ERR_UNCORRECTABLE) {
+                CHECK(memcmp(received, before, (size_t) n) == 0);
+            } else {
+                CHECK(result >= 0);
+                CHECK(test_is_codeword(&codec, received, n));
+            }
+        }
+        rs_codec_free(&codec);
+    }
+}
+
+int main(void) {
+
+    uint64_t rng = 0xc4a5eULL;
+
+    test_chase_within(&rng);
+    test_chase_valid(&rng);
+    test_gmd_within(&rng);
+    test_gmd_valid(&rng);
+
+    return test_result("test_soft");
+}
@@ -0,0 +1,302 @@
+//
+// Statistics and tracing tests: a codec's counters and histograms tally
+// exactly the calls made on it, whatever their results, and render as
+// OpenMetrics text, and traced pipelines give Chrome trace-event JSON.
+//
+// @author Jarrod Bennett
+//
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "rs_test.h"
+#include "rs_container.h"
+#include "rs_metrics.h"
+#include "rs_trace.h"
+
+// Counters and histograms match the results the calls returned. Without
+// statistics built in, attaching a block is refused.
+static void test_counters(uint64_t * rng) {
+
+    enum { CALLS = 300 };
+    rs_codec_t codec;
+    rs_codec_stats_t stats;
+    rs_stats_reset(&stats);
+    CHECK(rs_codec_init(&codec, 8, 16) == 0);
+    int np = codec.nparity;
+
+#ifdef RS_CODEC_STATS
+    CHECK(rs_codec_set_stats(&codec, &stats) == 0);
+#else
+    CHECK(rs_codec_set_stats(&codec, &stats) == RS_ERR_INVALID_ARGS);
+#endif
+
+    uint64_t failures = 0;
+    uint64_t corrected = 0;
+    uint64_t symbols = 0;
+    uint64_t erasures = 0;
+    for (int i = 0; i < CALLS; i++) {
+        int n = np + 1 + test_below(rng, codec.nn - np);
+        int k = n - np;
+        uint8_t word[RS_FIELD_MAX_SIZE];
+        test_fill(rng, word, k, codec.nn);
+        CHECK(rs_codec_encode(&codec, word, k, &word[k]) == 0);
+
+        // Within the capability, or often well beyond it
+        int nerasures = test_below(rng, np / 2);
+        int nerrors = test_below(rng, np);
+        if (nerasures + nerrors > n) {
+            nerrors = n - nerasures;
+        }
+        int positions[RS_FIELD_MAX_SIZE];
+        test_positions(rng, n, positions, nerasures + nerrors);
+        for (int j = 0; j < nerasures + nerrors; j++) {
+            word[positions[j]] ^= (uint8_t) (1 + test_below(rng, codec.nn));
+        }
+
+        int result = rs_codec_decode(&codec, word, n, positions, nerasures,
+                                     NULL);
+        CHECK(result >= 0 || result == RS_ERR_UNCORRECTABLE);
+        failures += result < 0;
+        corrected += result > 0;
+        symbols += result > 0 ? (uint64_t) result : 0;
+        erasures += (uint64_t) nerasures;
+    }
+    rs_codec_free(&codec);
+
+    rs_codec_stats_t snapshot;
+    rs_stats_snapshot(&stats, &snapshot);
+#ifdef RS_CODEC_STATS
+    CHECK(failures > 0);
+    CHECK(snapshot.encoded == CALLS);
+    CHECK(snapshot.decoded == CALLS);
+    CHECK(snapshot.corrected == corrected);
+    CHECK(snapshot.symbols == symbols);
+    CHECK(snapshot.failures == failures);
+    CHECK(snapshot.erasures == erasures);
+    CHECK(snapshot.encodeCycles.count == CALLS);
+    CHECK(snapshot.decodeCycles.count == CALLS);
+
+    uint64_t encodes = 0;
+    uint64_t decodes = 0;
+    for (int b = 0; b < RS_STATS_BUCKETS; b++) {
+        encodes += snapshot.encodeCycles.buckets[b];
+        decodes += snapshot.decodeCycles.buckets[b];
+    }
+    CHECK(encodes == CALLS);
+    CHECK(decodes == CALLS);
+
+    // Only the codewords which decoded have a correction count
+    uint64_t decoded = 0;
+    for (int b = 0; b < RS_STATS_CORRECTION_BUCKETS; b++) {
+        decoded += snapshot.corrections[b];
+    }
+    CHECK(decoded == CALLS - failures);
+    CHECK(snapshot.corrections[0] == CALLS - failures - corrected);
+#else
+    (void) corrected;
+    (void) symbols;
+    (void) erasures;
+    CHECK(snapshot.encoded == 0 && snapshot.decoded == 0);
+#endif
+}
+
+// Whether text has a line.
+static int has_line(const char * text, const char * line) {
+
+    size_t length = strlen(line);
+    for (const char * at = strstr(text, line); at != NULL;
+         at = strstr(at + 1, line)) {
+        if ((at == text || at[-1] == '\n') && at[length] == '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The exposition of a known block has the expected samples, with and
+// without labels, cumulative histogram buckets and the OpenMetrics end
+// marker, and is measured, truncated and written to a file as documented.
+static void test_metrics(void) {
+
+    rs_codec_stats_t stats;
+    rs_stats_reset(&stats);
+    stats.encoded = 7;
+    stats.decoded = 12;
+    stats.corrected = 9;
+    stats.symbols = 20;
+    stats.failures = 1;
+    stats.erasures = 3;
+    stats.corrections[0] = 2;
+    stats.corrections[1] = 4;
+    stats.corrections[2] = 5;
+    rs_stats_record(&stats.encodeCycles, 100);
+    rs_stats_record(&stats.encodeCycles, 1000);
+
+    static const char * const labelled[] = {
+        "rs_codec_encoded_total{link=\"up\"} 7",
+        "rs_codec_decoded_total{link=\"up\"} 12",
+        "rs_codec_corrected_total{link=\"up\"} 9",
+        "rs_codec_failures_total{link=\"up\"} 1",
+        "rs_codec_symbols_corrected_total{link=\"up\"} 20",
+        "rs_codec_erasures_total{link=\"up\"} 3",
+        "# TYPE rs_codec_corrections histogram",
+        "rs_codec_corrections_bucket{link=\"up\",le=\"0\"} 2",
+        "rs_codec_corrections_bucket{link=\"up\",le=\"1\"} 6",
+        "rs_codec_corrections_bucket{link=\"up\",le=\"3\"} 11",
+        "rs_codec_corrections_bucket{link=\"up\",le=\"+Inf\"} 11",
+        "rs_codec_corrections_count{link=\"up\"} 11",
+        "rs_codec_corrections_sum{link=\"up\"} 20",
+        "rs_codec_encode_cycles_bucket{link=\"up\",le=\"63\"} 0",
+        "rs_codec_encode_cycles_bucket{link=\"up\",le=\"127\"} 1",
+        "rs_codec_encode_cycles_bucket{link=\"up\",le=\"1023\"} 2",
+        "rs_codec_encode_cycles_count{link=\"up\"} 2",
+        "rs_codec_encode_cycles_sum{link=\"up\"} 1100",
+        "rs_codec_decode_cycles_count{link=\"up\"} 0",
+    };
+    static const char * const unlabelled[] = {
+        "rs_codec_encoded_total 7",
+        "rs_codec_corrections_bucket{le=\"1\"} 6",
+        "rs_codec_corrections_count 11",
+        "rs_codec_encode_cycles_sum 1100",
+    };
+
+    char text[16384];
+    size_t length = rs_metrics_render(&stats, "link=\"up\"", text,
+                                      sizeof(text));
+    CHECK(length < sizeof(text) && length == strlen(text));
+    for (size_t i = 0; i < sizeof(labelled) / sizeof(labelled[0]); i++) {
+        CHECK(has_line(text, labelled[i]));
+    }
+    CHECK(length >= 6 && strcmp(&text[length - 6], "# EOF\n") == 0);
+    CHECK(rs_metrics_render(&stats, "link=\"up\"", NULL, 0) == length);
+
+    // Truncated, but still terminated and measured in full
+    char small[64];
+    CHECK(rs_metrics_render(&stats, "link=\"up\"", small, sizeof(small)) ==
+          length);
+    CHECK(strlen(small) == sizeof(small) - 1);
+    CHECK(memcmp(small, text, sizeof(small) - 1) == 0);
+
+    rs_metrics_render(&stats, NULL, text, sizeof(text));
+    for (size_t i = 0; i < sizeof(unlabelled) / sizeof(unlabelled[0]); i++) {
+        CHECK(has_line(text, unlabelled[i]));
+    }
+    CHECK(!has_line(text, "rs_codec_encoded_total{} 7"));
+
+    // The file holds exactly the rendered text
+    char path[] = "/tmp/rs_metricsXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    CHECK(rs_metrics_write_file(&stats, NULL, path) == 0);
+    char written[sizeof(text)];
+    int in = open(path, O_RDONLY);
+    ssize_t got = read(in, written, sizeof(written));
+    CHECK(got == (ssize_t) strlen(text));
+    CHECK(got > 0 && memcmp(written, text, (size_t) got) == 0);
+    close(in);
+    close(fd);
+    unlink(path);
+}
+
+// Count the occurrences of a string in text.
+static int count_of(const char * text, const char * what) {
+
+    int count = 0;
+    for (const char * at = strstr(text, what); at != NULL;
+         at = strstr(at + 1, what)) {
+        count++;
+    }
+    return count;
+}
+
+// Read back a trace written to a temporary file, NUL terminated.
+static char * write_trace(void) {
+
+    char path[] = "/tmp/rs_traceXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    unlink(path);
+    CHECK(rs_trace_write(fd) == 0);
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    char * json = malloc((size_t) size + 1);
+    CHECK(pread(fd, json, (size_t) size, 0) == size);
+    json[size] = '\0';
+    close(fd);
+    return json;
+}
+
+// A traced container write gives a Chrome trace-event document with a
+// complete event for each pipeline stage, and events beyond a thread's
+// buffer are counted and dropped.
+static void test_trace(uint64_t * rng) {
+
+    CHECK(rs_trace_begin() == 0);
+
+    enum { LENGTH = 1 << 20 };
+    uint8_t * data = malloc(LENGTH);
+    test_fill(rng, data, LENGTH, 0xff);
+    char inPath[] = "/tmp/rs_traceXXXXXX";
+    char outPath[] = "/tmp/rs_traceXXXXXX";
+    int inFd = mkstemp(inPath);
+    int outFd = mkstemp(outPath);
+    CHECK(inFd >= 0 && outFd >= 0);
+    unlink(inPath);
+    unlink(outPath);
+    CHECK(write(inFd, data, LENGTH) == LENGTH);
+
+    CHECK(rs_trace_start(0) == 0);
+    rs_container_params_t params;
+    rs_container_params_default(&params);
+    CHECK(rs_container_write(inFd, outFd, &params, 2) == 0);
+    rs_trace_stop();
+    CHECK(rs_trace_begin() == 0);
+
+    char * json = write_trace();
+    static const char head[] = "{\"displayTimeUnit\":\"ns\","
+                               "\"traceEvents\":[\n";
+    size_t length = strlen(json);
+    CHECK(strncmp(json, head, sizeof(head) - 1) == 0);
+    CHECK(length >= 4 && strcmp(&json[length - 4], "\n]}\n") == 0);
+    CHECK(count_of(json, "{") == count_of(json, "}"));
+    CHECK(count_of(json, "\"ph\":\"M\"") >= 1);
+    CHECK(count_of(json, "\"ph\":\"X\"") > 0);
+    CHECK(count_of(json, "\"name\":\"segment\"") > 0);
+    CHECK(count_of(json, "\"name\":\"crc\"") > 0);
+    CHECK(count_of(json, "\"name\":\"encode\"") > 0);
+    CHECK(count_of(json, "\"name\":\"write\"") > 0);
+    CHECK(rs_trace_dropped() == 0);
+    free(json);
+
+    // A new trace starts empty, and keeps only what fits
+    CHECK(rs_trace_start(4) == 0);
+    for (int i = 0; i < 10; i++) {
+        rs_trace_end("stage", rs_trace_begin(), (uint64_t) i);
+    }
+    rs_trace_stop();
+    json = write_trace();
+    CHECK(count_of(json, "\"ph\":\"X\"") == 4);
+    CHECK(count_of(json, "\"name\":\"stage\"") == 4);
+    CHECK(count_of(json, "\"name\":\"encode\"") == 0);
+    CHECK(strstr(json, "\"args\":{\"batch\":3}") != NULL);
+    CHECK(rs_trace_dropped() == 6);
+    free(json);
+    rs_trace_free();
+
+    close(inFd);
+    close(outFd);
+    free(data);
+}
+
+int main(void) {
+
+    uint64_t rng = 0x57a75ULL;
+
+    test_counters(&rng);
+    test_metrics();
+    test_trace(&rng);
+
+    return test_result("test_stats");
+}